@@ -33,14 +33,22 @@ public:
   virtual void bind_result(const BindData *bd, const std::size_t size) = 0;
 
   virtual void connect(const DatabaseConfig& cfg) = 0;
+  virtual SqlDialect dialect() const noexcept = 0;
   virtual void disconnect() = 0;
   virtual bool is_connected() const noexcept = 0;
   virtual uint64_t last_inserted_rowid() const noexcept = 0;
+  // Whether `op` accepts a RETURNING clause on the connected server
+  virtual bool supports_returning(QueryAst::Operation op) const noexcept = 0;
 
   virtual void stmt_close() = 0;
   virtual ExecStatus stmt_execute() = 0;
   virtual ExecStatus stmt_fetch() = 0;
+  // Applies to the prepared statement, must precede stmt_execute()
+  virtual void stmt_fetch_strategy(const FetchStrategy &strategy) = 0;
   virtual void stmt_fetch_column(const int index, BindData &bd) = 0;
+  // Text or blob column of the current row without copying it out; valid
+  // until the next stmt_fetch()
+  virtual std::span<const std::byte> stmt_column_view(const int index) = 0;
   virtual void stmt_init() = 0;
   virtual void stmt_prepare(std::string_view sql) = 0;
 };
@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <map>
@@ -14,12 +16,30 @@
 
 namespace sqlinq {
 
+/*
+ * SQLite specific connection options. Every field is optional; an unset field
+ * leaves the SQLite default untouched, so an empty SQLiteOptions behaves
+ * exactly like a plain sqlite3_open().
+ */
+struct SQLiteOptions {
+  std::string preset;       // named profile, see apply_sqlite_preset()
+  std::string open_flags;   // e.g. "nomutex,sharedcache"
+  std::optional<std::string> journal_mode;
+  std::optional<std::string> synchronous;
+  std::optional<std::string> temp_store;
+  std::optional<int64_t> cache_size;
+  std::optional<int64_t> mmap_size;
+  std::optional<int> busy_timeout; // milliseconds
+  std::optional<int> page_size;
+};
+
 struct DatabaseConfig {
   std::string host;
   int port{};
   std::string user;
   std::string passwd;
   std::string database;
+  SQLiteOptions sqlite;
 };
 
 inline std::string trim(std::string s) {
@@ -29,6 +49,77 @@ inline std::string trim(std::string s) {
   return s;
 }
 
+/*
+ * Fill every option that was not set explicitly with the value from the named
+ * preset. Explicit keys always win, regardless of their order in db.conf.
+ *   throughput - WAL, synchronous=NORMAL, 64 MiB cache, 256 MiB mmap
+ *   durable    - WAL, synchronous=FULL
+ */
+inline void apply_sqlite_preset(SQLiteOptions &opts) {
+  auto set = [](auto &field, auto value) {
+    if (!field.has_value()) {
+      field = value;
+    }
+  };
+
+  if (opts.preset.empty()) {
+    return;
+  } else if (opts.preset == "throughput") {
+    set(opts.journal_mode, "WAL");
+    set(opts.synchronous, "NORMAL");
+    set(opts.temp_store, "MEMORY");
+    set(opts.cache_size, -65536);
+    set(opts.mmap_size, 268435456);
+    set(opts.busy_timeout, 5000);
+  } else if (opts.preset == "durable") {
+    set(opts.journal_mode, "WAL");
+    set(opts.synchronous, "FULL");
+    set(opts.busy_timeout, 5000);
+  } else {
+    throw std::invalid_argument("Unknown sqlite preset: " + opts.preset);
+  }
+}
+
+// Integer value of key; unlike std::stoi the message names the key
+template <typename Int>
+Int parse_int(std::string_view key, const std::string &val) {
+  Int out{};
+  const char *last = val.data() + val.size();
+  auto [end, ec] = std::from_chars(val.data(), last, out);
+  if (ec != std::errc{} || end != last) {
+    throw std::invalid_argument("Invalid number for " + std::string{key} +
+                                ": " + val);
+  }
+  return out;
+}
+
+// Returns false for an unknown key
+inline bool set_sqlite_option(SQLiteOptions &opts, std::string_view key,
+                              const std::string &val) {
+  if (key == "preset") {
+    opts.preset = val;
+  } else if (key == "open_flags") {
+    opts.open_flags = val;
+  } else if (key == "journal_mode") {
+    opts.journal_mode = val;
+  } else if (key == "synchronous") {
+    opts.synchronous = val;
+  } else if (key == "temp_store") {
+    opts.temp_store = val;
+  } else if (key == "cache_size") {
+    opts.cache_size = parse_int<int64_t>(key, val);
+  } else if (key == "mmap_size") {
+    opts.mmap_size = parse_int<int64_t>(key, val);
+  } else if (key == "busy_timeout") {
+    opts.busy_timeout = parse_int<int>(key, val);
+  } else if (key == "page_size") {
+    opts.page_size = parse_int<int>(key, val);
+  } else {
+    return false;
+  }
+  return true;
+}
+
 inline std::map<std::string, DatabaseConfig>
 parse_config_file(std::string_view fname) {
   std::ifstream file(fname.data());
@@ -69,16 +160,22 @@ parse_config_file(std::string_view fname) {
       throw std::invalid_argument("key outside of section: " + key);
     }
 
-    if (key == "host") {
-      cfg[section].host = val;
-    } else if (key == "port") {
-      cfg[section].port = std::stoi(val);
-    } else if (key == "user") {
-      cfg[section].user = val;
-    } else if (key == "password") {
-      cfg[section].passwd = val;
-    } else if (key == "database") {
-      cfg[section].database = val;
+    try {
+      if (key == "host") {
+        cfg[section].host = val;
+      } else if (key == "port") {
+        cfg[section].port = parse_int<int>(key, val);
+      } else if (key == "user") {
+        cfg[section].user = val;
+      } else if (key == "password") {
+        cfg[section].passwd = val;
+      } else if (key == "database") {
+        cfg[section].database = val;
+      } else if (!set_sqlite_option(cfg[section].sqlite, key, val)) {
+        throw std::invalid_argument("Unknown key: " + key);
+      }
+    } catch (const std::invalid_argument &e) {
+      throw std::invalid_argument("[" + section + "] " + e.what());
     }
   }
   return cfg;
@@ -120,7 +217,7 @@ parse_env_config(const std::vector<std::string> &sections,
       dbc.host = *host;
     }
     if (auto port = get_env_var(to_key(section, "PORT"))) {
-      dbc.port = std::stoi(*port);
+      dbc.port = parse_int<int>("port", *port);
     }
     if (auto user = get_env_var(to_key(section, "USER"))) {
       dbc.user = *user;
@@ -132,6 +229,18 @@ parse_env_config(const std::vector<std::string> &sections,
       dbc.database = *db;
     }
 
+    for (std::string_view key :
+         {"preset", "open_flags", "journal_mode", "synchronous", "temp_store",
+          "cache_size", "mmap_size", "busy_timeout", "page_size"}) {
+      std::string env_key{key};
+      std::transform(
+          env_key.begin(), env_key.end(), env_key.begin(),
+          [](const char c) -> char { return static_cast<char>(toupper(c)); });
+      if (auto val = get_env_var(to_key(section, env_key))) {
+        set_sqlite_option(dbc.sqlite, key, *val);
+      }
+    }
+
     cfg[section] = std::move(dbc);
   }
   return cfg;
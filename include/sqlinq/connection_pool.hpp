@@ -0,0 +1,159 @@
+#ifndef SQLINQ_CONNECTION_POOL_HPP_
+#define SQLINQ_CONNECTION_POOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "config.hpp"
+#include "cursor.hpp"
+
+namespace sqlinq {
+
+/*
+ * Fixed size set of connected backends. A connection is handed out through
+ * a Lease and returned to the pool when the lease is destroyed, so every
+ * backend is used by at most one thread at a time.
+ */
+template <typename Backend> class ConnectionPool {
+public:
+  class Lease {
+  public:
+    Lease() noexcept : pool_(nullptr), backend_(nullptr) {}
+    Lease(ConnectionPool *pool, Backend *backend) noexcept
+        : pool_(pool), backend_(backend) {}
+
+    Lease(Lease &&other) noexcept
+        : pool_(std::exchange(other.pool_, nullptr)),
+          backend_(std::exchange(other.backend_, nullptr)) {}
+
+    Lease &operator=(Lease &&other) noexcept {
+      if (this != &other) {
+        release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        backend_ = std::exchange(other.backend_, nullptr);
+      }
+      return *this;
+    }
+
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+
+    ~Lease() { release(); }
+
+    Backend &operator*() const noexcept { return *backend_; }
+    Backend *operator->() const noexcept { return backend_; }
+    explicit operator bool() const noexcept { return backend_ != nullptr; }
+
+    void release() noexcept {
+      if (pool_ != nullptr) {
+        pool_->release(backend_);
+        pool_ = nullptr;
+        backend_ = nullptr;
+      }
+    }
+
+  private:
+    ConnectionPool *pool_;
+    Backend *backend_;
+  };
+
+  ConnectionPool(const DatabaseConfig &cfg, std::size_t size) {
+    if (size == 0) {
+      throw std::invalid_argument("Connection pool size must be > 0");
+    }
+    conns_.reserve(size);
+    idle_.reserve(size);
+    for (std::size_t i = 0; i < size; i++) {
+      auto backend = std::make_unique<Backend>();
+      backend->connect(cfg);
+      idle_.push_back(backend.get());
+      conns_.emplace_back(std::move(backend));
+    }
+  }
+
+  ConnectionPool(const ConnectionPool &) = delete;
+  ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+  Lease acquire() {
+    std::unique_lock lock{mtx_};
+    cv_.wait(lock, [this] { return !idle_.empty(); });
+    Backend *backend = idle_.back();
+    idle_.pop_back();
+    return Lease{this, backend};
+  }
+
+  std::optional<Lease> try_acquire() {
+    std::lock_guard lock{mtx_};
+    if (idle_.empty()) {
+      return std::nullopt;
+    }
+    Backend *backend = idle_.back();
+    idle_.pop_back();
+    return Lease{this, backend};
+  }
+
+  std::size_t available() const {
+    std::lock_guard lock{mtx_};
+    return idle_.size();
+  }
+
+  std::size_t size() const noexcept { return conns_.size(); }
+
+private:
+  std::vector<std::unique_ptr<Backend>> conns_;
+  std::vector<Backend *> idle_;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+
+  void release(Backend *backend) noexcept {
+    {
+      std::lock_guard lock{mtx_};
+      idle_.push_back(backend);
+    }
+    cv_.notify_one();
+  }
+};
+
+/*
+ * Cursor which keeps its pooled connection leased until the cursor is
+ * destroyed. The lease is declared first so it outlives the cursor.
+ */
+template <typename Backend, typename T, typename C = Cursor<T>>
+class PooledCursor {
+public:
+  using lease_type = typename ConnectionPool<Backend>::Lease;
+  using cursor_type = C;
+  using value_type = typename cursor_type::value_type;
+  using iterator = typename cursor_type::iterator;
+
+  template <typename Fn>
+  PooledCursor(lease_type &&lease, Fn &&fn)
+      : lease_(std::move(lease)), cursor_(fn(*lease_)) {}
+
+  iterator begin() { return cursor_.begin(); }
+  iterator end() { return cursor_.end(); }
+  bool has_next() const noexcept { return cursor_.has_next(); }
+  bool next() { return cursor_.next(); }
+  value_type &current() { return cursor_.current(); }
+
+  // See Cursor::prefetch(); the lease moves to the returned cursor
+  auto prefetch(std::size_t rows) && {
+    using prefetch_type = PrefetchCursor<value_type>;
+    return PooledCursor<Backend, value_type, prefetch_type>{
+        std::move(lease_),
+        [&](Backend &) { return std::move(cursor_).prefetch(rows); }};
+  }
+
+private:
+  lease_type lease_;
+  cursor_type cursor_;
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_CONNECTION_POOL_HPP_
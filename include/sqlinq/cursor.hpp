@@ -1,14 +1,25 @@
 #ifndef SQLINQ_CURSOR_HPP_
 #define SQLINQ_CURSOR_HPP_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
 #include <tuple>
 
 #include "backend/backend_iface.hpp"
+#include "table.hpp"
+#include "type_traits.hpp"
 #include "types/blob.hpp"
+#include "types/view.hpp"
 
 namespace sqlinq {
 
+template <typename T> class PrefetchCursor;
+
 template <std::size_t N> class Result {
 public:
   Result(BackendIface &db) : backend_(db) {
@@ -40,21 +51,19 @@ public:
   }
 
   inline void column(const int index, std::string &) noexcept {
-    bd_[index].type = column::Type::Text;
-    bd_[index].buffer = nullptr;
-    bd_[index].buffer_length = 0;
-    bd_[index].length = &length_[index];
-    bd_[index].error = &error_[index];
-    bd_[index].is_null = &is_null_[index];
+    container_column(index, column::Type::Text);
   }
 
   inline void column(const int index, Blob &) noexcept {
-    bd_[index].type = column::Type::Blob;
-    bd_[index].buffer = nullptr;
-    bd_[index].buffer_length = 0;
-    bd_[index].length = &length_[index];
-    bd_[index].error = &error_[index];
-    bd_[index].is_null = &is_null_[index];
+    container_column(index, column::Type::Blob);
+  }
+
+  inline void column(const int index, TextView &) noexcept {
+    container_column(index, column::Type::Text);
+  }
+
+  inline void column(const int index, BlobView &) noexcept {
+    container_column(index, column::Type::Blob);
   }
 
   template <std::integral Int>
@@ -92,7 +101,8 @@ public:
 
   template <std::size_t Precision, std::size_t Scale>
   void column(const int index, Decimal<Precision, Scale> &value) noexcept {
-    bd_[index].type = column::Type::Decimal;
+    bd_[index].type =
+        details::column_type_map<Decimal<Precision, Scale>>::value();
     bd_[index].buffer = (void *)&value;
     bd_[index].is_null = &is_null_[index];
     bd_[index].length = 0;
@@ -146,6 +156,10 @@ public:
   }
 
   inline void fetch(const int index, Blob &blob) noexcept {
+    if (is_null_[index]) {
+      blob.clear(); // NULL column of a left joined entity
+      return;
+    }
     BindData bind = bd_[index];
     blob.resize(length_[index]);
     bind.buffer = (void *)blob.data();
@@ -154,6 +168,10 @@ public:
   }
 
   inline void fetch(const int index, std::string &text) noexcept {
+    if (is_null_[index]) {
+      text.clear(); // NULL column of a left joined entity
+      return;
+    }
     BindData bind = bd_[index];
     text.resize(length_[index]);
     bind.buffer = (void *)text.data();
@@ -161,6 +179,16 @@ public:
     backend_.stmt_fetch_column(index, bind);
   }
 
+  inline void fetch(const int index, TextView &text) {
+    std::span<const std::byte> bytes = backend_.stmt_column_view(index);
+    text = TextView{{reinterpret_cast<const char *>(bytes.data()), bytes.size()},
+                    epoch_.guard()};
+  }
+
+  inline void fetch(const int index, BlobView &blob) {
+    blob = BlobView{backend_.stmt_column_view(index), epoch_.guard()};
+  }
+
   template <typename T> inline void fetch(const int, T &) noexcept {}
 
   template <typename Tuple> void bind_result(Tuple &tup) {
@@ -171,7 +199,12 @@ public:
     backend_.bind_result(bd_, N);
   }
 
-  inline ExecStatus fetch() { return backend_.stmt_fetch(); }
+  bool is_null(const int index) const noexcept { return is_null_[index]; }
+
+  inline ExecStatus fetch() {
+    epoch_.advance();
+    return backend_.stmt_fetch();
+  }
 
   template <typename Tuple> void fetch_for_each(Tuple &tup) {
     constexpr std::size_t tup_size =
@@ -179,6 +212,33 @@ public:
     fetch_for_each_impl(tup, std::make_index_sequence<tup_size>{});
   }
 
+  // Empties the std::optional fields of NULL columns
+  template <typename Tuple> void reset_nulls(Tuple &tup) {
+    [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+      (reset_null(Idx, std::get<Idx>(tup)), ...);
+    }(std::make_index_sequence<
+        std::tuple_size_v<std::remove_reference_t<Tuple>>>{});
+  }
+
+  // Engages emptied std::optional fields again, so their bound buffers
+  // receive the next row
+  template <typename Tuple> void engage_optionals(Tuple &tup) {
+    std::apply(
+        [](auto &...field) {
+          (
+              [](auto &f) {
+                if constexpr (detail::is_optional_v<
+                                  std::remove_reference_t<decltype(f)>>) {
+                  if (!f.has_value()) {
+                    f.emplace();
+                  }
+                }
+              }(field),
+              ...);
+        },
+        tup);
+  }
+
   Result &operator=(Result &&) = default;
   Result &operator=(const Result &) = delete;
 
@@ -188,6 +248,26 @@ private:
   bool error_[N];
   bool is_null_[N];
   std::size_t length_[N];
+  detail::RowEpoch epoch_; // debug check of TextView/BlobView lifetime
+
+  // Variable length column; the backend reports its length and the data is
+  // read by fetch() once the row is known to be truncated
+  void container_column(const int index, column::Type type) noexcept {
+    bd_[index].type = type;
+    bd_[index].buffer = nullptr;
+    bd_[index].buffer_length = 0;
+    bd_[index].length = &length_[index];
+    bd_[index].error = &error_[index];
+    bd_[index].is_null = &is_null_[index];
+  }
+
+  template <typename T> void reset_null(const int index, T &field) noexcept {
+    if constexpr (detail::is_optional_v<T>) {
+      if (is_null_[index]) {
+        field.reset();
+      }
+    }
+  }
 
   template <typename Tuple, std::size_t... Idx>
   void column_for_each_impl(Tuple &tup, std::index_sequence<Idx...>) {
@@ -267,24 +347,36 @@ public:
   using base_type = CursorBase<Cursor<value_type>, value_type>;
   using base_type::base_type;
 
-  Cursor(BackendIface &db) : db_(db), res_(db) {}
-  ~Cursor() { db_.stmt_close(); }
+  Cursor(BackendIface &db) : db_(db), owns_stmt_(true), res_(db) {}
+  ~Cursor() {
+    if (owns_stmt_) {
+      db_.stmt_close();
+    }
+  }
   bool has_next() const noexcept { return status_ == ExecStatus::Row; }
 
+  // Hands the statement to a PrefetchCursor; call before the first next()
+  PrefetchCursor<value_type> prefetch(std::size_t rows) &&;
+
   bool next() {
     auto fields = structure_to_tuple(row_);
     res_.bind_result(fields);
     status_ = res_.fetch();
     if (status_ == ExecStatus::Truncated) {
       res_.fetch_for_each(fields);
-      row_ = to_struct<Entity>(fields);
       status_ = ExecStatus::Row;
     }
+    // fields holds copies of the members, also for rows without text
+    if (status_ == ExecStatus::Row) {
+      res_.reset_nulls(fields);
+      row_ = to_struct<Entity>(fields);
+    }
     return status_ == ExecStatus::Row;
   }
 
 private:
   BackendIface &db_;
+  bool owns_stmt_;
   ExecStatus status_;
   Entity row_;
   Result<
@@ -301,26 +393,240 @@ public:
   using base_type = CursorBase<Cursor<value_type>, value_type>;
   using base_type::base_type;
 
-  Cursor(BackendIface &db) : db_(db), res_(db) { res_.bind_result(row_); }
-  ~Cursor() { db_.stmt_close(); }
+  Cursor(BackendIface &db) : db_(db), owns_stmt_(true), res_(db) {
+    res_.bind_result(row_);
+  }
+  ~Cursor() {
+    if (owns_stmt_) {
+      db_.stmt_close();
+    }
+  }
   bool has_next() const noexcept { return status_ == ExecStatus::Row; }
 
+  // Hands the statement to a PrefetchCursor; call before the first next()
+  PrefetchCursor<value_type> prefetch(std::size_t rows) &&;
+
   bool next() {
+    res_.engage_optionals(row_);
     status_ = res_.fetch();
-    if (status_ == ExecStatus::Truncated) {
+    // views are refreshed on every row, also when nothing was truncated
+    if (status_ == ExecStatus::Truncated ||
+        (has_row_view_v<value_type> && status_ == ExecStatus::Row)) {
       res_.fetch_for_each(row_);
       status_ = ExecStatus::Row;
     }
+    if (status_ == ExecStatus::Row) {
+      res_.reset_nulls(row_);
+    }
     return status_ == ExecStatus::Row;
   }
 
 private:
   BackendIface &db_;
+  bool owns_stmt_;
   ExecStatus status_;
   std::tuple<Ts...> row_;
   Result<sizeof...(Ts)> res_;
   friend class CursorTraits<value_type>;
 };
+
+// Row of a select with joins; std::optional<Entity> marks a LEFT JOIN
+template <typename... Ts> struct Joined {};
+
+namespace detail {
+template <typename Entity>
+inline constexpr std::size_t field_count_v = std::tuple_size_v<decltype(
+    structure_to_tuple(std::declval<Entity &>()))>;
+
+template <typename Entity> constexpr std::size_t pk_index() {
+  constexpr auto table = Table<Entity>::meta();
+  for (std::size_t i = 0; i < table.columns.size(); i++) {
+    if (table.columns[i].is_primary_key()) {
+      return i;
+    }
+  }
+  return 0;
+}
+} // namespace detail
+
+/*
+ * Rows are std::tuple<Ts...>, decoded from the columns of all entities in
+ * order. A left joined entity without a match comes back as an empty
+ * optional, detected by its NULL primary key.
+ */
+template <typename... Ts>
+class Cursor<Joined<Ts...>>
+    : public CursorBase<Cursor<Joined<Ts...>>, std::tuple<Ts...>> {
+public:
+  using value_type = std::tuple<Ts...>;
+  using base_type = CursorBase<Cursor<Joined<Ts...>>, value_type>;
+  using base_type::base_type;
+
+  Cursor(BackendIface &db) : db_(db), res_(db) {}
+  ~Cursor() { db_.stmt_close(); }
+  bool has_next() const noexcept { return status_ == ExecStatus::Row; }
+
+  bool next() {
+    auto fields = std::apply(
+        [](auto &...e) { return std::tuple_cat(structure_to_tuple(e)...); },
+        blank_);
+    res_.bind_result(fields);
+    status_ = res_.fetch();
+    if (status_ == ExecStatus::Truncated) {
+      res_.fetch_for_each(fields);
+      status_ = ExecStatus::Row;
+    }
+    if (status_ == ExecStatus::Row) {
+      res_.reset_nulls(fields);
+      [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (assign<Is>(fields), ...);
+      }(std::index_sequence_for<Ts...>{});
+    }
+    return status_ == ExecStatus::Row;
+  }
+
+private:
+  using entities_type = std::tuple<detail::unwrap_optional_t<Ts>...>;
+  static constexpr std::array<std::size_t, sizeof...(Ts) + 1> offsets_ = [] {
+    std::array<std::size_t, sizeof...(Ts) + 1> offsets{};
+    std::size_t counts[] = {
+        detail::field_count_v<detail::unwrap_optional_t<Ts>>...};
+    for (std::size_t i = 0; i < sizeof...(Ts); i++) {
+      offsets[i + 1] = offsets[i] + counts[i];
+    }
+    return offsets;
+  }();
+
+  BackendIface &db_;
+  ExecStatus status_;
+  entities_type blank_; // shape of the bound columns
+  value_type row_;
+  Result<offsets_.back()> res_;
+  friend class CursorTraits<value_type>;
+
+  template <std::size_t I, typename Fields> void assign(Fields &fields) {
+    using T = std::tuple_element_t<I, value_type>;
+    using E = detail::unwrap_optional_t<T>;
+    constexpr std::size_t first = offsets_[I];
+    if constexpr (detail::is_optional_v<T>) {
+      if (res_.is_null(int(first + detail::pk_index<E>()))) {
+        std::get<I>(row_).reset();
+        return;
+      }
+    }
+    std::get<I>(row_) = [&]<std::size_t... Js>(std::index_sequence<Js...>) {
+      return E{std::move(std::get<first + Js>(fields))...};
+    }(std::make_index_sequence<detail::field_count_v<E>>{});
+  }
+};
+
+/*
+ * Cursor whose rows are fetched and decoded by a producer thread into a
+ * bounded single-producer/single-consumer ring, so fetching overlaps with
+ * processing. The producer blocks while the ring is full. Destroying the
+ * cursor early stops the producer and closes the statement.
+ *
+ * The backend belongs to the producer until the cursor is destroyed; do
+ * not run other statements on it in the meantime.
+ */
+template <typename T>
+class PrefetchCursor : public CursorBase<PrefetchCursor<T>, T> {
+public:
+  using value_type = T;
+
+  PrefetchCursor(BackendIface &db, std::size_t rows)
+      : capacity_(std::max<std::size_t>(rows, 1)),
+        slots_(std::make_unique<T[]>(capacity_)), head_(0), tail_(0),
+        has_row_(false), producer_([this, &db] { produce(db); }) {}
+
+  ~PrefetchCursor() {
+    head_.fetch_or(stop_bit, std::memory_order_release);
+    head_.notify_one();
+    producer_.join();
+  }
+
+  PrefetchCursor(const PrefetchCursor &) = delete;
+  PrefetchCursor &operator=(const PrefetchCursor &) = delete;
+
+  bool has_next() const noexcept { return has_row_; }
+
+  bool next() {
+    std::size_t head = head_.load(std::memory_order_relaxed) & ~stop_bit;
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    while (head == (tail & ~done_bit)) {
+      if (tail & done_bit) {
+        has_row_ = false;
+        if (error_) {
+          std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+        return false;
+      }
+      tail_.wait(tail, std::memory_order_acquire);
+      tail = tail_.load(std::memory_order_acquire);
+    }
+    row_ = std::move(slots_[head % capacity_]);
+    head_.store(head + 1, std::memory_order_release);
+    head_.notify_one();
+    has_row_ = true;
+    return true;
+  }
+
+private:
+  // Flags kept in the top bit of the ring counters
+  static constexpr std::size_t done_bit = std::size_t{1}
+                                          << (sizeof(std::size_t) * 8 - 1);
+  static constexpr std::size_t stop_bit = done_bit;
+
+  const std::size_t capacity_;
+  std::unique_ptr<T[]> slots_;
+  std::atomic<std::size_t> head_; // consumed rows | stop_bit
+  std::atomic<std::size_t> tail_; // produced rows | done_bit
+  std::exception_ptr error_;
+  bool has_row_;
+  T row_;
+  std::thread producer_;
+  friend class CursorTraits<value_type>;
+
+  void produce(BackendIface &db) {
+    try {
+      Cursor<T> cursor{db};
+      std::size_t tail = 0;
+      while (true) {
+        std::size_t head = head_.load(std::memory_order_acquire);
+        while (!(head & stop_bit) && tail - head == capacity_) {
+          head_.wait(head, std::memory_order_acquire);
+          head = head_.load(std::memory_order_acquire);
+        }
+        if ((head & stop_bit) || !cursor.next()) {
+          break;
+        }
+        slots_[tail % capacity_] = std::move(cursor.current());
+        tail_.store(++tail, std::memory_order_release);
+        tail_.notify_one();
+      }
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+    tail_.fetch_or(done_bit, std::memory_order_release);
+    tail_.notify_one();
+  }
+};
+
+template <typename Entity>
+PrefetchCursor<Entity> Cursor<Entity>::prefetch(std::size_t rows) && {
+  static_assert(!has_row_view_v<Entity>, "Row views cannot be prefetched");
+  owns_stmt_ = false;
+  return PrefetchCursor<Entity>{db_, rows};
+}
+
+template <typename... Ts>
+PrefetchCursor<std::tuple<Ts...>>
+Cursor<std::tuple<Ts...>>::prefetch(std::size_t rows) && {
+  static_assert(!has_row_view_v<std::tuple<Ts...>>,
+                "Row views cannot be prefetched");
+  owns_stmt_ = false;
+  return PrefetchCursor<std::tuple<Ts...>>{db_, rows};
+}
 } // namespace sqlinq
 
 #endif // SQLINQ_CURSOR_HPP_
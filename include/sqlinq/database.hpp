@@ -1,18 +1,26 @@
 #ifndef SQLINQ_DATABASE_HPP_
 #define SQLINQ_DATABASE_HPP_
 
+#include <algorithm>
 #include <cstring>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "backend/backend_iface.hpp"
+#include "eager_load.hpp"
 #include "query.hpp"
 #include "query_ast.hpp"
+#include "query_cache.hpp"
+#include "row_table.hpp"
 #include "sql_generator.hpp"
 #include "sqlinq/cursor.hpp"
+#include "tracked.hpp"
 
 #define SQLITE_DATA_TRUNCATED 102
 
@@ -27,31 +35,39 @@ template <std::size_t N> constexpr auto store_string(const std::string &&str) {
   return store_string_impl(str, std::make_index_sequence<N>{});
 }
 
+/*
+ * SQL text together with its parameters. Parameters may point into the
+ * entity the statement was built from; use BoundValue::clone() to detach.
+ */
+struct Statement {
+  std::string sql;
+  std::vector<BoundValue> params;
+};
+
 class Database {
 public:
-  Database(BackendIface &backend) : backend_(backend) {}
+  // With a cache, select results are served from it by to_vector() and
+  // mutations made here invalidate the written table.
+  Database(BackendIface &backend, QueryCache *cache = nullptr)
+      : backend_(backend), cache_(cache) {}
 
+  // Inserts the entity and reads back the stored row when the backend
+  // supports RETURNING, otherwise only the autoincrement key is filled in.
   template <typename Entity> auto create(Entity &entity) {
-    static constexpr auto table_schema = Table<Entity>::meta();
-    static constexpr auto cols = table_schema.columns.filter(
-        [](ColumnInfo const &c) { return !c.is_autoincrement(); });
-    std::vector<std::string_view> columns;
-    std::vector<BoundValue> params;
-    for (auto &col : cols.span()) {
-      columns.emplace_back(col.name());
-      params.emplace_back(bind_value(entity, col));
+    Statement stmt = insert_statement(entity);
+    if (backend_.supports_returning(QueryAst::Operation::Insert)) {
+      stmt.sql += SqlGenerator::build_returning(returning_columns<Entity>());
+      start(stmt);
+      changed(Table<Entity>::meta().name);
+      Cursor<Entity> cursor{backend_};
+      if (cursor.next()) {
+        entity = std::move(cursor.current());
+      }
+      return entity;
     }
-    std::string query = SqlGenerator::build_insert(table_schema.name, columns);
-    /*static constexpr auto query = store_string<*/
-    /*    SqlGenerator::build_insert(table_schema.name, columns).size()>(*/
-    /*    SqlGenerator::build_insert(table_schema.name, columns));*/
-    std::cout << std::string_view{query.data(), query.size()} << '\n';
-    backend_.stmt_init();
-    backend_.stmt_prepare(std::string_view{query.data(), query.size()});
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
-    backend_.stmt_close();
-    entity.id = static_cast<int>(backend_.last_inserted_rowid());
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
+    set_autoincrement_pk(entity, backend_.last_inserted_rowid());
     return entity;
   }
 
@@ -70,12 +86,14 @@ public:
         FilterExpr::Kind::Leaf, ValueCondition{ValueCondition::Operator::Equal,
                                                BoundValue{std::move(val)}, 0}};
     ast.filter_chain.front().condition.column_name = pk_cols.span()[0].name();
+    ast.filter_chain.front().condition.value.set_storage(
+        pk_cols.span()[0].storage());
     std::vector<BoundValue> params = ast.filter_chain.extract_values();
 
     std::string query = SqlGenerator::build_select(ast);
-    std::cout << std::string_view{query.data(), query.size()} << '\n';
     backend_.stmt_init();
     backend_.stmt_prepare(std::string_view{query.data(), query.size()});
+    backend_.stmt_fetch_strategy(FetchStrategy::buffered());
     backend_.bind_params(std::span{params.data(), params.size()});
     backend_.stmt_execute();
 
@@ -102,62 +120,265 @@ public:
     return Cursor<Entity>{backend_};
   }
 
-  template <typename Entity> void remove(auto &&val) {
+  // Smallest and largest primary key, nullopt for an empty table
+  template <typename Entity>
+  auto pk_bounds() -> std::optional<std::pair<int64_t, int64_t>> {
     static constexpr auto table_schema = Table<Entity>::meta();
     using pk_type = typename decltype(table_schema)::pk_type;
-    static_assert(std::is_same_v<std::decay_t<decltype(val)>, pk_type>,
-                  "remove() must be called with pk_type");
+    static_assert(std::is_integral_v<pk_type>,
+                  "pk_bounds() requires an integral primary key");
 
-    static constexpr auto pk_cols = table_schema.columns.filter(
-        [](ColumnInfo const &c) { return c.is_primary_key(); });
+    std::string pk{pk_name<Entity>()};
+    std::string min = "MIN(" + pk + ')';
+    std::string max = "MAX(" + pk + ')';
     QueryAst ast;
+    ast.op = QueryAst::Operation::Select;
     ast.table_name = table_schema.name;
-    ast.filter_chain = FilterChain{
-        FilterExpr::Kind::Leaf, ValueCondition{ValueCondition::Operator::Equal,
-                                               BoundValue{std::move(val)}, 0}};
-    ast.filter_chain.front().condition.column_name = pk_cols.span()[0].name();
-    std::vector<BoundValue> params = ast.filter_chain.extract_values();
+    ast.column_names = {"COUNT(*)", min, max};
+    Statement stmt;
+    stmt.sql = SqlGenerator::build_select(ast);
+    start(stmt);
 
-    std::string query = SqlGenerator::build_delete(ast);
-    std::cout << std::string_view{query.data(), query.size()} << '\n';
-    backend_.stmt_init();
-    backend_.stmt_prepare(std::string_view{query.data(), query.size()});
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
-    backend_.stmt_close();
+    Cursor<std::tuple<int64_t, int64_t, int64_t>> cursor{backend_};
+    if (!cursor.next() || std::get<0>(cursor.current()) == 0) {
+      return std::nullopt;
+    }
+    return std::pair{std::get<1>(cursor.current()),
+                     std::get<2>(cursor.current())};
+  }
+
+  // Rows with first <= pk <= last in key order
+  template <typename Entity>
+  auto get_range(int64_t first, int64_t last) -> Cursor<Entity> {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    static constexpr column::Storage pk_storage =
+        table_schema.pk_column.info().storage();
+    const char *pk = pk_name<Entity>();
+    QueryAst ast;
+    ast.op = QueryAst::Operation::Select;
+    ast.table_name = table_schema.name;
+    ast.column_names = returning_columns<Entity>();
+    ast.order_expr.push_back(pk);
+    FilterChain lower{FilterExpr::Kind::Leaf,
+                      ValueCondition{ValueCondition::Operator::GreaterEqual,
+                                     BoundValue{first}, 0}};
+    lower.front().condition.column_name = pk;
+    lower.front().condition.value.set_storage(pk_storage);
+    FilterChain upper{FilterExpr::Kind::Leaf,
+                      ValueCondition{ValueCondition::Operator::LessEqual,
+                                     BoundValue{last}, 1}};
+    upper.front().condition.column_name = pk;
+    upper.front().condition.value.set_storage(pk_storage);
+    ast.filter_chain = std::move(lower) && std::move(upper);
+
+    Statement stmt;
+    stmt.sql = SqlGenerator::build_select(ast);
+    stmt.params = ast.filter_chain.extract_values();
+    start(stmt);
+    return Cursor<Entity>{backend_};
+  }
+
+  template <typename Entity> void remove(auto &&val) {
+    Statement stmt = remove_statement<Entity>(std::forward<decltype(val)>(val));
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
   }
 
   template <typename Entity> void update(const Entity &entity) {
+    Statement stmt = update_statement(entity);
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
+  }
+
+  // Writes only the changed columns; returns false when nothing changed
+  // and no statement was run. A changed primary key is not written; it is
+  // reverted once the row is updated, so the entity keeps matching it.
+  template <typename Entity> bool update(Tracked<Entity> &tracked) {
+    std::vector<std::size_t> changed = tracked.changed_columns();
+    std::erase_if(changed, [](std::size_t idx) {
+      const ColumnInfo &col = Table<Entity>::meta().columns[idx];
+      return col.is_primary_key() || col.is_autoincrement();
+    });
+    if (changed.empty()) {
+      return false;
+    }
+    Statement stmt =
+        update_statement(tracked.get(), tracked.snapshot(), changed);
+    execute(stmt);
+    this->changed(Table<Entity>::meta().name);
+    tracked.revert_keys();
+    tracked.reset();
+    return true;
+  }
+
+  // Inserts the entity, or updates it when a row with the same primary key
+  // exists. An autoincrement key equal to zero always inserts a new row.
+  template <typename Entity> void save(Entity &entity) {
+    if (is_new(entity)) {
+      create(entity);
+      return;
+    }
+    const Entity *row = &entity;
+    Statement stmt = upsert_statement(std::span<const Entity *const>{&row, 1},
+                                      backend_.dialect());
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
+  }
+
+  // New entities are inserted with one prepared statement run per row,
+  // which fills in their autoincrement keys; the others are upserted with
+  // multi-row statements.
+  template <typename Entity> void save(std::span<Entity> entities) {
+    static constexpr std::size_t max_params = 999;
+    static constexpr std::size_t rows_per_stmt = std::max<std::size_t>(
+        1, max_params / Table<Entity>::meta().columns.size());
+
+    std::vector<Entity *> created;
+    std::vector<const Entity *> existing;
+    for (Entity &entity : entities) {
+      if (is_new(entity)) {
+        created.push_back(&entity);
+      } else {
+        existing.push_back(&entity);
+      }
+    }
+    create_all(std::span<Entity *const>{created});
+    std::span<const Entity *const> rows{existing};
+    while (!rows.empty()) {
+      std::size_t n = std::min(rows.size(), rows_per_stmt);
+      Statement stmt = upsert_statement(rows.first(n), backend_.dialect());
+      execute(stmt);
+      rows = rows.subspan(n);
+    }
+    changed(Table<Entity>::meta().name);
+  }
+
+  // Runs a prebuilt statement which does not return rows.
+  void execute(Statement &stmt) {
+    start(stmt);
+    backend_.stmt_close();
+  }
+
+  // Autoincrement columns are left to the database unless with_autoincrement
+  // is set, e.g. when the key is assigned by the caller.
+  template <typename Entity>
+  static Statement insert_statement(const Entity &entity,
+                                    bool with_autoincrement = false) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    std::vector<std::string_view> columns;
+    Statement stmt;
+    for (auto &col : table_schema.columns) {
+      if (col.is_autoincrement() && !with_autoincrement) {
+        continue;
+      }
+      columns.emplace_back(col.name());
+      stmt.params.emplace_back(bind_value(entity, col));
+    }
+    stmt.sql = SqlGenerator::build_insert(table_schema.name, columns);
+    return stmt;
+  }
+
+  template <typename Entity>
+  static Statement update_statement(const Entity &entity) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    std::vector<std::size_t> columns;
+    for (std::size_t i = 0; i < table_schema.columns.size(); i++) {
+      columns.push_back(i);
+    }
+    return update_statement(entity, entity, columns);
+  }
+
+  // UPDATE of the given meta column indexes of `entity`, matching the row
+  // by the primary key of `key`. Key and autoincrement columns are skipped.
+  template <typename Entity>
+  static Statement update_statement(const Entity &entity, const Entity &key,
+                                    std::span<const std::size_t> columns) {
     static constexpr auto table_schema = Table<Entity>::meta();
     static constexpr auto pk_cols = table_schema.columns.filter(
         [](ColumnInfo const &c) { return c.is_primary_key(); });
-    static constexpr auto cols =
-        table_schema.columns.filter([](ColumnInfo const &c) {
-          return !c.is_primary_key() && !c.is_autoincrement();
-        });
 
     QueryAst ast;
     ast.table_name = table_schema.name;
     ast.filter_chain =
         FilterChain{FilterExpr::Kind::Leaf,
                     ValueCondition{ValueCondition::Operator::Equal,
-                                   bind_value(entity, pk_cols.span()[0]), 0}};
+                                   bind_value(key, pk_cols.span()[0]), 0}};
     ast.filter_chain.front().condition.column_name = pk_cols.span()[0].name();
-    std::vector<BoundValue> params;
 
-    std::vector<std::string_view> columns;
-    for (auto &col : cols.span()) {
+    Statement stmt;
+    for (std::size_t idx : columns) {
+      const ColumnInfo &col = table_schema.columns[idx];
+      if (col.is_primary_key() || col.is_autoincrement()) {
+        continue;
+      }
       ast.column_names.push_back(col.name());
-      params.emplace_back(bind_value(entity, col));
+      stmt.params.emplace_back(bind_value(entity, col));
     }
-    params.emplace_back(std::move(ast.filter_chain.front().condition.value));
-    std::string query = SqlGenerator::build_update(ast);
-    std::cout << std::string_view{query.data(), query.size()} << '\n';
-    backend_.stmt_init();
-    backend_.stmt_prepare(std::string_view{query.data(), query.size()});
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
-    backend_.stmt_close();
+    stmt.params.emplace_back(
+        std::move(ast.filter_chain.front().condition.value));
+    stmt.sql = SqlGenerator::build_update(ast);
+    return stmt;
+  }
+
+  template <typename Entity>
+  static Statement remove_statement(auto &&val) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    using pk_type = typename decltype(table_schema)::pk_type;
+    static_assert(std::is_same_v<std::decay_t<decltype(val)>, pk_type>,
+                  "remove() must be called with pk_type");
+
+    static constexpr auto pk_cols = table_schema.columns.filter(
+        [](ColumnInfo const &c) { return c.is_primary_key(); });
+    QueryAst ast;
+    ast.table_name = table_schema.name;
+    ast.filter_chain = FilterChain{
+        FilterExpr::Kind::Leaf, ValueCondition{ValueCondition::Operator::Equal,
+                                               BoundValue{std::move(val)}, 0}};
+    ast.filter_chain.front().condition.column_name = pk_cols.span()[0].name();
+    ast.filter_chain.front().condition.value.set_storage(
+        pk_cols.span()[0].storage());
+
+    Statement stmt;
+    stmt.params = ast.filter_chain.extract_values();
+    stmt.sql = SqlGenerator::build_delete(ast);
+    return stmt;
+  }
+
+  template <typename Entity>
+  static Statement insert_statement(InsertQuery<Entity> &q,
+                                    SqlDialect dialect) {
+    return dml_statement(q.ast_, dialect);
+  }
+
+  // Multi-row upsert of all columns with the primary key as conflict target
+  template <typename Entity>
+  static Statement upsert_statement(std::span<const Entity *const> entities,
+                                    SqlDialect dialect) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    QueryAst ast;
+    ast.op = QueryAst::Operation::Upsert;
+    ast.table_name = table_schema.name;
+    for (auto &col : table_schema.columns) {
+      ast.column_names.push_back(col.name());
+      if (col.is_primary_key()) {
+        ast.conflict_columns.push_back(col.name());
+      }
+    }
+
+    Statement stmt;
+    stmt.params.reserve(entities.size() * ast.column_names.size());
+    for (const Entity *entity : entities) {
+      for (auto &col : table_schema.columns) {
+        stmt.params.emplace_back(bind_value(*entity, col));
+      }
+    }
+    stmt.sql = SqlGenerator::build_upsert(ast, dialect, entities.size());
+    return stmt;
+  }
+
+  template <typename Entity>
+  static Statement where_statement(WhereQuery<Entity> &q, SqlDialect dialect) {
+    return dml_statement(q.ast_, dialect);
   }
 
   uint64_t last_inserted_rowid() const noexcept {
@@ -165,73 +386,459 @@ public:
   }
 
   template <typename Entity> void execute(InsertQuery<Entity> &q) {
-    std::string sql =
-        SqlGenerator::build_insert(q.ast_.table_name, q.ast_.column_names);
-    std::cout << sql << '\n';
-    std::vector<BoundValue> params = std::move(q.ast_.values);
-    backend_.stmt_init();
-    backend_.stmt_prepare(sql);
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
-    backend_.stmt_close();
+    Statement stmt = insert_statement(q, backend_.dialect());
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
   }
 
   template <typename Entity> void execute(WhereQuery<Entity> &q) {
-    std::string sql = (q.ast_.op == QueryAst::Operation::Update)
-                          ? SqlGenerator::build_update(q.ast_)
-                          : SqlGenerator::build_delete(q.ast_);
-    std::cout << sql << '\n';
-    std::vector<BoundValue> params = std::move(q.ast_.values);
-    for (auto &&v : q.ast_.filter_chain.extract_values()) {
-      params.emplace_back(std::move(v));
+    Statement stmt = where_statement(q, backend_.dialect());
+    execute(stmt);
+    changed(Table<Entity>::meta().name);
+  }
+
+  /*
+   * Streams the rows written by the query. Without RETURNING support the
+   * statement is followed by a SELECT by key. An update first locks and
+   * reads the keys of the matching rows in a transaction; the rows are
+   * selected after it commits. Deletes need RETURNING, see to_vector().
+   */
+  template <typename Entity>
+  [[nodiscard]] auto execute(ReturningQuery<Entity> &q) -> Cursor<Entity> {
+    QueryAst &ast = q.ast_;
+    if (backend_.supports_returning(ast.op)) {
+      Statement stmt = dml_statement(ast, backend_.dialect());
+      stmt.sql += SqlGenerator::build_returning(ast.returning_columns);
+      start(stmt);
+      changed(ast.table_name);
+      return Cursor<Entity>{backend_};
     }
-    backend_.stmt_init();
-    backend_.stmt_prepare(sql);
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
-    backend_.stmt_close();
+    if (ast.op == QueryAst::Operation::Delete) {
+      throw std::runtime_error(
+          "DELETE ... RETURNING is not supported by the server, "
+          "use to_vector()");
+    }
+
+    QueryAst select;
+    select.op = QueryAst::Operation::Select;
+    select.table_name = ast.table_name;
+    select.column_names = ast.returning_columns;
+    if (ast.op == QueryAst::Operation::Update) {
+      in_transaction([&] { select.filter_chain = update_locked<Entity>(ast); });
+    } else {
+      std::vector<std::string_view> keys = insert_keys<Entity>(ast);
+      for (auto key : keys) {
+        auto it = std::find(ast.column_names.begin(), ast.column_names.end(),
+                            key);
+        auto idx = std::size_t(it - ast.column_names.begin());
+        select.filter_chain = match_column(std::move(select.filter_chain), key,
+                                           ast.values[idx].clone());
+      }
+      Statement stmt = dml_statement(ast, backend_.dialect());
+      execute(stmt);
+      if (keys.empty()) {
+        select.filter_chain = match_column(
+            FilterChain{}, Table<Entity>::meta().pk_column.name(),
+            BoundValue{static_cast<int64_t>(backend_.last_inserted_rowid())});
+      }
+    }
+
+    changed(ast.table_name);
+
+    Statement stmt;
+    stmt.sql = SqlGenerator::build_select(select);
+    stmt.params = select.filter_chain.extract_values();
+    start(stmt);
+    return Cursor<Entity>{backend_};
+  }
+
+  template <typename Entity>
+  [[nodiscard]] auto to_vector(ReturningQuery<Entity> &q) {
+    std::vector<Entity> entities;
+    QueryAst &ast = q.ast_;
+    if (ast.op == QueryAst::Operation::Delete &&
+        !backend_.supports_returning(ast.op)) {
+      // read the rows first, then delete them in the same transaction;
+      // the read locks them so no other row can match in between
+      QueryAst select;
+      select.op = QueryAst::Operation::Select;
+      select.table_name = ast.table_name;
+      select.column_names = ast.returning_columns;
+      select.filter_chain = ast.filter_chain.clone();
+      Statement stmt;
+      stmt.sql = SqlGenerator::build_select(select);
+      if (backend_.dialect() == SqlDialect::MySQL) {
+        stmt.sql += " FOR UPDATE";
+      }
+      stmt.params = select.filter_chain.extract_values();
+      in_transaction([&] {
+        start(stmt);
+        {
+          Cursor<Entity> cursor{backend_};
+          while (cursor.next()) {
+            entities.emplace_back(std::move(cursor.current()));
+          }
+        }
+        Statement del = dml_statement(ast, backend_.dialect());
+        execute(del);
+      });
+      changed(ast.table_name);
+      return entities;
+    }
+    if (ast.op == QueryAst::Operation::Update &&
+        !backend_.supports_returning(ast.op)) {
+      // unlike execute(), the updated rows are read before the commit
+      QueryAst select;
+      select.op = QueryAst::Operation::Select;
+      select.table_name = ast.table_name;
+      select.column_names = ast.returning_columns;
+      in_transaction([&] {
+        select.filter_chain = update_locked<Entity>(ast);
+        start_select(select);
+        Cursor<Entity> cursor{backend_};
+        while (cursor.next()) {
+          entities.emplace_back(std::move(cursor.current()));
+        }
+      });
+      changed(ast.table_name);
+      return entities;
+    }
+
+    Cursor<Entity> cursor = execute(q);
+    while (cursor.next()) {
+      entities.emplace_back(std::move(cursor.current()));
+    }
+    return entities;
   }
 
   template <typename Entity, typename... Ts>
   [[nodiscard]] auto execute(SelectQuery<Entity, Ts...> &q) {
     using return_type =
         std::conditional_t<(sizeof...(Ts) > 0), std::tuple<Ts...>, Entity>;
-    std::string sql = SqlGenerator::build_select(q.ast_);
-    std::cout << sql << '\n';
-    std::vector<BoundValue> params = q.ast_.filter_chain.extract_values();
-    backend_.stmt_init();
-    backend_.stmt_prepare(sql);
-    backend_.bind_params(std::span{params.data(), params.size()});
-    backend_.stmt_execute();
+    start_select(q.ast_);
     return Cursor<return_type>{backend_};
   }
 
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto execute(JoinQuery<Entity, Ts...> &q) {
+    start_select(q.ast_);
+    return Cursor<Joined<Entity, Ts...>>{backend_};
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_vector(JoinQuery<Entity, Ts...> &q) {
+    std::vector<std::tuple<Entity, Ts...>> rows;
+    auto cursor = execute(q);
+    while (cursor.next()) {
+      rows.emplace_back(std::move(cursor.current()));
+    }
+    return rows;
+  }
+
+  /*
+   * Select which loads related entities with one batched query per
+   * include() instead of one per row:
+   *   db.load(q).include(&Comment::post_id).to_vector()
+   */
+  template <typename Entity> [[nodiscard]] auto load(SelectQuery<Entity> &q) {
+    return EagerLoader<Database, Entity>{*this, q};
+  }
+
+  /*
+   * Read-only variant of execute(): rows are tuples in which std::string and
+   * Blob columns become TextView and BlobView pointing into the row buffer
+   * of the backend, so no text is copied. A view is valid until the cursor
+   * fetches the next row; debug builds assert on later access.
+   */
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto execute_view(SelectQuery<Entity, Ts...> &q) {
+    using row_type = std::conditional_t<
+        (sizeof...(Ts) > 0), std::tuple<Ts...>,
+        decltype(structure_to_tuple(std::declval<Entity &>()))>;
+    start_select(q.ast_);
+    return Cursor<row_view_t<row_type>>{backend_};
+  }
+
+  /*
+   * Materializes the result into a column-wise RowTable. Text and blob
+   * columns are copied straight from the backend into the table's arena.
+   * reserve_rows, e.g. from a count() of the same filter, avoids regrowing
+   * the columns.
+   */
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_table(SelectQuery<Entity, Ts...> &q,
+                              std::size_t reserve_rows = 0) {
+    using return_type =
+        std::conditional_t<(sizeof...(Ts) > 0), std::tuple<Ts...>, Entity>;
+    RowTable<return_type> table;
+    table.reserve(reserve_rows);
+    auto cursor = execute_view(q);
+    while (cursor.next()) {
+      table.push_back(cursor.current());
+    }
+    return table;
+  }
+
   template <typename Entity, typename... Ts>
   [[nodiscard]] auto to_vector(SelectQuery<Entity, Ts...> &q) {
     using return_type =
         std::conditional_t<(sizeof...(Ts) > 0), std::tuple<Ts...>, Entity>;
     std::string sql = SqlGenerator::build_select(q.ast_);
-    std::cout << sql << '\n';
-    std::vector<BoundValue> params = q.ast_.filter_chain.extract_values();
+    std::vector<BoundValue> params = select_params(q.ast_);
+    std::string key;
+    uint64_t version = 0;
+    if (cache_ != nullptr) {
+      key = QueryCache::fingerprint(sql, params);
+      version = cache_->version(q.ast_.table_name);
+      if (auto rows = cache_->get<return_type>(key, q.ast_.table_name)) {
+        return *rows;
+      }
+    }
     backend_.stmt_init();
     backend_.stmt_prepare(sql);
+    backend_.stmt_fetch_strategy(q.ast_.fetch_strategy);
     backend_.bind_params(std::span{params.data(), params.size()});
     backend_.stmt_execute();
 
     std::vector<return_type> entities;
-    Cursor<return_type> cursor{backend_};
-    while (cursor.next()) {
-      auto &row = cursor.current();
-      entities.emplace_back(std::move(row));
+    {
+      Cursor<return_type> cursor{backend_};
+      while (cursor.next()) {
+        auto &row = cursor.current();
+        entities.emplace_back(std::move(row));
+      }
+    }
+    if (cache_ != nullptr) {
+      cache_->put(key, q.ast_.table_name, version, entities);
     }
     return entities;
   }
 
 private:
   BackendIface &backend_;
+  QueryCache *cache_;
+
+  void changed(std::string_view table) {
+    if (cache_ != nullptr) {
+      cache_->invalidate(table);
+    }
+  }
+
+  // Inserts the entities with a single prepared INSERT, binding each row
+  template <typename Entity> void create_all(std::span<Entity *const> rows) {
+    if (rows.empty()) {
+      return;
+    }
+    static constexpr auto table_schema = Table<Entity>::meta();
+    Statement stmt = insert_statement(*rows.front());
+    backend_.stmt_init();
+    try {
+      backend_.stmt_prepare(stmt.sql);
+      for (Entity *entity : rows) {
+        stmt.params.clear();
+        for (auto &col : table_schema.columns) {
+          if (!col.is_autoincrement()) {
+            stmt.params.emplace_back(bind_value(*entity, col));
+          }
+        }
+        backend_.bind_params(std::span{stmt.params.data(), stmt.params.size()});
+        backend_.stmt_execute();
+        set_autoincrement_pk(*entity, backend_.last_inserted_rowid());
+      }
+    } catch (...) {
+      backend_.stmt_close();
+      throw;
+    }
+    backend_.stmt_close();
+  }
+
+  // Runs fn in a transaction which is rolled back when fn throws
+  template <typename Fn> void in_transaction(Fn &&fn) {
+    Statement begin{backend_.dialect() == SqlDialect::SQLite
+                        ? "BEGIN IMMEDIATE"
+                        : "START TRANSACTION",
+                    {}};
+    execute(begin);
+    try {
+      std::forward<Fn>(fn)();
+    } catch (...) {
+      try {
+        Statement rollback{"ROLLBACK", {}};
+        execute(rollback);
+      } catch (...) {
+      }
+      throw;
+    }
+    Statement commit{"COMMIT", {}};
+    execute(commit);
+  }
+
+  /*
+   * Reads the primary keys of the rows matching the filter of an UPDATE,
+   * locking them on MySQL, then runs it. Returns a filter selecting the
+   * updated rows by those keys. Call inside in_transaction().
+   */
+  template <typename Entity> FilterChain update_locked(QueryAst &ast) {
+    static constexpr auto table = Table<Entity>::meta();
+    using pk_type = typename decltype(table)::pk_type;
+    QueryAst keys;
+    keys.op = QueryAst::Operation::Select;
+    keys.table_name = ast.table_name;
+    keys.column_names.push_back(table.pk_column.name());
+    keys.filter_chain = ast.filter_chain.clone();
+    Statement select;
+    select.sql = SqlGenerator::build_select(keys);
+    if (backend_.dialect() == SqlDialect::MySQL) {
+      select.sql += " FOR UPDATE";
+    }
+    select.params = keys.filter_chain.extract_values();
+
+    ValueCondition cond{ValueCondition::Operator::In, BoundValue{}, 0};
+    cond.column_name = table.pk_column.name();
+    start(select);
+    {
+      Cursor<std::tuple<pk_type>> cursor{backend_};
+      while (cursor.next()) {
+        cond.list.emplace_back(std::get<0>(cursor.current()));
+        cond.list.back().set_storage(table.pk_column.info().storage());
+      }
+    }
+    Statement update = dml_statement(ast, backend_.dialect());
+    execute(update);
+    return FilterChain{FilterExpr::Kind::Leaf, std::move(cond)};
+  }
+
+  // Prepares, binds and executes stmt, leaving it open for fetching
+  void start_select(QueryAst &ast) {
+    std::string sql = SqlGenerator::build_select(ast);
+    std::vector<BoundValue> params = select_params(ast);
+    backend_.stmt_init();
+    backend_.stmt_prepare(sql);
+    backend_.stmt_fetch_strategy(ast.fetch_strategy);
+    backend_.bind_params(std::span{params.data(), params.size()});
+    backend_.stmt_execute();
+  }
+
+  // Parameters of WHERE, HAVING and qualify(), in the order of the SQL
+  static std::vector<BoundValue> select_params(QueryAst &ast) {
+    std::vector<BoundValue> params = ast.filter_chain.extract_values();
+    for (FilterChain *chain : {&ast.having, &ast.qualify}) {
+      for (auto &&v : chain->extract_values()) {
+        params.emplace_back(std::move(v));
+      }
+    }
+    return params;
+  }
+
+  void start(Statement &stmt) {
+    backend_.stmt_init();
+    try {
+      backend_.stmt_prepare(stmt.sql);
+      backend_.bind_params(std::span{stmt.params.data(), stmt.params.size()});
+      backend_.stmt_execute();
+    } catch (...) {
+      backend_.stmt_close();
+      throw;
+    }
+  }
+
+  static Statement dml_statement(QueryAst &ast, SqlDialect dialect) {
+    Statement stmt;
+    switch (ast.op) {
+    case QueryAst::Operation::Insert:
+      stmt.sql = SqlGenerator::build_insert(ast.table_name, ast.column_names);
+      break;
+    case QueryAst::Operation::Upsert:
+      stmt.sql = SqlGenerator::build_upsert(ast, dialect);
+      break;
+    case QueryAst::Operation::Update:
+      stmt.sql = SqlGenerator::build_update(ast);
+      break;
+    default:
+      stmt.sql = SqlGenerator::build_delete(ast);
+      break;
+    }
+    stmt.params = std::move(ast.values);
+    for (auto &&v : ast.filter_chain.extract_values()) {
+      stmt.params.emplace_back(std::move(v));
+    }
+    return stmt;
+  }
+
+  // Columns identifying an inserted row: the upsert target, or the primary
+  // key when it was given. Empty means the key comes from the backend.
+  template <typename Entity>
+  static std::vector<std::string_view> insert_keys(const QueryAst &ast) {
+    if (ast.op == QueryAst::Operation::Upsert) {
+      return ast.conflict_columns;
+    }
+    std::vector<std::string_view> keys;
+    for (const auto &col : Table<Entity>::meta().columns) {
+      if (col.is_primary_key() &&
+          std::find(ast.column_names.begin(), ast.column_names.end(),
+                    std::string_view{col.name()}) != ast.column_names.end()) {
+        keys.push_back(col.name());
+      }
+    }
+    return keys;
+  }
+
+  static FilterChain match_column(FilterChain &&chain, std::string_view name,
+                                  BoundValue &&value) {
+    FilterChain leaf{FilterExpr::Kind::Leaf,
+                     ValueCondition{ValueCondition::Operator::Equal,
+                                    std::move(value), 0}};
+    leaf.front().condition.column_name = name.data();
+    if (chain.empty()) {
+      return leaf;
+    }
+    return std::move(chain) && std::move(leaf);
+  }
+
+  template <typename Entity> static const char *pk_name() {
+    static constexpr auto pk_cols = Table<Entity>::meta().columns.filter(
+        [](ColumnInfo const &c) { return c.is_primary_key(); });
+    return pk_cols.span()[0].name();
+  }
+
+  template <typename Entity>
+  static std::vector<std::string_view> returning_columns() {
+    std::vector<std::string_view> cols;
+    for (const auto &col : Table<Entity>::meta().columns) {
+      cols.push_back(col.name());
+    }
+    return cols;
+  }
+
+  template <typename Entity>
+  static void set_autoincrement_pk(Entity &entity, uint64_t rowid) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    using pk_type = typename decltype(table_schema)::pk_type;
+    if constexpr (std::is_integral_v<pk_type>) {
+      for (auto &col : table_schema.columns) {
+        if (col.is_primary_key() && col.is_autoincrement()) {
+          char *field = reinterpret_cast<char *>(&entity) + col.offset();
+          *reinterpret_cast<pk_type *>(field) = static_cast<pk_type>(rowid);
+        }
+      }
+    }
+  }
+
+  template <typename Entity> static bool is_new(const Entity &entity) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    using pk_type = typename decltype(table_schema)::pk_type;
+    for (auto &col : table_schema.columns) {
+      if (col.is_primary_key() && col.is_autoincrement()) {
+        const char *field =
+            reinterpret_cast<const char *>(&entity) + col.offset();
+        return *reinterpret_cast<const pk_type *>(field) == pk_type{};
+      }
+    }
+    return false;
+  }
 
   template <typename Entity>
-  BoundValue bind_value(const Entity &entity, const ColumnInfo &info) {
+  static BoundValue bind_value(const Entity &entity, const ColumnInfo &info) {
     std::size_t size = 0;
     const void *data_ptr = nullptr;
     const char *field_addr =
@@ -247,7 +854,9 @@ private:
     } else {
       data_ptr = (void *)field_addr;
     }
-    return BoundValue{data_ptr, size, info.type()};
+    BoundValue value{data_ptr, size, info.type()};
+    value.set_storage(info.storage());
+    return value;
   }
 };
 } // namespace sqlinq
@@ -21,6 +21,18 @@ inline constexpr bool is_optional_v = is_optional<T>::value;
 template <typename T>
 using optional_value_t = typename is_optional<T>::value_type;
 
+// T itself, or U for std::optional<U>
+template <typename T> struct unwrap_optional {
+  using type = T;
+};
+
+template <typename U> struct unwrap_optional<std::optional<U>> {
+  using type = U;
+};
+
+template <typename T>
+using unwrap_optional_t = typename unwrap_optional<T>::type;
+
 template <class, template <class...> class>
 inline constexpr bool is_specialization_of_v = false;
 
@@ -0,0 +1,203 @@
+#ifndef SQLINQ_EAGER_LOAD_HPP_
+#define SQLINQ_EAGER_LOAD_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hash_join.hpp"
+#include "query.hpp"
+
+namespace sqlinq {
+namespace detail {
+// Children of Parent whose member references the primary key of Parent
+template <typename Parent, typename Child, typename T> struct HasMany {
+  using value_type = std::vector<Child>;
+  T Child::*member;
+};
+
+// Parent referenced by member of Owner
+template <typename Parent, typename Owner, typename T> struct BelongsTo {
+  using value_type = std::optional<Parent>;
+  T Owner::*member;
+};
+
+template <typename Entity>
+using pk_type_t = typename decltype(Table<Entity>::meta())::pk_type;
+
+template <typename Entity>
+const pk_type_t<Entity> &primary_key(const Entity &entity) {
+  static constexpr auto table = Table<Entity>::meta();
+  const char *field =
+      reinterpret_cast<const char *>(&entity) + table.pk_column.offset();
+  return *reinterpret_cast<const pk_type_t<Entity> *>(field);
+}
+
+template <typename Owner, typename T>
+const ColumnInfo &include_column(T Owner::*member) {
+  const ColumnInfo *fk = column_info(member);
+  if (fk == nullptr || !fk->is_foreign_key()) {
+    throw std::invalid_argument("include() requires a foreign_key() column");
+  }
+  return *fk;
+}
+} // namespace detail
+
+/*
+ * Select of Entity which also loads related entities, see Database::load().
+ * Every include() costs one SELECT ... WHERE key IN (...) per batch of keys
+ * instead of one query per row; the related rows are matched to the
+ * selected ones through a hash table. Rows are std::tuple<Entity, R...>,
+ * where R is std::vector<Child> or std::optional<Parent> per include().
+ */
+template <typename Db, typename Entity, typename... Rels> class EagerLoader {
+public:
+  using value_type = std::tuple<Entity, typename Rels::value_type...>;
+
+  // Keys per IN list, the bound parameter limit of old SQLite versions
+  static constexpr std::size_t max_keys = 999;
+
+  EagerLoader(Db &db, SelectQuery<Entity> &q, std::tuple<Rels...> rels = {})
+      : db_(db), query_(q), rels_(std::move(rels)) {}
+
+  // Children whose foreign key member references Entity
+  template <typename Child, typename T>
+    requires(!std::is_same_v<Child, Entity>)
+  auto include(T Child::*member) && {
+    detail::include_column(member);
+    return add(detail::HasMany<Entity, Child, T>{member});
+  }
+
+  // Target referenced by the foreign key member of Entity
+  template <typename Target, typename T>
+  auto include(T Entity::*member) && {
+    detail::include_column(member);
+    return add(detail::BelongsTo<Target, Entity, T>{member});
+  }
+
+  // Runs the select, then the batched queries of every include()
+  std::vector<value_type> to_vector() {
+    std::vector<Entity> entities = db_.to_vector(query_);
+    std::vector<value_type> rows;
+    rows.reserve(entities.size());
+    for (Entity &entity : entities) {
+      rows.emplace_back(std::move(entity), typename Rels::value_type{}...);
+    }
+    if (!rows.empty()) {
+      [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (load<Is>(rows, std::get<Is>(rels_)), ...);
+      }(std::index_sequence_for<Rels...>{});
+    }
+    return rows;
+  }
+
+private:
+  Db &db_;
+  SelectQuery<Entity> &query_;
+  std::tuple<Rels...> rels_;
+
+  template <typename Rel> auto add(Rel rel) {
+    return EagerLoader<Db, Entity, Rels..., Rel>{
+        db_, query_, std::tuple_cat(std::move(rels_), std::tuple{rel})};
+  }
+
+  // Calls fn with every Target row whose column is one of keys
+  template <typename Target, typename Key, typename Fn>
+  void select_in(const char *key_column, const std::vector<Key> &keys,
+                 Fn &&fn) {
+    static constexpr auto table = Table<Target>::meta();
+    column::Storage storage = column::Storage::Text;
+    for (const auto &col : table.columns) {
+      if (std::string_view{col.name()} == key_column) {
+        storage = col.storage();
+      }
+    }
+
+    for (std::size_t first = 0; first < keys.size(); first += max_keys) {
+      std::size_t last = std::min(keys.size(), first + max_keys);
+      ValueCondition cond{ValueCondition::Operator::In, BoundValue{}, 0};
+      cond.column_name = key_column;
+      for (std::size_t i = first; i < last; i++) {
+        cond.list.emplace_back(keys[i]);
+        cond.list.back().set_storage(storage);
+      }
+
+      QueryAst ast;
+      ast.op = QueryAst::Operation::Select;
+      ast.table_name = table.name;
+      for (const auto &col : table.columns) {
+        ast.column_names.push_back(col.name());
+      }
+      ast.filter_chain = FilterChain{FilterExpr::Kind::Leaf, std::move(cond)};
+      ast.order_expr.push_back(table.pk_column.name());
+      SelectQuery<Target> q{std::move(ast)};
+      for (Target &row : db_.to_vector(q)) {
+        fn(row);
+      }
+    }
+  }
+
+  template <std::size_t I, typename Child, typename T>
+  void load(std::vector<value_type> &rows,
+            detail::HasMany<Entity, Child, T> &rel) {
+    using Key = std::common_type_t<detail::pk_type_t<Entity>,
+                                   detail::unwrap_optional_t<T>>;
+    std::unordered_map<Key, std::size_t> parents;
+    parents.reserve(rows.size());
+    std::vector<Key> keys;
+    for (std::size_t i = 0; i < rows.size(); i++) {
+      auto key = static_cast<Key>(detail::primary_key(std::get<0>(rows[i])));
+      if (parents.try_emplace(key, i).second) {
+        keys.push_back(key);
+      }
+    }
+
+    const char *fk = detail::include_column(rel.member).name();
+    select_in<Child>(fk, keys, [&](Child &child) {
+      detail::with_join_key<Key>(child, rel.member, [&](const Key &key) {
+        if (auto it = parents.find(key); it != parents.end()) {
+          std::get<I + 1>(rows[it->second]).push_back(std::move(child));
+        }
+      });
+    });
+  }
+
+  template <std::size_t I, typename Parent, typename T>
+  void load(std::vector<value_type> &rows,
+            detail::BelongsTo<Parent, Entity, T> &rel) {
+    using Key = std::common_type_t<detail::pk_type_t<Parent>,
+                                   detail::unwrap_optional_t<T>>;
+    std::unordered_map<Key, std::optional<Parent>> parents;
+    std::vector<Key> keys;
+    for (const value_type &row : rows) {
+      detail::with_join_key<Key>(std::get<0>(row), rel.member,
+                                 [&](const Key &key) {
+                                   if (parents.try_emplace(key).second) {
+                                     keys.push_back(key);
+                                   }
+                                 });
+    }
+
+    static constexpr auto table = Table<Parent>::meta();
+    select_in<Parent>(table.pk_column.name(), keys, [&](Parent &parent) {
+      auto key = static_cast<Key>(detail::primary_key(parent));
+      parents[key] = std::move(parent);
+    });
+
+    for (value_type &row : rows) {
+      detail::with_join_key<Key>(
+          std::get<0>(row), rel.member,
+          [&](const Key &key) { std::get<I + 1>(row) = parents[key]; });
+    }
+  }
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_EAGER_LOAD_HPP_
@@ -0,0 +1,321 @@
+#ifndef SQLINQ_HASH_JOIN_HPP_
+#define SQLINQ_HASH_JOIN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "detail/type_traits.hpp"
+
+namespace sqlinq {
+namespace detail {
+template <typename Range>
+using join_row_t = std::remove_reference_t<decltype(*std::begin(
+    std::declval<Range &>()))>;
+
+template <typename Range, typename KeyFn>
+using join_raw_key_t = std::remove_cvref_t<
+    std::invoke_result_t<KeyFn &, const join_row_t<Range> &>>;
+
+// Both keys are compared as their common type; std::optional keys unwrap
+template <typename Left, typename LeftKey, typename Right, typename RightKey>
+using join_key_t =
+    std::common_type_t<unwrap_optional_t<join_raw_key_t<Left, LeftKey>>,
+                       unwrap_optional_t<join_raw_key_t<Right, RightKey>>>;
+
+/*
+ * Calls fn with the join key of row, converted to Key. NULL (empty optional)
+ * keys never match anything, so fn is not called for them.
+ */
+template <typename Key, typename Row, typename KeyFn, typename Fn>
+void with_join_key(const Row &row, KeyFn &key, Fn &&fn) {
+  const auto &raw = std::invoke(key, row);
+  if constexpr (is_optional_v<std::remove_cvref_t<decltype(raw)>>) {
+    if (raw.has_value()) {
+      fn(static_cast<Key>(*raw));
+    }
+  } else {
+    fn(static_cast<Key>(raw));
+  }
+}
+
+// Mixes the hash bits before choosing a partition
+template <typename Key>
+std::size_t join_partition(const Key &key, std::size_t partitions) {
+  uint64_t h = static_cast<uint64_t>(std::hash<Key>{}(key));
+  return static_cast<std::size_t>((h * 0x9E3779B97F4A7C15ULL) >> 32) %
+         partitions;
+}
+
+/*
+ * Build side of a hash join. Rows are referenced, not copied; equal keys
+ * are chained through next_, so duplicates cost one index entry each.
+ */
+template <typename Key, typename Row> class JoinIndex {
+public:
+  void reserve(std::size_t rows) {
+    heads_.reserve(rows);
+    rows_.reserve(rows);
+    next_.reserve(rows);
+  }
+
+  void insert(const Key &key, Row &row) {
+    auto [it, inserted] = heads_.try_emplace(key, rows_.size());
+    next_.push_back(inserted ? npos : it->second);
+    if (!inserted) {
+      it->second = rows_.size();
+    }
+    rows_.push_back(&row);
+  }
+
+  template <typename Fn> void probe(const Key &key, Fn &&fn) const {
+    auto it = heads_.find(key);
+    if (it == heads_.end()) {
+      return;
+    }
+    for (std::size_t i = it->second; i != npos; i = next_[i]) {
+      fn(*rows_[i]);
+    }
+  }
+
+  void clear() {
+    heads_.clear();
+    rows_.clear();
+    next_.clear();
+  }
+
+private:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  std::unordered_map<Key, std::size_t> heads_;
+  std::vector<Row *> rows_;
+  std::vector<std::size_t> next_;
+};
+
+/*
+ * Joins index against the streamed probe range. Rows of probe are handed to
+ * fn as they are read, so a cursor may reuse its row buffer. BuildLeft tells
+ * which side the index holds, fn always gets (left, right).
+ */
+template <bool BuildLeft, typename Key, typename BuildRow, typename Probe,
+          typename ProbeKey, typename Fn>
+void probe_join(const JoinIndex<Key, BuildRow> &index, Probe &&probe,
+                ProbeKey &probe_key, Fn &fn) {
+  for (auto &row : probe) {
+    with_join_key<Key>(row, probe_key, [&](const Key &key) {
+      index.probe(key, [&](BuildRow &match) {
+        if constexpr (BuildLeft) {
+          fn(match, row);
+        } else {
+          fn(row, match);
+        }
+      });
+    });
+  }
+}
+
+template <typename Key, typename Rows, typename KeyFn>
+auto index_rows(Rows &rows, KeyFn &key) {
+  JoinIndex<Key, std::remove_reference_t<decltype(*std::begin(rows))>> index;
+  if constexpr (std::ranges::sized_range<Rows>) {
+    index.reserve(std::ranges::size(rows));
+  }
+  for (auto &row : rows) {
+    with_join_key<Key>(row, key, [&](const Key &k) { index.insert(k, row); });
+  }
+  return index;
+}
+
+/*
+ * Neither side knows its size: both are read in lockstep until one ends.
+ * The finished side is the smaller one and becomes the build side; the
+ * rows buffered from the other are probed first, the rest is streamed.
+ */
+template <typename Key, typename Left, typename Right, typename LeftKey,
+          typename RightKey, typename Fn>
+void lockstep_join(Left &left, Right &right, LeftKey &left_key,
+                   RightKey &right_key, Fn &fn) {
+  std::deque<std::remove_const_t<join_row_t<Left>>> left_rows;
+  std::deque<std::remove_const_t<join_row_t<Right>>> right_rows;
+  auto lit = std::begin(left);
+  auto lend = std::end(left);
+  auto rit = std::begin(right);
+  auto rend = std::end(right);
+  while (lit != lend && rit != rend) {
+    left_rows.emplace_back(std::move(*lit));
+    right_rows.emplace_back(std::move(*rit));
+    ++lit;
+    ++rit;
+  }
+
+  if (lit == lend) {
+    auto index = index_rows<Key>(left_rows, left_key);
+    probe_join<true>(index, right_rows, right_key, fn);
+    for (; rit != rend; ++rit) {
+      auto &row = *rit;
+      with_join_key<Key>(row, right_key, [&](const Key &key) {
+        index.probe(key, [&](auto &match) { fn(match, row); });
+      });
+    }
+  } else {
+    auto index = index_rows<Key>(right_rows, right_key);
+    probe_join<false>(index, left_rows, left_key, fn);
+    for (; lit != lend; ++lit) {
+      auto &row = *lit;
+      with_join_key<Key>(row, left_key, [&](const Key &key) {
+        index.probe(key, [&](auto &match) { fn(row, match); });
+      });
+    }
+  }
+}
+} // namespace detail
+
+/*
+ * Client-side inner equi-join of two row sources, e.g. a Cursor<T> and a
+ * std::vector<U>, on key(left row) == key(right row). Keys are member
+ * pointers or callables; std::optional keys that are empty never match.
+ * fn(left, right) is called once for every matching pair, in the order of
+ * the streamed side.
+ *
+ * The hash table is built on the smaller side: a sized range (a vector) is
+ * indexed in place, two sized ranges compare sizes and two cursors are read
+ * in lockstep until one ends. The other side is streamed.
+ *
+ * Two cursors must come from different connections, a connection runs one
+ * statement at a time. With a single connection read one side with
+ * to_vector() first, or use partitioned_hash_join().
+ */
+template <typename Left, typename Right, typename LeftKey, typename RightKey,
+          typename Fn>
+void hash_join(Left &&left, Right &&right, LeftKey left_key,
+               RightKey right_key, Fn &&fn) {
+  using Key = detail::join_key_t<Left, LeftKey, Right, RightKey>;
+  constexpr bool left_sized = std::ranges::sized_range<Left>;
+  constexpr bool right_sized = std::ranges::sized_range<Right>;
+
+  auto build_left = [&] {
+    auto index = detail::index_rows<Key>(left, left_key);
+    detail::probe_join<true>(index, right, right_key, fn);
+  };
+  auto build_right = [&] {
+    auto index = detail::index_rows<Key>(right, right_key);
+    detail::probe_join<false>(index, left, left_key, fn);
+  };
+  if constexpr (left_sized && right_sized) {
+    if (std::ranges::size(left) <= std::ranges::size(right)) {
+      build_left();
+    } else {
+      build_right();
+    }
+  } else if constexpr (left_sized) {
+    build_left();
+  } else if constexpr (right_sized) {
+    build_right();
+  } else {
+    detail::lockstep_join<Key>(left, right, left_key, right_key, fn);
+  }
+}
+
+// hash_join() collecting copies of the matching pairs
+template <typename Left, typename Right, typename LeftKey, typename RightKey>
+auto hash_join(Left &&left, Right &&right, LeftKey left_key,
+               RightKey right_key) {
+  using left_type = std::remove_const_t<detail::join_row_t<Left>>;
+  using right_type = std::remove_const_t<detail::join_row_t<Right>>;
+  std::vector<std::pair<left_type, right_type>> pairs;
+  hash_join(std::forward<Left>(left), std::forward<Right>(right), left_key,
+            right_key, [&](const left_type &l, const right_type &r) {
+              pairs.emplace_back(l, r);
+            });
+  return pairs;
+}
+
+/*
+ * Rows of left with at least one match in right, in the order of left. Only
+ * the keys of right are kept in memory.
+ */
+template <typename Left, typename Right, typename LeftKey, typename RightKey>
+auto semi_join(Left &&left, Right &&right, LeftKey left_key,
+               RightKey right_key) {
+  using Key = detail::join_key_t<Left, LeftKey, Right, RightKey>;
+  std::unordered_set<Key> keys;
+  for (auto &row : right) {
+    detail::with_join_key<Key>(row, right_key,
+                               [&](const Key &key) { keys.insert(key); });
+  }
+
+  std::vector<std::remove_const_t<detail::join_row_t<Left>>> rows;
+  for (auto &row : left) {
+    detail::with_join_key<Key>(row, left_key, [&](const Key &key) {
+      if (keys.contains(key)) {
+        rows.emplace_back(row);
+      }
+    });
+  }
+  return rows;
+}
+
+/*
+ * hash_join() under a memory cap. make_left() and make_right() return a
+ * fresh row source, typically by executing a query, and are called once per
+ * partition. Pass p keeps only the rows whose key hashes to p, so the hash
+ * table holds about 1/partitions of the left side; the price is scanning
+ * both sides partitions times. Each left source is fully read before the
+ * right one is made, so both may share a connection.
+ */
+template <typename MakeLeft, typename MakeRight, typename LeftKey,
+          typename RightKey, typename Fn>
+void partitioned_hash_join(MakeLeft &&make_left, MakeRight &&make_right,
+                           LeftKey left_key, RightKey right_key,
+                           std::size_t partitions, Fn &&fn) {
+  using Left = std::invoke_result_t<MakeLeft &>;
+  using Right = std::invoke_result_t<MakeRight &>;
+  using Key = detail::join_key_t<Left, LeftKey, Right, RightKey>;
+  using left_type = std::remove_const_t<detail::join_row_t<Left>>;
+
+  partitions = partitions == 0 ? 1 : partitions;
+  std::vector<left_type> rows;
+  detail::JoinIndex<Key, left_type> index;
+  for (std::size_t p = 0; p < partitions; p++) {
+    rows.clear();
+    index.clear();
+    {
+      auto &&left = make_left();
+      for (auto &row : left) {
+        detail::with_join_key<Key>(row, left_key, [&](const Key &key) {
+          if (detail::join_partition(key, partitions) == p) {
+            rows.emplace_back(std::move(row));
+          }
+        });
+      }
+    }
+    if (rows.empty()) {
+      continue;
+    }
+    for (auto &row : rows) {
+      detail::with_join_key<Key>(
+          row, left_key, [&](const Key &key) { index.insert(key, row); });
+    }
+
+    auto &&right = make_right();
+    for (auto &row : right) {
+      detail::with_join_key<Key>(row, right_key, [&](const Key &key) {
+        if (detail::join_partition(key, partitions) == p) {
+          index.probe(key, [&](left_type &match) { fn(match, row); });
+        }
+      });
+    }
+  }
+}
+} // namespace sqlinq
+
+#endif // SQLINQ_HASH_JOIN_HPP_
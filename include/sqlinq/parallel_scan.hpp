@@ -0,0 +1,170 @@
+#ifndef SQLINQ_PARALLEL_SCAN_HPP_
+#define SQLINQ_PARALLEL_SCAN_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "connection_pool.hpp"
+#include "database.hpp"
+
+namespace sqlinq {
+namespace detail {
+// Splits [first, last] into at most n contiguous ranges of nearly equal width
+inline std::vector<std::pair<int64_t, int64_t>>
+split_range(int64_t first, int64_t last, std::size_t n) {
+  // width - 1, so that the full int64_t range does not overflow
+  uint64_t span = static_cast<uint64_t>(last) - static_cast<uint64_t>(first);
+  uint64_t parts = std::max<uint64_t>(n, 1);
+  if (span < parts - 1) {
+    parts = span + 1;
+  }
+  uint64_t size = span / parts;
+  uint64_t longer = span % parts + 1; // ranges holding one extra key
+  if (longer == parts) {
+    size++;
+    longer = 0;
+  }
+
+  std::vector<std::pair<int64_t, int64_t>> ranges;
+  ranges.reserve(parts);
+  uint64_t lo = static_cast<uint64_t>(first);
+  for (uint64_t k = 0; k < parts; k++) {
+    uint64_t hi = lo + size - (k < longer ? 0 : 1);
+    ranges.emplace_back(static_cast<int64_t>(lo), static_cast<int64_t>(hi));
+    lo = hi + 1;
+  }
+  return ranges;
+}
+
+/*
+ * Runs scan(index, cursor, failed) for every primary key range on its own
+ * thread and pooled connection. The first exception stops the remaining
+ * scans and is rethrown once all threads have finished.
+ */
+template <typename Entity, typename Backend, typename Scan>
+void scan_partitions(ConnectionPool<Backend> &pool,
+                     const std::vector<std::pair<int64_t, int64_t>> &ranges,
+                     Scan &&scan) {
+  std::atomic<bool> failed{false};
+  std::mutex error_mtx;
+  std::exception_ptr error;
+
+  std::vector<std::thread> workers;
+  workers.reserve(ranges.size());
+  for (std::size_t i = 0; i < ranges.size(); i++) {
+    workers.emplace_back([&, i] {
+      try {
+        auto lease = pool.acquire();
+        if (failed.load(std::memory_order_relaxed)) {
+          return;
+        }
+        Database db{*lease};
+        auto cursor =
+            db.get_range<Entity>(ranges[i].first, ranges[i].second);
+        scan(i, cursor, failed);
+      } catch (...) {
+        std::lock_guard lock{error_mtx};
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed.store(true, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+template <typename Entity, typename Backend>
+std::vector<std::pair<int64_t, int64_t>>
+partition_ranges(ConnectionPool<Backend> &pool, std::size_t partitions) {
+  auto lease = pool.acquire();
+  auto bounds = Database{*lease}.pk_bounds<Entity>();
+  if (!bounds) {
+    return {};
+  }
+  return split_range(bounds->first, bounds->second,
+                     partitions == 0 ? pool.size() : partitions);
+}
+} // namespace detail
+
+/*
+ * Full table scan split into primary key ranges between MIN(pk) and MAX(pk),
+ * each read on its own thread and pooled connection. partitions == 0 uses
+ * one range per connection. Ranges are equally wide, not equally full, so
+ * sparse keys give uneven partitions.
+ *
+ * fn is called concurrently from the scanning threads, either per row as
+ * fn(Entity &) or, when it accepts std::span<Entity>, per batch of up to
+ * batch_rows rows of one partition.
+ */
+template <typename Entity, typename Backend, typename Fn>
+void parallel_scan(ConnectionPool<Backend> &pool, std::size_t partitions,
+                   Fn &&fn, std::size_t batch_rows = 256) {
+  auto ranges = detail::partition_ranges<Entity>(pool, partitions);
+  detail::scan_partitions<Entity>(
+      pool, ranges,
+      [&](std::size_t, Cursor<Entity> &cursor, std::atomic<bool> &failed) {
+        if constexpr (std::is_invocable_v<Fn &, std::span<Entity>>) {
+          std::vector<Entity> batch;
+          batch.reserve(std::max<std::size_t>(batch_rows, 1));
+          while (!failed.load(std::memory_order_relaxed) && cursor.next()) {
+            batch.emplace_back(std::move(cursor.current()));
+            if (batch.size() >= batch_rows) {
+              fn(std::span<Entity>{batch});
+              batch.clear();
+            }
+          }
+          if (!batch.empty()) {
+            fn(std::span<Entity>{batch});
+          }
+        } else {
+          while (!failed.load(std::memory_order_relaxed) && cursor.next()) {
+            fn(cursor.current());
+          }
+        }
+      });
+}
+
+// Parallel scan whose partitions are merged back in primary key order
+template <typename Entity, typename Backend>
+std::vector<Entity> parallel_to_vector(ConnectionPool<Backend> &pool,
+                                       std::size_t partitions = 0) {
+  auto ranges = detail::partition_ranges<Entity>(pool, partitions);
+  std::vector<std::vector<Entity>> parts(ranges.size());
+  detail::scan_partitions<Entity>(
+      pool, ranges,
+      [&](std::size_t i, Cursor<Entity> &cursor, std::atomic<bool> &failed) {
+        while (!failed.load(std::memory_order_relaxed) && cursor.next()) {
+          parts[i].emplace_back(std::move(cursor.current()));
+        }
+      });
+
+  std::size_t total = 0;
+  for (const auto &part : parts) {
+    total += part.size();
+  }
+  std::vector<Entity> entities;
+  entities.reserve(total);
+  for (auto &part : parts) {
+    std::move(part.begin(), part.end(), std::back_inserter(entities));
+  }
+  return entities;
+}
+} // namespace sqlinq
+
+#endif // SQLINQ_PARALLEL_SCAN_HPP_
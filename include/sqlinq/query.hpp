@@ -1,9 +1,15 @@
 #ifndef SQLINQ_QUERY_HPP_
 #define SQLINQ_QUERY_HPP_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 #include "query_ast.hpp"
@@ -13,25 +19,160 @@
 namespace sqlinq {
 
 class Database;
+template <class Entity> class Query;
+template <typename Backend> class ShardedDatabase;
 
-inline AggregateResult<int> count() {
-  return AggregateResult<int>{AggregateExpr::Function::Count, {}};
-}
+namespace detail {
+template <typename T> struct is_aggregate : std::false_type {};
+template <typename T>
+struct is_aggregate<AggregateResult<T>> : std::true_type {};
+template <typename T>
+inline constexpr bool is_aggregate_v =
+    is_aggregate<std::remove_cvref_t<T>>::value;
 
 template <typename Entity, typename T>
-inline AggregateResult<int> count(T Entity::*member) {
+std::string_view column_name(T Entity::*member) {
   constexpr auto table_schema = Table<Entity>::meta();
-  std::string_view cname;
   auto offset = reinterpret_cast<std::size_t>(&(((Entity *)0)->*member));
-  for (const auto& column : table_schema.columns) {
+  for (const auto &column : table_schema.columns) {
     if (column.offset() == offset) {
-      cname = column.name();
-      break;
+      return column.name();
     }
   }
-  return AggregateResult<int>{AggregateExpr::Function::Count, cname};
+  return {};
+}
+
+template <typename Entity, typename T>
+const ColumnInfo *column_info(T Entity::*member) {
+  static constexpr auto table_schema = Table<Entity>::meta();
+  auto offset = reinterpret_cast<std::size_t>(&(((Entity *)0)->*member));
+  for (const auto &column : table_schema.columns) {
+    if (column.offset() == offset) {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * JOIN of Target through the foreign key member. A member of Target points
+ * at the primary key of Referenced, the root or an already joined entity
+ * (parent to children); a member of Referenced points at the primary key
+ * of Target.
+ */
+template <typename Referenced, typename Target, typename Owner, typename T>
+JoinExpr make_join(JoinExpr::Kind kind, T Owner::*member) {
+  static constexpr auto referenced = Table<Referenced>::meta();
+  static constexpr auto owner = Table<Owner>::meta();
+  static constexpr auto target = Table<Target>::meta();
+  const ColumnInfo *fk = column_info(member);
+  if (fk == nullptr || !fk->is_foreign_key()) {
+    throw std::invalid_argument("join() requires a foreign_key() column");
+  }
+
+  JoinExpr join;
+  join.kind = kind;
+  join.table_name = target.name;
+  if constexpr (std::is_same_v<Owner, Target>) {
+    join.left_table = referenced.name;
+    join.left_column = referenced.pk_column.name();
+    join.right_column = fk->name();
+  } else {
+    join.left_table = owner.name;
+    join.left_column = fk->name();
+    join.right_column = target.pk_column.name();
+  }
+  for (const auto &col : target.columns) {
+    join.column_names.push_back(col.name());
+  }
+  return join;
+}
+} // namespace detail
+
+inline AggregateResult<int> count() {
+  return AggregateResult<int>{AggregateExpr::Function::Count, {}};
+}
+
+template <typename Entity, typename T>
+inline AggregateResult<int> count(T Entity::*member) {
+  return AggregateResult<int>{AggregateExpr::Function::Count,
+                              detail::column_name(member)};
+}
+
+// Integral columns are summed into int64_t
+template <typename Entity, typename T>
+inline auto sum(T Entity::*member) {
+  using result_t = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+  return AggregateResult<result_t>{AggregateExpr::Function::Sum,
+                                   detail::column_name(member)};
+}
+
+template <typename Entity, typename T>
+inline AggregateResult<T> min(T Entity::*member) {
+  return AggregateResult<T>{AggregateExpr::Function::Min,
+                            detail::column_name(member)};
+}
+
+template <typename Entity, typename T>
+inline AggregateResult<T> max(T Entity::*member) {
+  return AggregateResult<T>{AggregateExpr::Function::Max,
+                            detail::column_name(member)};
+}
+
+template <typename Entity, typename T>
+inline AggregateResult<double> avg(T Entity::*member) {
+  return AggregateResult<double>{AggregateExpr::Function::Avg,
+                                 detail::column_name(member)};
+}
+
+/*
+ * Window functions. The window is set on the result, e.g.
+ *   row_number().partition_by(&Order::customer).order_by_desc(&Order::total)
+ * sum(), avg() and the other aggregates become window functions the same
+ * way; with order_by() they are running totals.
+ */
+inline AggregateResult<int64_t> row_number() {
+  return AggregateResult<int64_t>{AggregateExpr::Function::RowNumber, {}};
+}
+
+inline AggregateResult<int64_t> rank() {
+  return AggregateResult<int64_t>{AggregateExpr::Function::Rank, {}};
+}
+
+// Value offset rows before the current one, nullopt before the first
+template <typename Entity, typename T>
+inline auto lag(T Entity::*member, std::size_t offset = 1) {
+  return AggregateResult<std::optional<detail::unwrap_optional_t<T>>>{
+      AggregateExpr::Function::Lag, detail::column_name(member), offset};
 }
 
+// Value offset rows after the current one, nullopt after the last
+template <typename Entity, typename T>
+inline auto lead(T Entity::*member, std::size_t offset = 1) {
+  return AggregateResult<std::optional<detail::unwrap_optional_t<T>>>{
+      AggregateExpr::Function::Lead, detail::column_name(member), offset};
+}
+
+/*
+ * Insert, update or delete which yields the affected rows. Executing it
+ * returns a Cursor<Entity> over the rows as stored after the statement
+ * (before it, for deletes).
+ */
+template <class Entity> class ReturningQuery {
+public:
+  using table_t = Table<Entity>;
+  ReturningQuery(QueryAst &&ast) : ast_(std::move(ast)) {
+    for (const auto &col : table_info_.columns) {
+      ast_.returning_columns.push_back(col.name());
+    }
+  }
+
+private:
+  QueryAst ast_;
+  friend class Database;
+  static constexpr auto table_info_ = table_t::meta();
+};
+
 template <class Entity> class InsertQuery {
 public:
   using table_t = Table<Entity>;
@@ -39,9 +180,14 @@ public:
     ast_.table_name = table_info_.name;
   }
 
+  ReturningQuery<Entity> returning() && {
+    return ReturningQuery<Entity>{std::move(ast_)};
+  }
+
 private:
   QueryAst ast_;
   friend class Database;
+  friend class Query<Entity>;
   static constexpr auto table_info_ = table_t::meta();
 };
 
@@ -51,14 +197,17 @@ public:
   using return_type =
       std::conditional_t<(sizeof...(Args) > 0), std::tuple<Args...>, Entity>;
 
-  SelectQuery(AggregateResult<Args> &&...aggr_fun)
+  // Columns (Function::None) and aggregates, in the order of the row tuple
+  SelectQuery(AggregateResult<Args> &&...exprs)
     requires(sizeof...(Args) > 0)
   {
     ast_.op = QueryAst::Operation::Select;
     ast_.table_name = table_info_.name;
-    (([&](auto &&fn) { ast_.aggr_expr = fn; })(aggr_fun), ...);
+    (ast_.select_exprs.push_back(std::move(exprs)), ...);
   }
 
+  explicit SelectQuery(QueryAst &&ast) : ast_(std::move(ast)) {}
+
   SelectQuery(ColumnDef<Args> &&...cols) {
     ast_.op = QueryAst::Operation::Select;
     ast_.table_name = table_info_.name;
@@ -75,6 +224,16 @@ public:
     return std::move(*this);
   }
 
+  SelectQuery fetch_strategy(FetchStrategy strategy) & {
+    ast_.fetch_strategy = strategy;
+    return *this;
+  }
+
+  SelectQuery fetch_strategy(FetchStrategy strategy) && {
+    ast_.fetch_strategy = strategy;
+    return std::move(*this);
+  }
+
   SelectQuery skip(std::size_t n) & {
     ast_.skip = n;
     return *this;
@@ -113,9 +272,35 @@ public:
     return std::move(where_impl(*this, std::move(fn)));
   }
 
+  // Filter on aggregates, e.g. having(count() > 1 && sum(&T::x) >= 100)
+  SelectQuery &having(FilterChain &&chain) & {
+    ast_.having = aggregate_storage(std::move(chain));
+    return *this;
+  }
+
+  SelectQuery having(FilterChain &&chain) && {
+    ast_.having = aggregate_storage(std::move(chain));
+    return std::move(*this);
+  }
+
+  /*
+   * Filter on window functions, which WHERE cannot see, e.g. the top three
+   * per group:
+   *   qualify(row_number().partition_by(&T::k).order_by_desc(&T::x) <= 3)
+   * The select is wrapped in a derived table filtered by the outer query.
+   */
+  SelectQuery &qualify(FilterChain &&chain) & {
+    return qualify_impl(*this, std::move(chain));
+  }
+
+  SelectQuery qualify(FilterChain &&chain) && {
+    return std::move(qualify_impl(*this, std::move(chain)));
+  }
+
 private:
   QueryAst ast_;
   friend class Database;
+  template <typename Backend> friend class ShardedDatabase;
   static constexpr auto table_info_ = table_t::meta();
 
   template <typename Self, typename T, typename... Ts>
@@ -126,7 +311,7 @@ private:
           reinterpret_cast<std::size_t>(&(((Entity *)0)->*member_ptr));
       for (const auto &col : table_info_.columns) {
         if (col.offset() == offset) {
-          s.ast_.order_expr.push_back(col.name());
+          s.ast_.group_expr.push_back(col.name());
         }
       }
     };
@@ -158,12 +343,135 @@ private:
     s.ast_.filter_chain = fn(table);
     for (auto &expr : s.ast_.filter_chain) {
       if (expr.kind == FilterExpr::Kind::Leaf) {
-        std::size_t idx = expr.condition.index;
-        expr.condition.column_name = table_info_.columns[idx].name();
+        const ColumnInfo &col = table_info_.columns[expr.condition.index];
+        expr.condition.column_name = col.name();
+        expr.condition.value.set_storage(col.storage());
+      }
+    }
+    return s;
+  }
+
+  // The outer select of qualify() needs the column names of the entity
+  template <typename Self>
+  static auto &qualify_impl(Self &&s, FilterChain &&chain) {
+    if (s.ast_.select_exprs.empty() && s.ast_.column_names.empty()) {
+      for (const auto &col : table_info_.columns) {
+        s.ast_.column_names.push_back(col.name());
       }
     }
+    s.ast_.qualify = aggregate_storage(std::move(chain));
     return s;
   }
+
+  // Values compared with MIN(day), LAG(day) etc. are bound like the column
+  static FilterChain aggregate_storage(FilterChain &&chain) {
+    for (auto &expr : chain) {
+      if (expr.kind != FilterExpr::Kind::Leaf) {
+        continue;
+      }
+      for (const auto &col : table_info_.columns) {
+        if (expr.condition.aggregate.column_name() == col.name()) {
+          expr.condition.value.set_storage(col.storage());
+        }
+      }
+    }
+    return std::move(chain);
+  }
+};
+
+/*
+ * Select of Entity joined with other entities. Ts are the joined entities,
+ * std::optional<T> for a LEFT JOIN; executing it yields
+ * std::tuple<Entity, Ts...> rows. where() and order_by() refer to columns
+ * of Entity.
+ */
+template <class Entity, typename... Ts> class JoinQuery {
+public:
+  using table_t = Table<Entity>;
+  using return_type = std::tuple<Entity, Ts...>;
+
+  explicit JoinQuery(QueryAst &&ast) : ast_(std::move(ast)) {}
+
+  /*
+   * Referenced names the entity whose primary key a member of Target
+   * refers to; it defaults to Entity, e.g. for products -> reviews -> votes:
+   *   .join<Review>(&Review::product_id).join<Vote, Review>(&Vote::review_id)
+   */
+  template <typename Target, typename Referenced = void, typename Owner,
+            typename T>
+  auto join(T Owner::*member) && -> JoinQuery<Entity, Ts..., Target> {
+    return std::move(*this).template add_join<Target, Target, Referenced>(
+        JoinExpr::Kind::Inner, member);
+  }
+
+  template <typename Target, typename Referenced = void, typename Owner,
+            typename T>
+  auto left_join(T Owner::*member) &&
+      -> JoinQuery<Entity, Ts..., std::optional<Target>> {
+    return std::move(*this)
+        .template add_join<Target, std::optional<Target>, Referenced>(
+            JoinExpr::Kind::Left, member);
+  }
+
+  JoinQuery fetch(std::size_t n) && {
+    ast_.fetch = n;
+    return std::move(*this);
+  }
+
+  JoinQuery skip(std::size_t n) && {
+    ast_.skip = n;
+    return std::move(*this);
+  }
+
+  template <typename T, typename... Rest>
+  JoinQuery order_by(T Entity::*first, Rest Entity::*...rest) && {
+    ast_.order_expr.push_back(detail::column_name(first));
+    (ast_.order_expr.push_back(detail::column_name(rest)), ...);
+    return std::move(*this);
+  }
+
+  JoinQuery where(std::function<FilterChain(table_t)> &&fn) && {
+    table_t table;
+    ast_.filter_chain = fn(table);
+    for (auto &expr : ast_.filter_chain) {
+      if (expr.kind == FilterExpr::Kind::Leaf) {
+        const ColumnInfo &col = table_info_.columns[expr.condition.index];
+        expr.condition.column_name = col.name();
+        expr.condition.value.set_storage(col.storage());
+      }
+    }
+    return std::move(*this);
+  }
+
+private:
+  QueryAst ast_;
+  friend class Database;
+  template <class, typename...> friend class JoinQuery;
+  static constexpr auto table_info_ = table_t::meta();
+
+  template <typename T>
+  static constexpr bool is_joined_v =
+      std::is_same_v<T, Entity> ||
+      (std::is_same_v<detail::unwrap_optional_t<Ts>, T> || ...);
+
+  template <typename Target, typename Row, typename Referenced, typename Owner,
+            typename T>
+  auto add_join(JoinExpr::Kind kind, T Owner::*member) && {
+    using referenced_t = std::conditional_t<
+        std::is_void_v<Referenced>,
+        std::conditional_t<std::is_same_v<Owner, Target>, Entity, Target>,
+        Referenced>;
+    static_assert(!is_joined_v<Target>, "An entity can be joined only once");
+    static_assert(std::is_same_v<Owner, Target> || is_joined_v<Owner>,
+                  "The join member must belong to a joined entity");
+    static_assert(std::is_same_v<Owner, Target>
+                      ? is_joined_v<referenced_t>
+                      : std::is_same_v<referenced_t, Target>,
+                  "The referenced entity must be joined already");
+    ast_.joins.push_back(
+        detail::make_join<referenced_t, Target>(kind, member));
+    return JoinQuery<Entity, Ts..., Row>{std::move(ast_)};
+  }
 };
 
 template <class Entity> class WhereQuery {
@@ -181,6 +489,10 @@ public:
     return where_impl(*this, std::move(fn));
   }
 
+  ReturningQuery<Entity> returning() && {
+    return ReturningQuery<Entity>{std::move(ast_)};
+  }
+
 private:
   QueryAst ast_;
   friend class Database;
@@ -192,8 +504,9 @@ private:
     s.ast_.filter_chain = fn(table);
     for (auto &expr : s.ast_.filter_chain) {
       if (expr.kind == FilterExpr::Kind::Leaf) {
-        std::size_t idx = expr.condition.index;
-        expr.condition.column_name = table_info_.columns[idx].name();
+        const ColumnInfo &col = table_info_.columns[expr.condition.index];
+        expr.condition.column_name = col.name();
+        expr.condition.value.set_storage(col.storage());
       }
     }
     return s;
@@ -219,23 +532,56 @@ public:
                     ast.values.emplace_back(BoundValue{});
                   } else {
                     ast.values.emplace_back(col.value());
+                    ast.values.back().set_storage(meta.storage());
                   }
                 }
               });
 
+    ast.op = QueryAst::Operation::Insert;
     return InsertQuery<Entity>{std::move(ast)};
   }
 
   auto remove() -> WhereQuery<Entity> {
     QueryAst ast;
+    ast.op = QueryAst::Operation::Delete;
     return WhereQuery<Entity>{std::move(ast)};
   }
 
   auto select_all() -> SelectQuery<Entity> { return {}; }
 
-  template <typename T>
-  auto select(AggregateResult<T> &&aggr) -> SelectQuery<Entity, T> {
-    return SelectQuery<Entity, T>{std::move(aggr)};
+  /*
+   * INNER JOIN of Target. member is a foreign_key() column, either of
+   * Target referencing Entity (posts -> comments) or of Entity referencing
+   * Target (comments -> post).
+   */
+  template <typename Target, typename Owner, typename T>
+  auto join(T Owner::*member) {
+    return select_joined().template join<Target>(member);
+  }
+
+  // As join(), rows without a match carry an empty std::optional<Target>
+  template <typename Target, typename Owner, typename T>
+  auto left_join(T Owner::*member) {
+    return select_joined().template left_join<Target>(member);
+  }
+
+  /*
+   * Aggregates, optionally after group key columns:
+   *   select(&Order::customer, count(), sum(&Order::total))
+   * Rows are tuples in argument order.
+   */
+  template <typename First, typename... Rest>
+    requires(detail::is_aggregate_v<First> ||
+             (detail::is_aggregate_v<Rest> || ...))
+  auto select(First &&first, Rest &&...rest) {
+    using query_t =
+        SelectQuery<Entity,
+                    typename decltype(select_item(
+                        std::declval<First>()))::value_type,
+                    typename decltype(select_item(
+                        std::declval<Rest>()))::value_type...>;
+    return query_t{select_item(std::forward<First>(first)),
+                   select_item(std::forward<Rest>(rest))...};
   }
 
   template <typename T, typename... Ts>
@@ -274,6 +620,7 @@ public:
                     ast.values.emplace_back(BoundValue{});
                   } else {
                     ast.values.emplace_back(col.value());
+                    ast.values.back().set_storage(meta.storage());
                   }
                 }
               });
@@ -282,9 +629,60 @@ public:
     return WhereQuery<Entity>{std::move(ast)};
   }
 
+  // Insert which updates the row on a key collision. The conflict target is
+  // the primary key when it is set, otherwise the first set unique column.
+  auto upsert(std::function<void(table_t &)> fn) {
+    InsertQuery<Entity> q = insert(std::move(fn));
+    QueryAst &ast = q.ast_;
+    ast.op = QueryAst::Operation::Upsert;
+
+    auto is_set = [&](const ColumnInfo &col) {
+      return std::find(ast.column_names.begin(), ast.column_names.end(),
+                       std::string_view{col.name()}) != ast.column_names.end();
+    };
+    for (const auto &col : table_info_.columns) {
+      if (col.is_primary_key() && is_set(col)) {
+        ast.conflict_columns.push_back(col.name());
+      }
+    }
+    if (ast.conflict_columns.empty()) {
+      for (const auto &col : table_info_.columns) {
+        if (col.is_unique() && is_set(col)) {
+          ast.conflict_columns.push_back(col.name());
+          break;
+        }
+      }
+    }
+    if (ast.conflict_columns.empty()) {
+      throw std::invalid_argument(
+          "upsert() requires a primary key or unique column value");
+    }
+    return q;
+  }
+
 private:
   static constexpr auto table_info_ = table_t::meta();
 
+  template <typename T>
+  static AggregateResult<T> select_item(AggregateResult<T> aggr) {
+    return aggr;
+  }
+
+  template <typename T> static auto select_item(T Entity::*member) {
+    return AggregateResult<T>{AggregateExpr::Function::None,
+                              detail::column_name(member)};
+  }
+
+  JoinQuery<Entity> select_joined() {
+    QueryAst ast;
+    ast.op = QueryAst::Operation::Select;
+    ast.table_name = table_info_.name;
+    for (const auto &col : table_info_.columns) {
+      ast.column_names.push_back(col.name());
+    }
+    return JoinQuery<Entity>{std::move(ast)};
+  }
+
   template <typename Tuple, std::size_t N, typename Pred>
   void zip_apply(Tuple &&tup, const ColumnSet<N> &info, Pred pred) {
     std::apply(
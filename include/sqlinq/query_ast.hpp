@@ -2,49 +2,112 @@
 #define SQLINQ_QUERY_AST_HPP_
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "table.hpp"
 #include "types/datetime.hpp"
 
 namespace sqlinq {
+namespace detail {
+template <typename Entity, typename T>
+std::string_view column_name(T Entity::*member);
+} // namespace detail
+
+// OVER (PARTITION BY ... ORDER BY ...) of a window function
+struct WindowExpr {
+  struct Order {
+    std::string_view column;
+    bool descending;
+  };
+  std::vector<std::string_view> partition_by;
+  std::vector<Order> order_by;
+};
+
 struct AggregateExpr {
-  enum class Function { None, Avg, Count, Min, Max, Sum };
+  enum class Function {
+    None,
+    Avg,
+    Count,
+    Min,
+    Max,
+    Sum,
+    // window only
+    RowNumber,
+    Rank,
+    Lag,
+    Lead
+  };
 
   AggregateExpr() : fn_(Function::None), distinct_(false), col_name_() {}
 
-  AggregateExpr(Function fn, std::string_view col_name)
-      : fn_(fn), distinct_(false), col_name_(col_name) {}
+  AggregateExpr(Function fn, std::string_view col_name, std::size_t offset = 1)
+      : fn_(fn), distinct_(false), col_name_(col_name), offset_(offset) {
+    if (fn >= Function::RowNumber) {
+      window_.emplace();
+    }
+  }
 
   Function fn() const noexcept { return fn_; }
   bool is_distinct() const noexcept { return distinct_; }
   std::string_view column_name() const noexcept { return col_name_; }
+  // Rows back or ahead for LAG and LEAD
+  std::size_t offset() const noexcept { return offset_; }
+  const std::optional<WindowExpr> &window() const noexcept { return window_; }
 
 protected:
   Function fn_;
   bool distinct_;
   std::string_view col_name_;
+  std::size_t offset_ = 1;
+  std::optional<WindowExpr> window_;
 };
 
 template <typename T> class AggregateResult : public AggregateExpr {
 public:
   using value_type = T;
 
-  AggregateResult(Function fn, std::string_view col_name)
-      : AggregateExpr(fn, col_name) {}
+  AggregateResult(Function fn, std::string_view col_name,
+                  std::size_t offset = 1)
+      : AggregateExpr(fn, col_name, offset) {}
 
   AggregateResult distinct() && {
     distinct_ = true;
     return std::move(*this);
   }
 
+  // The calls below turn an aggregate into a window function
+  template <typename Entity, typename... Ts>
+  AggregateResult partition_by(Ts Entity::*...members) && {
+    auto &w = window_ ? *window_ : window_.emplace();
+    (w.partition_by.push_back(detail::column_name(members)), ...);
+    return std::move(*this);
+  }
+
+  template <typename Entity, typename... Ts>
+  AggregateResult order_by(Ts Entity::*...members) && {
+    auto &w = window_ ? *window_ : window_.emplace();
+    (w.order_by.push_back({detail::column_name(members), false}), ...);
+    return std::move(*this);
+  }
+
+  template <typename Entity, typename... Ts>
+  AggregateResult order_by_desc(Ts Entity::*...members) && {
+    auto &w = window_ ? *window_ : window_.emplace();
+    (w.order_by.push_back({detail::column_name(members), true}), ...);
+    return std::move(*this);
+  }
+
 private:
   using AggregateExpr ::column_name;
   using AggregateExpr ::fn;
   using AggregateExpr ::is_distinct;
+  using AggregateExpr ::offset;
+  using AggregateExpr ::window;
 };
 
 class BoundValue {
@@ -79,10 +142,19 @@ public:
         size_(0) {}
 
   template <std::size_t P, std::size_t S>
+    requires(P <= details::DecimalTraits::max_precision)
   constexpr BoundValue(Decimal<P, S> v)
       : type_(column::Type::Decimal), longlong_(static_cast<int64_t>(v)),
         ptr_(nullptr), size_(S) {}
 
+#ifdef SQLINQ_HAS_INT128
+  template <std::size_t P, std::size_t S>
+    requires(P > details::DecimalTraits::max_precision)
+  constexpr BoundValue(Decimal<P, S> v)
+      : type_(column::Type::Decimal128),
+        wide_(static_cast<details::int128_t>(v)), ptr_(nullptr), size_(S) {}
+#endif
+
   constexpr BoundValue(Date v)
       : type_(column::Type::Date), date_(v), ptr_(nullptr),
         size_(0) {}
@@ -106,6 +178,30 @@ public:
   }
 
   BoundValue(BoundValue &&) noexcept = default;
+
+  // Returns a value which owns a copy of the referenced data, so it stays
+  // valid after the entity or string it was bound from goes away.
+  BoundValue clone() const {
+    BoundValue v;
+    v.type_ = type_;
+    v.storage_ = storage_;
+    v.size_ = size_;
+    switch (type_) {
+    case column::Type::Null:
+      break;
+    case column::Type::Blob:
+    case column::Type::Text:
+      v.owned_data_ = std::make_unique<char[]>(size_);
+      if (size_ != 0) {
+        std::memcpy(v.owned_data_.get(), ptr(), size_);
+      }
+      break;
+    default:
+      std::memcpy((void *)&v.tiny_, ptr(), value_size());
+      break;
+    }
+    return v;
+  }
   BoundValue &operator=(BoundValue &&other) noexcept = default;
 
   BoundValue(const BoundValue &) = delete;
@@ -115,6 +211,11 @@ public:
     return type_ != column::Type::Null;
   }
   constexpr column::Type type() const noexcept { return type_; }
+  // Representation of the column the value is bound to
+  constexpr column::Storage storage() const noexcept { return storage_; }
+  constexpr void set_storage(column::Storage storage) noexcept {
+    storage_ = storage;
+  }
   constexpr bool is_null() const noexcept {
     return type_ == column::Type::Null;
   }
@@ -143,6 +244,10 @@ public:
       return &double_;
     case column::Type::Decimal:
       return &longlong_;
+#ifdef SQLINQ_HAS_INT128
+    case column::Type::Decimal128:
+      return &wide_;
+#endif
     case column::Type::Date:
       return &date_;
     case column::Type::Time:
@@ -157,8 +262,44 @@ public:
     return nullptr;
   }
 
+  // Bytes behind ptr() for fixed size types
+  constexpr std::size_t value_size() const noexcept {
+    switch (type_) {
+    case column::Type::Bit:
+    case column::Type::TinyInt:
+      return sizeof(tiny_);
+    case column::Type::SmallInt:
+      return sizeof(short_);
+    case column::Type::Int:
+      return sizeof(long_);
+    case column::Type::Float:
+      return sizeof(float_);
+    case column::Type::Double:
+      return sizeof(double_);
+    case column::Type::BigInt:
+    case column::Type::Decimal:
+      return sizeof(longlong_);
+#ifdef SQLINQ_HAS_INT128
+    case column::Type::Decimal128:
+      return sizeof(wide_);
+#endif
+    case column::Type::Date:
+      return sizeof(date_);
+    case column::Type::Time:
+      return sizeof(time_);
+    case column::Type::Datetime:
+      return sizeof(datetime_);
+    case column::Type::Timestamp:
+      return sizeof(timestamp_);
+    default:
+      break;
+    }
+    return 0;
+  }
+
 private:
   column::Type type_;
+  column::Storage storage_ = column::Storage::Text;
   union {
     int8_t tiny_;
     int16_t short_;
@@ -170,6 +311,9 @@ private:
     Time time_;
     Datetime datetime_;
     Timestamp timestamp_;
+#ifdef SQLINQ_HAS_INT128
+    details::int128_t wide_;
+#endif
   };
 
   std::unique_ptr<char[]> owned_data_;
@@ -184,11 +328,14 @@ struct ValueCondition {
     Equal,
     NotEqual,
     GreaterEqual,
-    Greater
+    Greater,
+    In // column IN (list...)
   };
 
   Operator value_op;
   BoundValue value;
+  std::vector<BoundValue> list;
+  AggregateExpr aggregate; // compared instead of the column when set
   const char *column_name;
   const std::size_t index;
 
@@ -231,12 +378,31 @@ public:
   const FilterExpr &front() const { return exprs_.front(); }
   std::size_t size() const { return exprs_.size(); }
 
+  // Deep copy whose values own their data
+  FilterChain clone() const {
+    FilterChain chain;
+    for (const FilterExpr &e : exprs_) {
+      ValueCondition cond{e.condition.value_op, e.condition.value.clone(),
+                          e.condition.index};
+      cond.column_name = e.condition.column_name;
+      cond.aggregate = e.condition.aggregate;
+      for (const BoundValue &v : e.condition.list) {
+        cond.list.emplace_back(v.clone());
+      }
+      chain.exprs_.emplace_back(FilterExpr{e.kind, std::move(cond)});
+    }
+    return chain;
+  }
+
   auto extract_values() {
     std::vector<BoundValue> result{};
     for (FilterExpr &e : exprs_) {
       if (e.condition.value.has_value()) {
         result.emplace_back(std::move(e.condition.value));
       }
+      for (BoundValue &v : e.condition.list) {
+        result.emplace_back(std::move(v));
+      }
     }
     return result;
   }
@@ -257,6 +423,58 @@ private:
   std::vector<FilterExpr> exprs_;
 };
 
+namespace detail {
+template <typename T>
+FilterChain aggregate_condition(const AggregateExpr &aggr,
+                                ValueCondition::Operator op, const T &v) {
+  FilterChain chain{FilterExpr::Kind::Leaf,
+                    ValueCondition{op, BoundValue{v}, 0}};
+  chain.front().condition.aggregate = aggr;
+  return chain;
+}
+} // namespace detail
+
+// Conditions on aggregates, for SelectQuery::having()
+template <typename T>
+FilterChain operator==(const AggregateResult<T> &aggr,
+                       const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(aggr, ValueCondition::Operator::Equal, v);
+}
+
+template <typename T>
+FilterChain operator!=(const AggregateResult<T> &aggr,
+                       const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(aggr, ValueCondition::Operator::NotEqual,
+                                     v);
+}
+
+template <typename T>
+FilterChain operator<(const AggregateResult<T> &aggr,
+                      const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(aggr, ValueCondition::Operator::Less, v);
+}
+
+template <typename T>
+FilterChain operator<=(const AggregateResult<T> &aggr,
+                       const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(aggr, ValueCondition::Operator::LessEqual,
+                                     v);
+}
+
+template <typename T>
+FilterChain operator>(const AggregateResult<T> &aggr,
+                      const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(aggr, ValueCondition::Operator::Greater,
+                                     v);
+}
+
+template <typename T>
+FilterChain operator>=(const AggregateResult<T> &aggr,
+                       const std::type_identity_t<T> &v) {
+  return detail::aggregate_condition(
+      aggr, ValueCondition::Operator::GreaterEqual, v);
+}
+
 template <typename T> class ColumnDef {
 public:
   constexpr ColumnDef(const char *name) noexcept : name_(name) {}
@@ -266,19 +484,90 @@ private:
   const char *name_;
 };
 
+/*
+ * How the rows of a result set travel to the client. Buffered reads the
+ * whole result at execution and frees the connection, Streaming fetches
+ * row by row from the open result, ServerCursor keeps the result on the
+ * server and fetches prefetch_rows rows per round trip. Backends without
+ * the distinction ignore it.
+ */
+struct FetchStrategy {
+  enum class Mode { Streaming, Buffered, ServerCursor };
+  Mode mode = Mode::Streaming;
+  std::size_t prefetch_rows = 1;
+
+  static constexpr FetchStrategy streaming() noexcept { return {}; }
+  static constexpr FetchStrategy buffered() noexcept {
+    return {Mode::Buffered, 1};
+  }
+  static constexpr FetchStrategy server_cursor(std::size_t rows) noexcept {
+    return {Mode::ServerCursor, rows};
+  }
+};
+
+/*
+ * One JOIN of a select: table_name is joined ON
+ * left_table.left_column = table_name.right_column and contributes
+ * column_names to the selected columns.
+ */
+struct JoinExpr {
+  enum class Kind { Inner, Left };
+  Kind kind = Kind::Inner;
+  std::string_view table_name;
+  std::string_view left_table;
+  std::string_view left_column;
+  std::string_view right_column;
+  std::vector<std::string_view> column_names;
+};
+
+// SQL flavour used where the backends disagree on syntax
+enum class SqlDialect { SQLite, MySQL };
+
 struct QueryAst {
-  enum class Operation { None, Delete, Insert, Select, Update };
-  Operation op;
+  enum class Operation { None, Delete, Insert, Select, Update, Upsert };
+  Operation op = Operation::None;
   std::string table_name;
   FilterChain filter_chain;
-  AggregateExpr aggr_expr;
+  // Select list of plain columns (Function::None) and aggregates; used
+  // instead of column_names when not empty
+  std::vector<AggregateExpr> select_exprs;
   std::vector<std::string_view> group_expr;
+  FilterChain having;
+  FilterChain qualify; // on window functions, applied to the result
   std::vector<std::string_view> order_expr;
   std::vector<std::string_view> column_names;
+  std::vector<std::string_view> conflict_columns; // upsert target
+  std::vector<std::string_view> returning_columns;
+  std::vector<JoinExpr> joins; // columns are qualified when not empty
   std::vector<BoundValue> values;
 
   std::optional<std::size_t> skip;  // OFFSET
   std::optional<std::size_t> fetch; // LIMIT
+  FetchStrategy fetch_strategy;
+
+  // Deep copy whose values own their data
+  QueryAst clone() const {
+    QueryAst ast;
+    ast.op = op;
+    ast.table_name = table_name;
+    ast.filter_chain = filter_chain.clone();
+    ast.select_exprs = select_exprs;
+    ast.group_expr = group_expr;
+    ast.having = having.clone();
+    ast.qualify = qualify.clone();
+    ast.order_expr = order_expr;
+    ast.column_names = column_names;
+    ast.conflict_columns = conflict_columns;
+    ast.returning_columns = returning_columns;
+    ast.joins = joins;
+    for (const BoundValue &v : values) {
+      ast.values.emplace_back(v.clone());
+    }
+    ast.skip = skip;
+    ast.fetch = fetch;
+    ast.fetch_strategy = fetch_strategy;
+    return ast;
+  }
 };
 } // namespace sqlinq
 
@@ -0,0 +1,197 @@
+#ifndef SQLINQ_QUERY_CACHE_HPP_
+#define SQLINQ_QUERY_CACHE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "query_ast.hpp"
+
+namespace sqlinq {
+
+/*
+ * Materialized select results keyed by the generated SQL and the bytes of
+ * its parameters. Every table has a version counter which is bumped by
+ * invalidate(); an entry is only served while the version it was read at
+ * is current, so a write makes all cached results of its table stale.
+ *
+ * Entries are evicted least recently used first once max_entries or
+ * max_bytes is exceeded, and expire after ttl (zero keeps them until
+ * evicted). The byte size of an entry counts sizeof(Row) per row only.
+ * All members are thread safe.
+ */
+class QueryCache {
+public:
+  struct Options {
+    std::size_t max_entries = 1024;
+    std::size_t max_bytes = 64 * 1024 * 1024;
+    std::chrono::milliseconds ttl{0};
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;   // size limits
+    uint64_t expirations = 0; // ttl
+    uint64_t invalidations = 0;
+
+    double hit_rate() const noexcept {
+      uint64_t lookups = hits + misses;
+      return lookups == 0 ? 0.0
+                          : static_cast<double>(hits) /
+                                static_cast<double>(lookups);
+    }
+  };
+
+  template <typename Row>
+  using rows_ptr = std::shared_ptr<const std::vector<Row>>;
+
+  QueryCache() : QueryCache(Options{}) {}
+  explicit QueryCache(Options opts) : opts_(opts), bytes_(0) {}
+
+  QueryCache(const QueryCache &) = delete;
+  QueryCache &operator=(const QueryCache &) = delete;
+
+  // Cache key of a statement: SQL text followed by type, size and bytes of
+  // every parameter
+  static std::string fingerprint(std::string_view sql,
+                                 std::span<const BoundValue> params) {
+    std::string key{sql};
+    for (const BoundValue &p : params) {
+      key.push_back('\0');
+      key.push_back(static_cast<char>(p.type()));
+      std::size_t size = p.size(); // text/blob length, decimal scale
+      key.append(reinterpret_cast<const char *>(&size), sizeof(size));
+      if (p.has_value() && p.ptr() != nullptr) {
+        bool variable = p.type() == column::Type::Text ||
+                        p.type() == column::Type::Blob;
+        key.append(static_cast<const char *>(p.ptr()),
+                   variable ? p.size() : p.value_size());
+      }
+    }
+    return key;
+  }
+
+  // Version to pass to put(); read it before running the query, so a write
+  // finishing meanwhile makes the stored rows stale at once
+  uint64_t version(std::string_view table) const {
+    std::lock_guard lock{mtx_};
+    return version_locked(table);
+  }
+
+  template <typename Row>
+  rows_ptr<Row> get(const std::string &key, std::string_view table) {
+    std::lock_guard lock{mtx_};
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.type != typeid(Row)) {
+      stats_.misses++;
+      return nullptr;
+    }
+    Entry &entry = it->second;
+    if (entry.version != version_locked(table)) {
+      stats_.invalidations++;
+      stats_.misses++;
+      erase(it);
+      return nullptr;
+    }
+    if (opts_.ttl.count() != 0 && clock::now() - entry.stored > opts_.ttl) {
+      stats_.expirations++;
+      stats_.misses++;
+      erase(it);
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, entry.lru);
+    stats_.hits++;
+    return std::static_pointer_cast<const std::vector<Row>>(entry.rows);
+  }
+
+  template <typename Row>
+  rows_ptr<Row> put(const std::string &key, std::string_view table,
+                    uint64_t version, std::vector<Row> rows) {
+    std::size_t bytes = rows.size() * sizeof(Row);
+    auto ptr = std::make_shared<const std::vector<Row>>(std::move(rows));
+    std::lock_guard lock{mtx_};
+    if (version != version_locked(table) || bytes > opts_.max_bytes) {
+      return ptr;
+    }
+    if (auto it = entries_.find(key); it != entries_.end()) {
+      erase(it);
+    }
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{ptr, typeid(Row), version, clock::now(), bytes,
+                                lru_.begin()});
+    bytes_ += bytes;
+    while (entries_.size() > opts_.max_entries || bytes_ > opts_.max_bytes) {
+      stats_.evictions++;
+      erase(entries_.find(lru_.back()));
+    }
+    return ptr;
+  }
+
+  // Marks every cached result of the table as stale
+  void invalidate(std::string_view table) {
+    std::lock_guard lock{mtx_};
+    versions_[std::string{table}]++;
+  }
+
+  void clear() {
+    std::lock_guard lock{mtx_};
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const {
+    std::lock_guard lock{mtx_};
+    return entries_.size();
+  }
+
+  Stats stats() const {
+    std::lock_guard lock{mtx_};
+    return stats_;
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct Entry {
+    std::shared_ptr<const void> rows;
+    std::type_index type;
+    uint64_t version;
+    clock::time_point stored;
+    std::size_t bytes;
+    std::list<std::string>::iterator lru;
+  };
+
+  const Options opts_;
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<std::string, uint64_t> versions_;
+  std::list<std::string> lru_; // most recently used first
+  std::size_t bytes_;
+  Stats stats_;
+
+  uint64_t version_locked(std::string_view table) const {
+    auto it = versions_.find(std::string{table});
+    return it == versions_.end() ? 0 : it->second;
+  }
+
+  void erase(std::unordered_map<std::string, Entry>::iterator it) {
+    bytes_ -= it->second.bytes;
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+  }
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_QUERY_CACHE_HPP_
@@ -0,0 +1,233 @@
+#ifndef SQLINQ_QUERY_EXECUTOR_HPP_
+#define SQLINQ_QUERY_EXECUTOR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "connection_pool.hpp"
+#include "database.hpp"
+
+namespace sqlinq {
+
+/*
+ * Runs independent queries concurrently on a pool of connections. Every
+ * worker thread owns a task queue; submissions are spread round robin and
+ * idle workers steal from the other queues. A task leases a connection only
+ * while it runs, and the number of workers never exceeds the pool size, so
+ * the executor alone never waits for a connection.
+ *
+ * Tasks are callables taking Database &; their result or exception is
+ * delivered through the returned std::future. The connection goes back to
+ * the pool when the task returns, so results must be fully materialized:
+ * no cursors, row views or anything else still reading from it. A task must
+ * not wait for the future of another task. Pending tasks are finished
+ * before the executor is destroyed.
+ */
+template <typename Backend> class QueryExecutor {
+public:
+  // max_concurrency == 0 selects std::thread::hardware_concurrency()
+  explicit QueryExecutor(ConnectionPool<Backend> &pool,
+                         std::size_t max_concurrency = 0)
+      : pool_(pool), queues_(workers_for(pool, max_concurrency)), pending_(0),
+        next_queue_(0), stop_(false) {
+    workers_.reserve(queues_.size());
+    for (std::size_t i = 0; i < queues_.size(); i++) {
+      workers_.emplace_back([this, i] { run(i); });
+    }
+  }
+
+  ~QueryExecutor() {
+    {
+      std::lock_guard lock{sleep_mtx_};
+      stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  QueryExecutor(const QueryExecutor &) = delete;
+  QueryExecutor &operator=(const QueryExecutor &) = delete;
+
+  template <typename Fn>
+  auto submit(Fn &&fn) -> std::future<std::invoke_result_t<Fn &, Database &>> {
+    using result_type = std::invoke_result_t<Fn &, Database &>;
+    static_assert(!detail::is_specialization_of_v<result_type, Cursor> &&
+                      !detail::is_specialization_of_v<result_type,
+                                                      PrefetchCursor> &&
+                      !has_row_view_v<result_type>,
+                  "Tasks must not return rows read after the connection "
+                  "is released, use to_vector()");
+    auto task = std::make_unique<Task<std::decay_t<Fn>, result_type>>(
+        std::forward<Fn>(fn));
+    auto future = task->promise.get_future();
+    push(std::move(task));
+    return future;
+  }
+
+  // Submits callables and select queries at once; the futures are returned
+  // in argument order
+  template <typename... Tasks> auto submit_all(Tasks &&...tasks) {
+    return std::tuple{submit_one(std::forward<Tasks>(tasks))...};
+  }
+
+  template <typename Entity> auto find(auto &&val) {
+    return submit([val = std::forward<decltype(val)>(val)](
+                      Database &db) mutable {
+      return db.find<Entity>(std::move(val));
+    });
+  }
+
+  // The query is moved into the task, its AST carries all parameters
+  template <typename Entity, typename... Ts>
+  auto to_vector(SelectQuery<Entity, Ts...> &&q) {
+    return submit([q = std::move(q)](Database &db) mutable {
+      return db.to_vector(q);
+    });
+  }
+
+  std::size_t concurrency() const noexcept { return workers_.size(); }
+  std::size_t pending() const noexcept {
+    return pending_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct TaskBase {
+    virtual ~TaskBase() = default;
+    virtual void run(Database &db) noexcept = 0;
+  };
+
+  template <typename Fn, typename R> struct Task : TaskBase {
+    Fn fn;
+    std::promise<R> promise;
+
+    explicit Task(Fn &&f) : fn(std::move(f)) {}
+    explicit Task(const Fn &f) : fn(f) {}
+
+    void run(Database &db) noexcept override {
+      try {
+        if constexpr (std::is_void_v<R>) {
+          fn(db);
+          promise.set_value();
+        } else {
+          promise.set_value(fn(db));
+        }
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+  };
+
+  struct WorkQueue {
+    std::mutex mtx;
+    std::deque<std::unique_ptr<TaskBase>> tasks;
+  };
+
+  ConnectionPool<Backend> &pool_;
+  std::vector<WorkQueue> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> pending_;
+  std::atomic<std::size_t> next_queue_;
+
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cv_;
+  bool stop_;
+
+  // Queue of the worker running on this thread, if it belongs to us
+  static inline thread_local QueryExecutor *current_ = nullptr;
+  static inline thread_local std::size_t current_queue_ = 0;
+
+  template <typename Entity, typename... Ts>
+  auto submit_one(SelectQuery<Entity, Ts...> &&q) {
+    return to_vector(std::move(q));
+  }
+
+  template <typename Fn> auto submit_one(Fn &&fn) {
+    return submit(std::forward<Fn>(fn));
+  }
+
+  static std::size_t workers_for(const ConnectionPool<Backend> &pool,
+                                 std::size_t max_concurrency) {
+    std::size_t n = max_concurrency != 0 ? max_concurrency
+                                         : std::thread::hardware_concurrency();
+    return std::clamp<std::size_t>(n, 1, pool.size());
+  }
+
+  void push(std::unique_ptr<TaskBase> task) {
+    // tasks submitted from a worker stay on its queue for locality
+    std::size_t idx = current_ == this
+                          ? current_queue_
+                          : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                                queues_.size();
+    {
+      // counted before it can be taken, so take() never goes below zero
+      std::lock_guard lock{queues_[idx].mtx};
+      pending_.fetch_add(1, std::memory_order_relaxed);
+      queues_[idx].tasks.push_back(std::move(task));
+    }
+    {
+      // a worker between its wait predicate and the wait sees the task
+      std::lock_guard lock{sleep_mtx_};
+    }
+    sleep_cv_.notify_one();
+  }
+
+  // Own queue from the back, other queues from the front
+  std::unique_ptr<TaskBase> take(std::size_t self) {
+    for (std::size_t n = 0; n < queues_.size(); n++) {
+      std::size_t idx = (self + n) % queues_.size();
+      WorkQueue &q = queues_[idx];
+      std::lock_guard lock{q.mtx};
+      if (q.tasks.empty()) {
+        continue;
+      }
+      std::unique_ptr<TaskBase> task;
+      if (idx == self) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+      } else {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+      }
+      pending_.fetch_sub(1, std::memory_order_relaxed);
+      return task;
+    }
+    return nullptr;
+  }
+
+  void run(std::size_t self) {
+    current_ = this;
+    current_queue_ = self;
+    while (true) {
+      if (auto task = take(self)) {
+        auto lease = pool_.acquire();
+        Database db{*lease};
+        task->run(db);
+        continue;
+      }
+      std::unique_lock lock{sleep_mtx_};
+      sleep_cv_.wait(lock, [this] {
+        return stop_ || pending_.load(std::memory_order_relaxed) != 0;
+      });
+      if (stop_ && pending_.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+    }
+  }
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_QUERY_EXECUTOR_HPP_
@@ -0,0 +1,406 @@
+#ifndef SQLINQ_ROW_TABLE_HPP_
+#define SQLINQ_ROW_TABLE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "table.hpp"
+#include "type_traits.hpp"
+#include "types/blob.hpp"
+
+namespace sqlinq {
+namespace detail {
+
+using arena_type = std::vector<std::byte>;
+
+} // namespace detail
+
+/*
+ * Distinct strings of a result set. Every value is stored once and
+ * identified by a dense id in insertion order; views stay valid for the
+ * lifetime of the pool.
+ */
+class StringPool {
+public:
+  using id_type = uint32_t;
+
+  id_type intern(std::string_view text) {
+    if (auto it = ids_.find(text); it != ids_.end()) {
+      return it->second;
+    }
+    auto id = static_cast<id_type>(strings_.size());
+    auto [it, inserted] = ids_.emplace(std::string{text}, id);
+    strings_.push_back(it->first);
+    bytes_ += text.size();
+    return id;
+  }
+
+  std::string_view operator[](id_type id) const { return strings_[id]; }
+  std::size_t size() const noexcept { return strings_.size(); }
+  // Characters of all distinct values
+  std::size_t bytes() const noexcept { return bytes_; }
+
+private:
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+
+  // node based, the keys do not move on rehash
+  std::unordered_map<std::string, id_type, Hash, std::equal_to<>> ids_;
+  std::vector<std::string_view> strings_;
+  std::size_t bytes_ = 0;
+};
+
+namespace detail {
+
+// Out-of-line data shared by the columns of a RowTable
+struct TableStorage {
+  arena_type arena;
+  StringPool strings;
+};
+
+// Fixed width field: one array per column
+template <typename T, bool Interned = false> class TableColumn {
+public:
+  using value_type = T;
+  using reference = const T &;
+
+  void reserve(std::size_t rows) { values_.reserve(rows); }
+  void push(const T &v, TableStorage &) { values_.push_back(v); }
+  void push_null(TableStorage &) { values_.emplace_back(); }
+  reference get(std::size_t row, const TableStorage &) const {
+    return values_[row];
+  }
+  T value(std::size_t row, const TableStorage &storage) const {
+    return get(row, storage);
+  }
+  std::span<const T> values() const noexcept { return values_; }
+  std::size_t bytes() const noexcept { return values_.capacity() * sizeof(T); }
+
+private:
+  std::vector<T> values_;
+};
+
+// Variable width field: bytes go to the arena shared by all columns, the
+// column keeps where each value starts and how long it is
+template <typename T, typename Ref> class ArenaColumn {
+public:
+  using value_type = T;
+  using reference = Ref;
+
+  void reserve(std::size_t rows) {
+    begins_.reserve(rows);
+    sizes_.reserve(rows);
+  }
+
+  void push(std::span<const std::byte> bytes, TableStorage &storage) {
+    begins_.push_back(storage.arena.size());
+    sizes_.push_back(static_cast<uint32_t>(bytes.size()));
+    storage.arena.insert(storage.arena.end(), bytes.begin(), bytes.end());
+  }
+  void push_null(TableStorage &storage) { push({}, storage); }
+
+  reference get(std::size_t row, const TableStorage &storage) const {
+    const std::byte *data = storage.arena.data() + begins_[row];
+    if constexpr (std::is_same_v<Ref, std::string_view>) {
+      return {reinterpret_cast<const char *>(data), sizes_[row]};
+    } else {
+      return {data, sizes_[row]};
+    }
+  }
+
+  T value(std::size_t row, const TableStorage &storage) const {
+    reference ref = get(row, storage);
+    return T(ref.begin(), ref.end());
+  }
+
+  std::size_t bytes() const noexcept {
+    return begins_.capacity() * sizeof(std::size_t) +
+           sizes_.capacity() * sizeof(uint32_t);
+  }
+
+private:
+  std::vector<std::size_t> begins_;
+  std::vector<uint32_t> sizes_; // columns hold at most 4 GiB per value
+};
+
+template <>
+class TableColumn<std::string, false>
+    : public ArenaColumn<std::string, std::string_view> {
+public:
+  using ArenaColumn::push;
+  void push(std::string_view text, TableStorage &storage) {
+    push(std::as_bytes(std::span{text.data(), text.size()}), storage);
+  }
+};
+
+template <>
+class TableColumn<Blob, false>
+    : public ArenaColumn<Blob, std::span<const std::byte>> {};
+
+// Interned text: one id per row into the string pool of the table
+template <> class TableColumn<std::string, true> {
+public:
+  using value_type = std::string;
+  using reference = std::string_view;
+
+  void reserve(std::size_t rows) { ids_.reserve(rows); }
+  void push(std::string_view text, TableStorage &storage) {
+    ids_.push_back(storage.strings.intern(text));
+  }
+  // the id of a null row is never looked up
+  void push_null(TableStorage &) { ids_.push_back(0); }
+  reference get(std::size_t row, const TableStorage &storage) const {
+    return storage.strings[ids_[row]];
+  }
+  std::string value(std::size_t row, const TableStorage &storage) const {
+    return std::string{get(row, storage)};
+  }
+  StringPool::id_type id(std::size_t row) const { return ids_[row]; }
+  std::span<const StringPool::id_type> values() const noexcept { return ids_; }
+  std::size_t bytes() const noexcept {
+    return ids_.capacity() * sizeof(StringPool::id_type);
+  }
+
+private:
+  std::vector<StringPool::id_type> ids_;
+};
+
+template <typename T, bool Interned>
+class TableColumn<std::optional<T>, Interned> {
+public:
+  using value_type = std::optional<T>;
+  using inner_reference = typename TableColumn<T, Interned>::reference;
+  using reference = std::optional<std::remove_cvref_t<inner_reference>>;
+
+  void reserve(std::size_t rows) {
+    inner_.reserve(rows);
+    null_.reserve(rows);
+  }
+
+  template <typename V>
+  void push(const std::optional<V> &v, TableStorage &storage) {
+    null_.push_back(!v.has_value());
+    if (v.has_value()) {
+      inner_.push(*v, storage);
+    } else {
+      inner_.push_null(storage);
+    }
+  }
+
+  reference get(std::size_t row, const TableStorage &storage) const {
+    if (null_[row]) {
+      return std::nullopt;
+    }
+    return inner_.get(row, storage);
+  }
+
+  value_type value(std::size_t row, const TableStorage &storage) const {
+    if (null_[row]) {
+      return std::nullopt;
+    }
+    return inner_.value(row, storage);
+  }
+
+  std::size_t bytes() const noexcept {
+    return inner_.bytes() + null_.capacity() / 8;
+  }
+
+private:
+  TableColumn<T, Interned> inner_;
+  std::vector<bool> null_;
+};
+
+template <typename Tuple> struct decay_tuple;
+template <typename... Ts> struct decay_tuple<std::tuple<Ts...>> {
+  using type = std::tuple<std::remove_cvref_t<Ts>...>;
+};
+
+template <typename Row> struct row_fields {
+  using type = typename decay_tuple<decltype(structure_to_tuple(
+      std::declval<Row &>()))>::type;
+};
+template <typename... Ts> struct row_fields<std::tuple<Ts...>> {
+  using type = std::tuple<Ts...>;
+};
+
+// Whether field I of Row is declared .interned() in its table metadata
+template <typename Row, std::size_t I> consteval bool is_interned_field() {
+  if constexpr (requires { Table<Row>::meta(); }) {
+    constexpr auto schema = Table<Row>::meta();
+    constexpr std::size_t col = member_column<Row, I>();
+    if constexpr (col < schema.columns.size()) {
+      return schema.columns[col].is_interned();
+    }
+  }
+  return false;
+}
+
+template <typename Row, typename Fields, typename Is> struct table_columns;
+template <typename Row, typename... Ts, std::size_t... Is>
+struct table_columns<Row, std::tuple<Ts...>, std::index_sequence<Is...>> {
+  using type = std::tuple<
+      TableColumn<std::remove_cvref_t<Ts>, is_interned_field<Row, Is>()>...>;
+};
+} // namespace detail
+
+/*
+ * Column-wise store of query results. Fixed width fields are kept in one
+ * array per column; text and blob fields share a single byte arena and are
+ * located by offsets, so a million rows cost a handful of allocations
+ * instead of one per string. Rows are read through lightweight RowRef
+ * proxies which return std::string_view / std::span into the arena, or
+ * materialized back into Row.
+ *
+ * Text columns of an entity declared .interned() are dictionary encoded:
+ * each distinct value is stored once in strings() and rows keep its id.
+ *
+ * Row is an entity or a std::tuple; fields are addressed by index.
+ */
+template <typename Row> class RowTable {
+public:
+  using row_type = Row;
+  using fields_type = typename detail::row_fields<Row>::type;
+  static constexpr std::size_t column_count = std::tuple_size_v<fields_type>;
+
+  using columns_type =
+      typename detail::table_columns<Row, fields_type,
+                                     std::make_index_sequence<column_count>>::
+          type;
+
+  class RowRef {
+  public:
+    template <std::size_t I> decltype(auto) get() const {
+      return table_->template get<I>(row_);
+    }
+    Row materialize() const { return table_->materialize(row_); }
+    std::size_t index() const noexcept { return row_; }
+
+  private:
+    friend class RowTable;
+    RowRef(const RowTable *table, std::size_t row) : table_(table), row_(row) {}
+
+    const RowTable *table_;
+    std::size_t row_;
+  };
+
+  struct iterator {
+    using difference_type = std::ptrdiff_t;
+    using value_type = RowRef;
+    using iterator_category = std::input_iterator_tag;
+
+    RowRef operator*() const { return (*table)[row]; }
+    iterator &operator++() {
+      ++row;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator it = *this;
+      ++row;
+      return it;
+    }
+    bool operator==(const iterator &) const = default;
+
+    const RowTable *table;
+    std::size_t row;
+  };
+
+  RowTable() = default;
+
+  // arena_bytes == 0 leaves the arena to grow on demand
+  void reserve(std::size_t rows, std::size_t arena_bytes = 0) {
+    std::apply([rows](auto &...cols) { (cols.reserve(rows), ...); },
+               columns_);
+    storage_.arena.reserve(arena_bytes);
+  }
+
+  // Accepts the row type itself, its field tuple or a tuple of views
+  template <typename R> void push_back(const R &row) {
+    if constexpr (is_tuple_v<R>) {
+      push_fields(row, std::make_index_sequence<column_count>{});
+    } else {
+      push_fields(structure_to_tuple(row),
+                  std::make_index_sequence<column_count>{});
+    }
+    size_++;
+  }
+
+  template <std::size_t I> decltype(auto) get(std::size_t row) const {
+    return std::get<I>(columns_).get(row, storage_);
+  }
+
+  // Contiguous values of a fixed width column; ids of an interned one
+  template <std::size_t I> auto column() const {
+    return std::get<I>(columns_).values();
+  }
+
+  Row materialize(std::size_t row) const {
+    fields_type fields = [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+      return fields_type{std::get<Is>(columns_).value(row, storage_)...};
+    }(std::make_index_sequence<column_count>{});
+    if constexpr (is_tuple_v<Row>) {
+      return fields;
+    } else {
+      return to_struct<Row>(std::move(fields));
+    }
+  }
+
+  std::vector<Row> to_vector() const {
+    std::vector<Row> rows;
+    rows.reserve(size_);
+    for (std::size_t i = 0; i < size_; i++) {
+      rows.push_back(materialize(i));
+    }
+    return rows;
+  }
+
+  RowRef operator[](std::size_t row) const { return RowRef{this, row}; }
+  iterator begin() const { return {this, 0}; }
+  iterator end() const { return {this, size_}; }
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  std::size_t arena_bytes() const noexcept { return storage_.arena.size(); }
+
+  // Dictionary of the interned columns
+  const StringPool &strings() const noexcept { return storage_.strings; }
+
+  // Dictionary id of an interned column
+  template <std::size_t I> StringPool::id_type id(std::size_t row) const {
+    return std::get<I>(columns_).id(row);
+  }
+
+  // Reserved heap memory of all columns, the arena and the dictionary
+  // strings (without hash table overhead)
+  std::size_t memory_bytes() const noexcept {
+    return storage_.arena.capacity() + storage_.strings.bytes() +
+           std::apply([](const auto &...cols) { return (cols.bytes() + ...); },
+                      columns_);
+  }
+
+private:
+  columns_type columns_;
+  detail::TableStorage storage_;
+  std::size_t size_ = 0;
+
+  template <typename Tuple, std::size_t... Is>
+  void push_fields(const Tuple &fields, std::index_sequence<Is...>) {
+    (std::get<Is>(columns_).push(std::get<Is>(fields), storage_), ...);
+  }
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_ROW_TABLE_HPP_
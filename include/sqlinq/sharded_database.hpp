@@ -0,0 +1,433 @@
+#ifndef SQLINQ_SHARDED_DATABASE_HPP_
+#define SQLINQ_SHARDED_DATABASE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "config.hpp"
+#include "database.hpp"
+
+namespace sqlinq {
+namespace detail {
+// Three-way comparison for merging ordered results; NULL sorts first
+template <typename T> int field_compare(const T &lhs, const T &rhs) {
+  if constexpr (is_optional_v<T>) {
+    if (!lhs.has_value() || !rhs.has_value()) {
+      return int{lhs.has_value()} - int{rhs.has_value()};
+    }
+    return field_compare(*lhs, *rhs);
+  } else if constexpr (std::is_same_v<T, Time>) {
+    return field_compare(lhs.to_duration(), rhs.to_duration());
+  } else if constexpr (requires { lhs < rhs; }) {
+    return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+  } else {
+    return 0;
+  }
+}
+} // namespace detail
+
+/*
+ * Spreads the rows of every table over several databases (shards) by the
+ * primary key, either hashed or split into key ranges. Single-row
+ * operations go to the shard owning the key. A select filtered by
+ * `pk == value` is routed the same way; any other select runs on all shards
+ * in parallel and the results are combined on the client: ordered results
+ * are merged, LIMIT/OFFSET are pushed down as LIMIT offset+limit, and
+ * count/sum/min/max are folded into one value.
+ *
+ * Shards do not share an autoincrement sequence, so create() needs the
+ * primary key set by the caller. Like Database, an instance is used by one
+ * thread at a time.
+ */
+template <typename Backend> class ShardedDatabase {
+public:
+  // Hash sharding
+  explicit ShardedDatabase(const std::vector<DatabaseConfig> &shards) {
+    connect(shards);
+  }
+
+  // Range sharding on an integral key: shard i holds keys below
+  // upper_bounds[i], the last shard everything else.
+  ShardedDatabase(const std::vector<DatabaseConfig> &shards,
+                  std::vector<int64_t> upper_bounds)
+      : bounds_(std::move(upper_bounds)), ranged_(true) {
+    if (bounds_.size() + 1 != shards.size()) {
+      throw std::invalid_argument(
+          "Range sharding needs one bound less than shards");
+    }
+    if (!std::is_sorted(bounds_.begin(), bounds_.end())) {
+      throw std::invalid_argument("Shard bounds must be sorted");
+    }
+    connect(shards);
+  }
+
+  ShardedDatabase(const ShardedDatabase &) = delete;
+  ShardedDatabase &operator=(const ShardedDatabase &) = delete;
+
+  std::size_t size() const noexcept { return shards_.size(); }
+  Backend &shard(std::size_t idx) noexcept { return *shards_[idx]; }
+
+  template <typename Key> std::size_t shard_of(const Key &pk) const {
+    return shard_index(key_of(pk));
+  }
+
+  template <typename Entity>
+  [[nodiscard]] auto find(auto &&val) -> std::optional<Entity> {
+    Database db{shard(shard_of(val))};
+    return db.find<Entity>(std::forward<decltype(val)>(val));
+  }
+
+  template <typename Entity> auto create(Entity &entity) {
+    const auto &pk = pk_of(entity);
+    if (pk == std::decay_t<decltype(pk)>{} && has_autoincrement<Entity>()) {
+      throw std::invalid_argument(
+          "ShardedDatabase::create() needs the primary key set");
+    }
+    Statement stmt = Database::insert_statement(entity, true);
+    Database{shard(shard_of(pk))}.execute(stmt);
+    return entity;
+  }
+
+  template <typename Entity> void update(const Entity &entity) {
+    Database{shard(shard_of(pk_of(entity)))}.update(entity);
+  }
+
+  template <typename Entity> void remove(auto &&val) {
+    Database db{shard(shard_of(val))};
+    db.remove<Entity>(std::forward<decltype(val)>(val));
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_vector(SelectQuery<Entity, Ts...> &q) {
+    using query_type = SelectQuery<Entity, Ts...>;
+    using row_type = typename query_type::return_type;
+    QueryAst &ast = q.ast_;
+    if (auto idx = routed_shard<Entity>(ast)) {
+      return Database{shard(*idx)}.to_vector(q);
+    }
+    bool windowed = !ast.qualify.empty() ||
+                    std::any_of(ast.select_exprs.begin(), ast.select_exprs.end(),
+                                [](auto &e) { return e.window().has_value(); });
+    if (windowed) {
+      throw std::invalid_argument(
+          "Window functions cannot be combined across shards");
+    }
+    if (!ast.select_exprs.empty()) {
+      if constexpr (sizeof...(Ts) == 1) {
+        return combine_aggregate<Entity, Ts...>(ast);
+      } else {
+        throw std::invalid_argument(
+            "Multiple aggregates cannot be combined across shards");
+      }
+    }
+
+    QueryAst shard_ast = ast.clone();
+    shard_ast.skip.reset();
+    if (ast.fetch.has_value()) {
+      shard_ast.fetch = ast.skip.value_or(0) + *ast.fetch;
+    }
+    auto parts = fan_out<query_type>(shard_ast);
+
+    std::size_t skip = ast.skip.value_or(0);
+    std::size_t limit =
+        ast.fetch.has_value() ? skip + *ast.fetch : static_cast<std::size_t>(-1);
+    std::vector<row_type> rows;
+    if (ast.order_expr.empty()) {
+      for (auto &part : parts) {
+        for (auto &row : part) {
+          if (rows.size() == limit) {
+            break;
+          }
+          rows.emplace_back(std::move(row));
+        }
+      }
+    } else {
+      rows = merge<Entity, row_type>(parts, ast, limit);
+    }
+    rows.erase(rows.begin(), rows.begin() + std::min(skip, rows.size()));
+    return rows;
+  }
+
+private:
+  using Key = std::variant<int64_t, std::string_view>;
+
+  std::vector<std::unique_ptr<Backend>> shards_;
+  std::vector<int64_t> bounds_;
+  bool ranged_ = false;
+
+  void connect(const std::vector<DatabaseConfig> &shards) {
+    if (shards.empty()) {
+      throw std::invalid_argument("Sharded database needs at least one shard");
+    }
+    for (const DatabaseConfig &cfg : shards) {
+      auto backend = std::make_unique<Backend>();
+      backend->connect(cfg);
+      shards_.emplace_back(std::move(backend));
+    }
+  }
+
+  template <typename T> static Key key_of(const T &pk) {
+    if constexpr (std::is_integral_v<T>) {
+      return static_cast<int64_t>(pk);
+    } else {
+      return std::string_view{pk};
+    }
+  }
+
+  static std::optional<Key> key_of(const BoundValue &v) {
+    const void *p = v.ptr();
+    switch (v.type()) {
+    case column::Type::TinyInt:
+      return static_cast<int64_t>(*static_cast<const int8_t *>(p));
+    case column::Type::SmallInt:
+      return static_cast<int64_t>(*static_cast<const int16_t *>(p));
+    case column::Type::Int:
+      return static_cast<int64_t>(*static_cast<const int32_t *>(p));
+    case column::Type::BigInt:
+      return *static_cast<const int64_t *>(p);
+    case column::Type::Text:
+      return std::string_view{static_cast<const char *>(p), v.size()};
+    default:
+      return std::nullopt;
+    }
+  }
+
+  std::size_t shard_index(const Key &key) const {
+    uint64_t h = 0;
+    if (const int64_t *n = std::get_if<int64_t>(&key)) {
+      if (ranged_) {
+        return static_cast<std::size_t>(
+            std::upper_bound(bounds_.begin(), bounds_.end(), *n) -
+            bounds_.begin());
+      }
+      h = static_cast<uint64_t>(*n);
+    } else {
+      if (ranged_) {
+        throw std::invalid_argument("Range sharding needs an integral key");
+      }
+      // FNV-1a, the placement must not depend on the standard library
+      h = 0xcbf29ce484222325ULL;
+      for (char c : std::get<std::string_view>(key)) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+      }
+    }
+    // splitmix64 finalizer, so sequential keys spread evenly
+    uint64_t z = h + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<std::size_t>((z ^ (z >> 31)) % shards_.size());
+  }
+
+  template <typename Entity> static const ColumnInfo &pk_column() {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    for (const auto &col : table_schema.columns) {
+      if (col.is_primary_key()) {
+        return col;
+      }
+    }
+    throw std::invalid_argument("Sharded table needs a primary key");
+  }
+
+  template <typename Entity> static bool has_autoincrement() {
+    return pk_column<Entity>().is_autoincrement();
+  }
+
+  template <typename Entity> static const auto &pk_of(const Entity &entity) {
+    static constexpr auto table_schema = Table<Entity>::meta();
+    using pk_type = typename decltype(table_schema)::pk_type;
+    const char *field =
+        reinterpret_cast<const char *>(&entity) + pk_column<Entity>().offset();
+    return *reinterpret_cast<const pk_type *>(field);
+  }
+
+  // Shard of a select filtered only by `pk == value`
+  template <typename Entity>
+  std::optional<std::size_t> routed_shard(const QueryAst &ast) const {
+    if (ast.filter_chain.size() != 1) {
+      return std::nullopt;
+    }
+    const FilterExpr &expr = ast.filter_chain.front();
+    if (expr.kind != FilterExpr::Kind::Leaf ||
+        expr.condition.value_op != ValueCondition::Operator::Equal ||
+        expr.condition.column_name == nullptr ||
+        std::strcmp(expr.condition.column_name, pk_column<Entity>().name()) !=
+            0) {
+      return std::nullopt;
+    }
+    auto key = key_of(expr.condition.value);
+    if (!key.has_value()) {
+      return std::nullopt;
+    }
+    return shard_index(*key);
+  }
+
+  // Runs the query on every shard at once, one result per shard
+  template <typename Query>
+  auto fan_out(const QueryAst &ast)
+      -> std::vector<std::vector<typename Query::return_type>> {
+    using rows_type = std::vector<typename Query::return_type>;
+    std::vector<std::future<rows_type>> pending;
+    pending.reserve(shards_.size());
+    for (auto &backend : shards_) {
+      pending.emplace_back(std::async(
+          std::launch::async, [&backend, shard_ast = ast.clone()]() mutable {
+            Query q{std::move(shard_ast)};
+            return Database{*backend}.to_vector(q);
+          }));
+    }
+    std::vector<rows_type> parts;
+    parts.reserve(pending.size());
+    for (auto &f : pending) {
+      parts.emplace_back(f.get());
+    }
+    return parts;
+  }
+
+  template <typename Entity, typename T>
+  std::vector<std::tuple<T>> combine_aggregate(const QueryAst &ast) {
+    const AggregateExpr &aggr = ast.select_exprs.front();
+    if (!ast.group_expr.empty() || !ast.having.empty() ||
+        !ast.order_expr.empty()) {
+      throw std::invalid_argument(
+          "Grouped aggregates cannot be combined across shards");
+    }
+    if (aggr.is_distinct() || aggr.fn() == AggregateExpr::Function::Avg) {
+      throw std::invalid_argument(
+          "Aggregate cannot be combined across shards");
+    }
+
+    T result{};
+    if (aggr.fn() == AggregateExpr::Function::Count ||
+        aggr.fn() == AggregateExpr::Function::Sum) {
+      if constexpr (requires(T &lhs, const T &rhs) { lhs += rhs; }) {
+        for (auto &part : fan_out<SelectQuery<Entity, T>>(ast)) {
+          if (!part.empty()) {
+            result += std::get<0>(part.front());
+          }
+        }
+        return {std::tuple{result}};
+      } else {
+        throw std::invalid_argument("Sum of a non-numeric column");
+      }
+    }
+
+    // empty shards yield NULL, so every shard also reports COUNT(column)
+    bool is_min = aggr.fn() == AggregateExpr::Function::Min;
+    std::string column{aggr.column_name()};
+    std::string count_col = "COUNT(" + column + ')';
+    std::string value_col = (is_min ? "MIN(" : "MAX(") + column + ')';
+    QueryAst shard_ast = ast.clone();
+    shard_ast.select_exprs.clear();
+    shard_ast.column_names = {count_col, value_col};
+
+    bool found = false;
+    for (auto &part : fan_out<SelectQuery<Entity, int64_t, T>>(shard_ast)) {
+      if (part.empty() || std::get<0>(part.front()) == 0) {
+        continue;
+      }
+      T &value = std::get<1>(part.front());
+      if (!found || (is_min ? value < result : result < value)) {
+        result = std::move(value);
+        found = true;
+      }
+    }
+    return {std::tuple{result}};
+  }
+
+  // k-way merge of per-shard results sorted by the ORDER BY columns
+  template <typename Entity, typename Row>
+  static std::vector<Row> merge(std::vector<std::vector<Row>> &parts,
+                                const QueryAst &ast, std::size_t limit) {
+    std::vector<std::string_view> row_columns = ast.column_names;
+    if constexpr (!is_tuple_v<Row>) {
+      row_columns.clear();
+      for (const auto &col : Table<Entity>::meta().columns) {
+        row_columns.push_back(col.name());
+      }
+    }
+    std::vector<std::size_t> keys;
+    for (std::string_view name : ast.order_expr) {
+      auto it = std::find(row_columns.begin(), row_columns.end(), name);
+      if (it == row_columns.end()) {
+        throw std::invalid_argument(
+            "Merging shards needs the ORDER BY columns in the result");
+      }
+      keys.push_back(static_cast<std::size_t>(it - row_columns.begin()));
+    }
+
+    auto less = [&keys](const Row &lhs, const Row &rhs) {
+      for (std::size_t key : keys) {
+        int cmp = compare_at<Entity>(lhs, rhs, key);
+        if (cmp != 0) {
+          return cmp < 0;
+        }
+      }
+      return false;
+    };
+    using cursor_t = std::pair<std::size_t, std::size_t>; // part, row
+    auto later = [&](const cursor_t &a, const cursor_t &b) {
+      return less(parts[b.first][b.second], parts[a.first][a.second]);
+    };
+    std::priority_queue<cursor_t, std::vector<cursor_t>, decltype(later)> heap{
+        later};
+    for (std::size_t i = 0; i < parts.size(); i++) {
+      if (!parts[i].empty()) {
+        heap.emplace(i, 0);
+      }
+    }
+
+    std::vector<Row> rows;
+    while (!heap.empty() && rows.size() < limit) {
+      auto [part, row] = heap.top();
+      heap.pop();
+      rows.emplace_back(std::move(parts[part][row]));
+      if (row + 1 < parts[part].size()) {
+        heap.emplace(part, row + 1);
+      }
+    }
+    return rows;
+  }
+
+  template <typename Entity, typename Row>
+  static int compare_at(const Row &lhs, const Row &rhs, std::size_t key) {
+    int result = 0;
+    if constexpr (is_tuple_v<Row>) {
+      [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+        ((Idx == key ? void(result = detail::field_compare(std::get<Idx>(lhs),
+                                                           std::get<Idx>(rhs)))
+                     : void()),
+         ...);
+      }(std::make_index_sequence<std::tuple_size_v<Row>>{});
+    } else {
+      using fields_t = decltype(structure_to_tuple(std::declval<Entity &>()));
+      [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+        ((detail::member_column<Entity, Idx>() == key
+              ? void(result = detail::field_compare(
+                         detail::member<Entity, Idx>(lhs),
+                         detail::member<Entity, Idx>(rhs)))
+              : void()),
+         ...);
+      }(std::make_index_sequence<std::tuple_size_v<fields_t>>{});
+    }
+    return result;
+  }
+
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_SHARDED_DATABASE_HPP_
@@ -1,9 +1,12 @@
 #ifndef SQLINQ_SQL_GENERATOR_HPP_
 #define SQLINQ_SQL_GENERATOR_HPP_
 
+#include <algorithm>
 #include <array>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "query_ast.hpp"
 
@@ -27,6 +30,18 @@ constexpr std::ostream &operator<<(std::ostream &os,
   case AggregateExpr::Function::Sum:
     os << "SUM";
     break;
+  case AggregateExpr::Function::RowNumber:
+    os << "ROW_NUMBER";
+    break;
+  case AggregateExpr::Function::Rank:
+    os << "RANK";
+    break;
+  case AggregateExpr::Function::Lag:
+    os << "LAG";
+    break;
+  case AggregateExpr::Function::Lead:
+    os << "LEAD";
+    break;
   default:
     break;
   }
@@ -35,7 +50,17 @@ constexpr std::ostream &operator<<(std::ostream &os,
 
 constexpr std::ostream &operator<<(std::ostream &os,
                                    const ValueCondition &condition) {
-  if (condition.value.is_null()) {
+  if (condition.value_op == ValueCondition::Operator::In) {
+    // An empty list matches nothing
+    os << " IN (";
+    for (std::size_t i = 0; i < condition.list.size(); i++) {
+      os << (i == 0 ? "?" : ",?");
+    }
+    if (condition.list.empty()) {
+      os << "NULL";
+    }
+    os << ')';
+  } else if (condition.value.is_null()) {
     switch (condition.value_op) {
     case ValueCondition::Operator::Equal:
       os << " IS NULL";
@@ -66,27 +91,98 @@ constexpr std::ostream &operator<<(std::ostream &os,
     case ValueCondition::Operator::Greater:
       os << " > ?";
       break;
+    default:
+      break;
     }
   }
   return os;
 }
 
-constexpr std::ostream &operator<<(std::ostream &os, const FilterChain &chain) {
+// Column or aggregate of a select list, prefixed with table when not empty
+inline std::ostream &write_expr(std::ostream &os, const AggregateExpr &expr,
+                                std::string_view table) {
+  using Function = AggregateExpr::Function;
+  auto column = [&](std::string_view name) {
+    if (!table.empty()) {
+      os << table << '.';
+    }
+    os << name;
+  };
+  if (expr.fn() == Function::None) {
+    column(expr.column_name());
+    return os;
+  }
+  os << expr.fn() << '(';
+  if (expr.is_distinct()) {
+    os << "DISTINCT ";
+  }
+  if (expr.fn() == Function::Lag || expr.fn() == Function::Lead) {
+    column(expr.column_name());
+    os << ", " << expr.offset();
+  } else if (!expr.column_name().empty()) {
+    column(expr.column_name());
+  } else if (expr.fn() < Function::RowNumber) {
+    os << '*';
+  }
+  os << ')';
+  if (!expr.window().has_value()) {
+    return os;
+  }
+
+  const WindowExpr &window = *expr.window();
+  os << " OVER (";
+  for (std::size_t i = 0; i < window.partition_by.size(); i++) {
+    os << (i == 0 ? "PARTITION BY " : ", ");
+    column(window.partition_by[i]);
+  }
+  for (std::size_t i = 0; i < window.order_by.size(); i++) {
+    os << (i != 0 ? ", " : window.partition_by.empty() ? "ORDER BY "
+                                                        : " ORDER BY ");
+    column(window.order_by[i].column);
+    if (window.order_by[i].descending) {
+      os << " DESC";
+    }
+  }
+  // An ordered aggregate is a running total of the rows up to this one
+  if (expr.fn() < Function::RowNumber && !window.order_by.empty()) {
+    os << " ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW";
+  }
+  return os << ')';
+}
+
+// WHERE (or HAVING) clause whose columns are prefixed with table, when it is
+// not empty
+inline std::ostream &write_where(std::ostream &os, const FilterChain &chain,
+                                 std::string_view table,
+                                 const char *clause = " WHERE ") {
   if (!chain.empty()) {
-    os << " WHERE ";
+    os << clause;
     for (const auto &expr : chain) {
       if (expr.kind == FilterExpr::Kind::And) {
         os << " AND ";
       } else if (expr.kind == FilterExpr::Kind::Or) {
         os << " OR ";
       } else if (expr.kind == FilterExpr::Kind::Leaf) {
-        os << expr.condition.column_name << expr.condition;
+        const ValueCondition &cond = expr.condition;
+        if (cond.aggregate.fn() != AggregateExpr::Function::None) {
+          write_expr(os, cond.aggregate, table);
+        } else {
+          if (!table.empty()) {
+            os << table << '.';
+          }
+          os << cond.column_name;
+        }
+        os << cond;
       }
     }
   }
   return os;
 }
 
+inline std::ostream &operator<<(std::ostream &os, const FilterChain &chain) {
+  return write_where(os, chain, {});
+}
+
 class SqlGenerator {
 public:
   static std::string build_delete(const QueryAst &ast) {
@@ -113,6 +209,85 @@ public:
     return query;
   }
 
+  // INSERT of `rows` rows which updates the non-target columns when a row
+  // collides on ast.conflict_columns. MySQL has no conflict target, it
+  // reacts to any unique index.
+  static std::string build_upsert(const QueryAst &ast, SqlDialect dialect,
+                                  std::size_t rows = 1) {
+    std::stringstream ss;
+    ss << "INSERT INTO " << ast.table_name << '(';
+    for (std::size_t i = 0; i < ast.column_names.size(); i++) {
+      if (i != 0) {
+        ss << ',';
+      }
+      ss << ast.column_names[i];
+    }
+    ss << ") VALUES";
+    for (std::size_t r = 0; r < rows; r++) {
+      ss << (r != 0 ? ",(" : "(");
+      for (std::size_t i = 0; i < ast.column_names.size(); i++) {
+        ss << (i != 0 ? ",?" : "?");
+      }
+      ss << ')';
+    }
+
+    std::vector<std::string_view> updates;
+    for (auto &col : ast.column_names) {
+      if (std::find(ast.conflict_columns.begin(), ast.conflict_columns.end(),
+                    col) == ast.conflict_columns.end()) {
+        updates.push_back(col);
+      }
+    }
+
+    if (dialect == SqlDialect::MySQL) {
+      ss << " ON DUPLICATE KEY UPDATE ";
+      if (updates.empty()) {
+        ss << ast.conflict_columns.front() << " = "
+           << ast.conflict_columns.front();
+      }
+      for (std::size_t i = 0; i < updates.size(); i++) {
+        if (i != 0) {
+          ss << ", ";
+        }
+        ss << updates[i] << " = VALUES(" << updates[i] << ')';
+      }
+      return ss.str();
+    }
+
+    ss << " ON CONFLICT(";
+    for (std::size_t i = 0; i < ast.conflict_columns.size(); i++) {
+      if (i != 0) {
+        ss << ',';
+      }
+      ss << ast.conflict_columns[i];
+    }
+    ss << ')';
+    if (updates.empty()) {
+      ss << " DO NOTHING";
+      return ss.str();
+    }
+    ss << " DO UPDATE SET ";
+    for (std::size_t i = 0; i < updates.size(); i++) {
+      if (i != 0) {
+        ss << ", ";
+      }
+      ss << updates[i] << " = excluded." << updates[i];
+    }
+    return ss.str();
+  }
+
+  static std::string
+  build_returning(const std::vector<std::string_view> &columns) {
+    std::string clause{" RETURNING "};
+    for (std::size_t i = 0; i < columns.size(); i++) {
+      if (i != 0) {
+        clause += ", ";
+      }
+      clause += columns[i];
+    }
+    return clause;
+  }
+
   static std::string build_update(const QueryAst &ast) {
     std::stringstream ss;
     ss << "UPDATE " << ast.table_name << " SET ";
@@ -128,46 +303,61 @@ public:
   }
 
   static std::string build_select(const QueryAst &ast) {
+    if (!ast.qualify.empty()) {
+      return build_qualified_select(ast);
+    }
     std::stringstream ss;
+    // Columns are qualified once other tables are joined in
+    std::string_view table =
+        ast.joins.empty() ? std::string_view{} : ast.table_name;
+    auto column = [&](std::string_view tname, std::string_view name) {
+      if (!tname.empty()) {
+        ss << tname << '.';
+      }
+      ss << name;
+    };
+
     ss << "SELECT ";
-    if (ast.aggr_expr.fn() != AggregateExpr::Function::None) {
-      ss << ast.aggr_expr.fn() << '(';
-      if (ast.aggr_expr.is_distinct()) {
-        ss << "DISTINCT ";
+    if (!ast.select_exprs.empty()) {
+      for (std::size_t i = 0; i < ast.select_exprs.size(); i++) {
+        ss << (i == 0 ? "" : ", ");
+        write_expr(ss, ast.select_exprs[i], table);
       }
-      ss << (!ast.aggr_expr.column_name().empty() ? ast.aggr_expr.column_name()
-                                                  : std::string_view{"*"});
-      ss << ')';
     } else {
-      if (!ast.column_names.empty()) {
-        for (std::size_t i = 0; i < ast.column_names.size(); i++) {
-          if (i != 0) {
-            ss << ", " << ast.column_names[i];
-          } else {
-            ss << ast.column_names[i];
-          }
+      bool first = true;
+      auto columns = [&](std::string_view tname,
+                         const std::vector<std::string_view> &names) {
+        for (auto name : names) {
+          ss << (first ? "" : ", ");
+          column(tname, name);
+          first = false;
         }
-      } else {
+      };
+      columns(table, ast.column_names);
+      for (const JoinExpr &join : ast.joins) {
+        columns(join.table_name, join.column_names);
+      }
+      if (first) {
         ss << '*';
       }
     }
-    ss << " FROM " << ast.table_name << ast.filter_chain;
+    ss << " FROM " << ast.table_name;
+    for (const JoinExpr &join : ast.joins) {
+      ss << (join.kind == JoinExpr::Kind::Left ? " LEFT JOIN " : " INNER JOIN ")
+         << join.table_name << " ON " << join.left_table << '.'
+         << join.left_column << " = " << join.table_name << '.'
+         << join.right_column;
+    }
+    write_where(ss, ast.filter_chain, table);
     for (std::size_t i = 0; i < ast.group_expr.size(); i++) {
-      if (i == 0) {
-        ss << " GROUP BY ";
-        ss << ast.group_expr[i];
-        continue;
-      }
-      ss << ',' << ast.group_expr[i];
+      ss << (i == 0 ? " GROUP BY " : ",");
+      column(table, ast.group_expr[i]);
     }
+    write_where(ss, ast.having, table, " HAVING ");
 
     for (std::size_t i = 0; i < ast.order_expr.size(); i++) {
-      if (i == 0) {
-        ss << " ORDER BY ";
-        ss << ast.order_expr[i];
-        continue;
-      }
-      ss << ',' << ast.order_expr[i];
+      ss << (i == 0 ? " ORDER BY " : ",");
+      column(table, ast.order_expr[i]);
     }
     if (ast.fetch.has_value()) {
       ss << " LIMIT " << ast.fetch.value();
@@ -179,6 +369,85 @@ public:
   }
 
 private:
+  /*
+   * Window functions cannot be filtered in WHERE, so the select becomes a
+   * derived table which also yields the compared window functions as w0,
+   * w1, ...; the outer select filters on them, then orders and limits.
+   * Aggregates of the select list are named e0, e1, ... by position.
+   */
+  static std::string build_qualified_select(const QueryAst &ast) {
+    std::vector<std::string> names; // columns of the derived table
+    std::stringstream list;
+    for (std::size_t i = 0; i < ast.select_exprs.size(); i++) {
+      const AggregateExpr &expr = ast.select_exprs[i];
+      list << (i == 0 ? "" : ", ");
+      write_expr(list, expr, {});
+      if (expr.fn() == AggregateExpr::Function::None) {
+        names.emplace_back(expr.column_name());
+      } else {
+        names.push_back('e' + std::to_string(i));
+        list << " AS " << names.back();
+      }
+    }
+    for (std::string_view name : ast.column_names) {
+      list << (names.empty() ? "" : ", ") << name;
+      names.emplace_back(name);
+    }
+    if (names.empty()) {
+      throw std::invalid_argument("qualify() requires selected columns");
+    }
+
+    const std::size_t selected = names.size();
+    for (std::string_view name : ast.order_expr) {
+      if (std::find(names.begin(), names.end(), name) == names.end()) {
+        list << ", " << name;
+        names.emplace_back(name);
+      }
+    }
+    std::size_t window = 0;
+    for (const FilterExpr &expr : ast.qualify) {
+      if (expr.kind == FilterExpr::Kind::Leaf) {
+        list << ", ";
+        write_expr(list, expr.condition.aggregate, {});
+        list << " AS w" << window++;
+      }
+    }
+
+    std::stringstream ss;
+    ss << "SELECT ";
+    for (std::size_t i = 0; i < selected; i++) {
+      ss << (i == 0 ? "" : ", ") << names[i];
+    }
+    ss << " FROM (SELECT " << list.str() << " FROM " << ast.table_name;
+    write_where(ss, ast.filter_chain, {});
+    for (std::size_t i = 0; i < ast.group_expr.size(); i++) {
+      ss << (i == 0 ? " GROUP BY " : ",") << ast.group_expr[i];
+    }
+    write_where(ss, ast.having, {}, " HAVING ");
+    ss << ") AS windowed WHERE ";
+
+    window = 0;
+    for (const FilterExpr &expr : ast.qualify) {
+      if (expr.kind == FilterExpr::Kind::And) {
+        ss << " AND ";
+      } else if (expr.kind == FilterExpr::Kind::Or) {
+        ss << " OR ";
+      } else if (expr.kind == FilterExpr::Kind::Leaf) {
+        ss << 'w' << window++ << expr.condition;
+      }
+    }
+    for (std::size_t i = 0; i < ast.order_expr.size(); i++) {
+      ss << (i == 0 ? " ORDER BY " : ",") << ast.order_expr[i];
+    }
+    if (ast.fetch.has_value()) {
+      ss << " LIMIT " << ast.fetch.value();
+    }
+    if (ast.skip.has_value()) {
+      ss << " OFFSET " << ast.skip.value();
+    }
+    return ss.str();
+  }
+
   static constexpr std::array bind_string{
       '?', ',', '?', ',', '?', ',', '?', ',', '?', ',', '?', ',', '?', ',',
       '?', ',', '?', ',', '?', ',', '?', ',', '?', ',', '?', ',', '?', ',',
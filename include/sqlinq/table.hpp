@@ -3,11 +3,14 @@
 
 #include <array>
 #include <span>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <vector>
 
 #include "detail/type_traits.hpp"
+#include "type_traits.hpp"
 #include "types/datetime.hpp"
 #include "types/decimal.hpp"
 
@@ -33,7 +36,8 @@ enum class Type : short {
   Date,
   Time,
   Datetime,
-  Timestamp
+  Timestamp,
+  Decimal128
 };
 
 enum class Options : char {
@@ -42,9 +46,19 @@ enum class Options : char {
   Optional = 1 << 1,
   PrimaryKey = 1 << 2,
   Unique = 1 << 3,
-  ForeignKey = 1 << 4
+  ForeignKey = 1 << 4,
+  Interned = 1 << 5
 };
 
+/*
+ * How a backend without date types (SQLite) keeps Date, Time and Datetime
+ * values. Text is ISO 8601; EpochDays stores a Date as days since
+ * 1970-01-01, UnixSeconds a Datetime as seconds since the epoch and a Time
+ * as seconds since midnight. Integers compare and index as numbers and skip
+ * the text conversion. Backends with native types ignore it.
+ */
+enum class Storage : char { Text, EpochDays, UnixSeconds };
+
 constexpr Options operator|(const Options lhs, const Options rhs) noexcept {
   return static_cast<Options>(static_cast<int>(lhs) | static_cast<int>(rhs));
 }
@@ -68,8 +82,10 @@ class ColumnInfo {
 public:
   constexpr ColumnInfo() = default;
   constexpr ColumnInfo(const char *name, uint32_t offset, column::Type type,
-                       column::Options opts)
-      : name_(name), offset_(offset), type_(type), options_(opts) {}
+                       column::Options opts,
+                       column::Storage storage = column::Storage::Text)
+      : name_(name), offset_(offset), type_(type), options_(opts),
+        storage_(storage) {}
 
   constexpr auto is_autoincrement() const noexcept -> bool {
     using namespace column;
@@ -91,15 +107,29 @@ public:
     return (options_ & Options::Unique) == Options::Unique;
   }
 
+  constexpr auto is_foreign_key() const noexcept -> bool {
+    using namespace column;
+    return (options_ & Options::ForeignKey) == Options::ForeignKey;
+  }
+
+  constexpr auto is_interned() const noexcept -> bool {
+    using namespace column;
+    return (options_ & Options::Interned) == Options::Interned;
+  }
+
   constexpr auto offset() const noexcept -> uint32_t { return offset_; }
   constexpr auto name() const noexcept -> const char * { return name_; }
   constexpr auto type() const noexcept -> column::Type { return type_; }
+  constexpr auto storage() const noexcept -> column::Storage {
+    return storage_;
+  }
 
 private:
   const char *name_;
   uint32_t offset_;
   column::Type type_;
   column::Options options_;
+  column::Storage storage_;
 };
 
 namespace details {
@@ -133,7 +163,11 @@ template <> struct column_type_map<double> {
   static consteval column::Type value() { return column::Type::Double; }
 };
 template <std::size_t P, std::size_t S> struct column_type_map<Decimal<P, S>> {
-  static consteval column::Type value() { return column::Type::Decimal; }
+  static consteval column::Type value() {
+    return P <= details::DecimalTraits::max_precision
+               ? column::Type::Decimal
+               : column::Type::Decimal128;
+  }
 };
 template <> struct column_type_map<std::vector<std::byte>> {
   static consteval column::Type value() { return column::Type::Blob; }
@@ -167,30 +201,59 @@ public:
                                      detail::optional_value_t<T>, T>;
 
   constexpr ColumnMeta(T Class::*mem, const char *name, uint32_t offset,
-                       column::Options opts = column::Options::None)
-      : name_(name), member_(mem), offset_(offset), opts_(opts) {}
+                       column::Options opts = column::Options::None,
+                       column::Storage storage = column::Storage::Text)
+      : name_(name), member_(mem), offset_(offset), opts_(opts),
+        storage_(storage) {}
 
   constexpr auto name() const noexcept -> const char * { return name_; }
   constexpr auto offset() const noexcept -> uint32_t { return offset_; }
 
   [[nodiscard]] constexpr ColumnMeta autoincrement() noexcept {
     return ColumnMeta<Class, T, IsPk>{member_, name_, offset_,
-                                      opts_ | column::Options::AutoIncrement};
+                                      opts_ | column::Options::AutoIncrement,
+                                      storage_};
   }
 
   [[nodiscard]] constexpr auto foreign_key() noexcept {
     return ColumnMeta<Class, T, IsPk>{member_, name_, offset_,
-                                      opts_ | column::Options::ForeignKey};
+                                      opts_ | column::Options::ForeignKey,
+                                      storage_};
   }
 
   [[nodiscard]] constexpr auto primary_key() noexcept {
     return ColumnMeta<Class, T, true>{member_, name_, offset_,
-                                      opts_ | column::Options::PrimaryKey};
+                                      opts_ | column::Options::PrimaryKey,
+                                      storage_};
   }
 
   [[nodiscard]] constexpr ColumnMeta unique() noexcept {
     return ColumnMeta<Class, T, IsPk>{member_, name_, offset_,
-                                      opts_ | column::Options::Unique};
+                                      opts_ | column::Options::Unique,
+                                      storage_};
+  }
+
+  // Low-cardinality text: RowTable stores dictionary ids instead of the
+  // bytes of every value
+  [[nodiscard]] constexpr ColumnMeta interned() noexcept {
+    static_assert(std::is_same_v<value_t, std::string>,
+                  "Only text columns can be interned");
+    return ColumnMeta<Class, T, IsPk>{member_, name_, offset_,
+                                      opts_ | column::Options::Interned,
+                                      storage_};
+  }
+
+  // Integer representation of a date or time column, see column::Storage
+  [[nodiscard]] constexpr ColumnMeta storage(column::Storage storage) {
+    using column::Storage;
+    using column::Type;
+    constexpr Type type = details::column_type_of<value_t>();
+    if ((storage == Storage::EpochDays && type != Type::Date) ||
+        (storage == Storage::UnixSeconds && type != Type::Datetime &&
+         type != Type::Time)) {
+      throw std::invalid_argument("Storage does not match the column type");
+    }
+    return ColumnMeta<Class, T, IsPk>{member_, name_, offset_, opts_, storage};
   }
 
   consteval ColumnInfo info() const noexcept {
@@ -198,7 +261,8 @@ public:
     if constexpr (detail::is_optional_v<value_t>) {
       opts |= column::Options::Optional;
     }
-    return ColumnInfo{name_, offset_, details::column_type_of<value_t>(), opts};
+    return ColumnInfo{name_, offset_, details::column_type_of<value_t>(), opts,
+                      storage_};
   }
 
 private:
@@ -206,6 +270,7 @@ private:
   T Class::*member_;
   uint32_t offset_;
   column::Options opts_;
+  column::Storage storage_;
 };
 
 template <std::size_t N> class ColumnSet {
@@ -305,6 +370,39 @@ consteval auto make_table(const char (&n)[N], Cols... cols) {
   return TableSchema<Class, M, PkType>{
       n, std::array<ColumnInfo, M>{cols.info()...}, std::get<0>(pk_tuple)};
 }
+
+namespace detail {
+// Index into Table<Entity>::meta().columns of member Idx, matched by
+// offset; columns.size() when the member is not mapped
+template <typename Entity, std::size_t Idx>
+consteval std::size_t member_column() {
+  constexpr auto table = Table<Entity>::meta();
+  constexpr std::size_t offset = structure_offsets<Entity>()[Idx];
+  for (std::size_t i = 0; i < table.columns.size(); i++) {
+    if (table.columns[i].offset() == offset) {
+      return i;
+    }
+  }
+  return table.columns.size();
+}
+
+template <typename Entity, std::size_t Idx>
+const auto &member(const Entity &entity) {
+  using fields_t = decltype(structure_to_tuple(std::declval<Entity &>()));
+  using field_t = std::tuple_element_t<Idx, fields_t>;
+  const char *addr = reinterpret_cast<const char *>(&entity) +
+                     structure_offsets<Entity>()[Idx];
+  return *reinterpret_cast<const field_t *>(addr);
+}
+
+template <typename Entity, std::size_t Idx> auto &member(Entity &entity) {
+  using field_t = std::remove_cvref_t<decltype(member<Entity, Idx>(
+      static_cast<const Entity &>(entity)))>;
+  char *addr =
+      reinterpret_cast<char *>(&entity) + structure_offsets<Entity>()[Idx];
+  return *reinterpret_cast<field_t *>(addr);
+}
+} // namespace detail
 } // namespace sqlinq
 
 #endif // SQLINQ_TABLE_HPP_
@@ -0,0 +1,104 @@
+#ifndef SQLINQ_TRACKED_HPP_
+#define SQLINQ_TRACKED_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/type_traits.hpp"
+#include "table.hpp"
+#include "type_traits.hpp"
+
+namespace sqlinq {
+namespace detail {
+template <typename T> bool field_equal(const T &lhs, const T &rhs) {
+  if constexpr (is_optional_v<T>) {
+    if (lhs.has_value() != rhs.has_value()) {
+      return false;
+    }
+    return !lhs.has_value() || field_equal(*lhs, *rhs);
+  } else if constexpr (std::is_same_v<T, Time>) {
+    return lhs.to_duration() == rhs.to_duration();
+  } else {
+    return lhs == rhs;
+  }
+}
+} // namespace detail
+
+/*
+ * Entity together with a snapshot of its stored state. Database::update()
+ * on a tracked entity writes only the columns which differ from the
+ * snapshot and skips the statement when nothing changed.
+ */
+template <typename Entity> class Tracked {
+public:
+  explicit Tracked(Entity entity)
+      : entity_(std::move(entity)), snapshot_(entity_) {}
+
+  Entity &operator*() noexcept { return entity_; }
+  const Entity &operator*() const noexcept { return entity_; }
+  Entity *operator->() noexcept { return &entity_; }
+  const Entity *operator->() const noexcept { return &entity_; }
+
+  Entity &get() noexcept { return entity_; }
+  const Entity &get() const noexcept { return entity_; }
+  const Entity &snapshot() const noexcept { return snapshot_; }
+
+  // Indexes into Table<Entity>::meta().columns of the modified columns
+  std::vector<std::size_t> changed_columns() const {
+    std::vector<std::size_t> changed;
+    [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+      (
+          [&] {
+            constexpr std::size_t col = detail::member_column<Entity, Idx>();
+            if constexpr (col < table_info_.columns.size()) {
+              const auto &now = detail::member<Entity, Idx>(entity_);
+              const auto &was = detail::member<Entity, Idx>(snapshot_);
+              if (!detail::field_equal(now, was)) {
+                changed.push_back(col);
+              }
+            }
+          }(),
+          ...);
+    }(std::make_index_sequence<std::tuple_size_v<fields_t>>{});
+    std::sort(changed.begin(), changed.end());
+    return changed;
+  }
+
+  bool is_dirty() const { return !changed_columns().empty(); }
+
+  // Accepts the current state as the stored one
+  void reset() { snapshot_ = entity_; }
+
+  // Undoes changes of the primary key and autoincrement columns, which
+  // identify the stored row and are never written by Database::update()
+  void revert_keys() {
+    [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+      (
+          [&] {
+            constexpr std::size_t col = detail::member_column<Entity, Idx>();
+            if constexpr (col < table_info_.columns.size()) {
+              if constexpr (table_info_.columns[col].is_primary_key() ||
+                            table_info_.columns[col].is_autoincrement()) {
+                detail::member<Entity, Idx>(entity_) =
+                    detail::member<Entity, Idx>(snapshot_);
+              }
+            }
+          }(),
+          ...);
+    }(std::make_index_sequence<std::tuple_size_v<fields_t>>{});
+  }
+
+private:
+  using fields_t = decltype(structure_to_tuple(std::declval<Entity &>()));
+  static constexpr auto table_info_ = Table<Entity>::meta();
+
+  Entity entity_;
+  Entity snapshot_;
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_TRACKED_HPP_
@@ -1,6 +1,8 @@
 #ifndef UTILITY_TYPE_TRAITS_HPP_
 #define UTILITY_TYPE_TRAITS_HPP_
 
+#include <array>
+#include <cstddef>
 #include <type_traits>
 #include <string_view>
 
@@ -84,6 +86,25 @@ template <AggregateClass C> constexpr auto structure_to_tuple(C &&c) {
   static_assert(struct_size != 0, "Struct does not have any members");
   return detail::structure_to_tuple_impl<C, struct_size>(std::forward<C>(c));
 }
+
+// Byte offsets of the members of C in declaration order, laid out one
+// after another at their alignment
+template <AggregateClass C> constexpr auto structure_offsets() {
+  using fields_t = decltype(structure_to_tuple(std::declval<C &>()));
+  return []<std::size_t... Is>(std::index_sequence<Is...>) {
+    std::array<std::size_t, sizeof...(Is)> offsets{};
+    std::size_t end = 0;
+    auto place = [&](std::size_t idx, std::size_t size, std::size_t align) {
+      end = (end + align - 1) / align * align;
+      offsets[idx] = end;
+      end += size;
+    };
+    (place(Is, sizeof(std::tuple_element_t<Is, fields_t>),
+           alignof(std::tuple_element_t<Is, fields_t>)),
+     ...);
+    return offsets;
+  }(std::make_index_sequence<std::tuple_size_v<fields_t>>{});
+}
 } // namespace utility
 
 #endif /* UTILITY_TYPE_TRAITS_HPP_ */
@@ -5,5 +5,6 @@
 #include "types/datetime.hpp"
 #include "types/decimal.hpp"
 #include "types/varchar.hpp"
+#include "types/view.hpp"
 
 #endif /* SQLINQ_TYPES_H_ */
@@ -1,7 +1,9 @@
 #ifndef SQLINQ_TYPES_DATETIME_HPP_
 #define SQLINQ_TYPES_DATETIME_HPP_
 
+#include <charconv>
 #include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -13,6 +15,29 @@ using Time = std::chrono::hh_mm_ss<std::chrono::seconds>;
 using Datetime = std::chrono::time_point<std::chrono::system_clock>;
 using Timestamp = std::chrono::seconds;
 
+namespace details {
+// Text forms: YYYY-MM-DD, HH:MM:SS and YYYY-MM-DD HH:MM:SS. Years outside
+// 0-9999 and hours above 99 are written with as many digits as they need.
+struct DatetimeTraits {
+  static constexpr std::size_t date_length = 10;
+  static constexpr std::size_t time_length = 8;
+  static constexpr std::size_t datetime_length = 19;
+  static constexpr std::size_t max_str_length = 32;
+};
+
+std::to_chars_result to_chars(char *first, char *last, const Date &) noexcept;
+std::to_chars_result to_chars(char *first, char *last, const Time &) noexcept;
+std::to_chars_result to_chars(char *first, char *last,
+                              const Datetime &) noexcept;
+
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Date &) noexcept;
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Time &) noexcept;
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Datetime &) noexcept;
+} // namespace details
+
 std::string to_string(const Date &);
 std::string to_string(const Time &);
 std::string to_string(const Datetime &);
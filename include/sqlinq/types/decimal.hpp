@@ -1,18 +1,30 @@
 #ifndef SQLINQ_TYPES_DECIMAL_HPP_
 #define SQLINQ_TYPES_DECIMAL_HPP_
 
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <charconv>
 #include <cmath>
 #include <cstdint>
+#include <limits>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace sqlinq {
 
 namespace details {
+#if defined(__SIZEOF_INT128__)
+#define SQLINQ_HAS_INT128 1
+__extension__ typedef __int128 int128_t;
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
 struct DecimalTraits {
   using value_type = int64_t;
+  using unsigned_type = uint64_t;
   static constexpr std::size_t max_precision = 18;
   static constexpr std::size_t max_str_length = max_precision + 2;
   static constexpr value_type nan_sentinel =
@@ -23,6 +35,39 @@ struct DecimalTraits {
   }
 };
 
+#ifdef SQLINQ_HAS_INT128
+// Precision 19-38; powers of ten come from a table
+struct WideDecimalTraits {
+  using value_type = int128_t;
+  using unsigned_type = uint128_t;
+  static constexpr std::size_t max_precision = 38;
+  static constexpr std::size_t max_str_length = max_precision + 3;
+  static constexpr value_type nan_sentinel =
+      -static_cast<value_type>(~unsigned_type{0} >> 1) - 1;
+
+  static constexpr value_type power_of_10(std::size_t exp) {
+    return powers_of_10[exp];
+  }
+
+private:
+  static constexpr auto powers_of_10 = [] {
+    std::array<value_type, max_precision + 1> powers{};
+    powers[0] = 1;
+    for (std::size_t i = 1; i < powers.size(); i++) {
+      powers[i] = powers[i - 1] * 10;
+    }
+    return powers;
+  }();
+};
+
+template <std::size_t Precision>
+using decimal_traits_t =
+    std::conditional_t<(Precision <= DecimalTraits::max_precision),
+                       DecimalTraits, WideDecimalTraits>;
+#else
+template <std::size_t Precision> using decimal_traits_t = DecimalTraits;
+#endif
+
 struct DecimalRuntime {
   using value_type = DecimalTraits::value_type;
 
@@ -38,6 +83,16 @@ std::to_chars_result to_chars(char *first, char *last,
                               const DecimalTraits::value_type &v,
                               std::size_t scale) noexcept;
 
+#ifdef SQLINQ_HAS_INT128
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  WideDecimalTraits::value_type &v,
+                                  std::size_t scale) noexcept;
+
+std::to_chars_result to_chars(char *first, char *last,
+                              const WideDecimalTraits::value_type &v,
+                              std::size_t scale) noexcept;
+#endif
+
 inline std::string to_string(const DecimalRuntime &dr) {
   char buf[details::DecimalTraits::max_str_length + 1];
   auto [ptr, ec] =
@@ -51,14 +106,15 @@ template <std::size_t Precision, std::size_t Scale> class Decimal {
   static_assert(Precision != 0,
                 "Decimal<Precision, Scale>: Precision must be > 0");
   static_assert(
-      Precision <= details::DecimalTraits::max_precision,
+      Precision <= details::decimal_traits_t<Precision>::max_precision,
       "Decimal<Precision, Scale>: Precision must be <= MAX_PRECISION");
   static_assert(Scale < Precision,
                 "Decimal<Precision, Scale>: Scale must be < Precision");
 
 public:
-  using Traits = details::DecimalTraits;
-  using value_type = Traits::value_type;
+  // int64_t up to 18 digits, __int128 above
+  using Traits = details::decimal_traits_t<Precision>;
+  using value_type = typename Traits::value_type;
   static constexpr value_type nan_sentinel = Traits::nan_sentinel;
 
   explicit constexpr Decimal(int v = 0) {
@@ -69,7 +125,7 @@ public:
   }
 
   explicit Decimal(double value) {
-    value_ = (value_type)(round(value * power_of_10(Scale)));
+    value_ = (value_type)(std::round(value * (double)power_of_10(Scale)));
   }
 
   Decimal(std::string_view v) {
@@ -113,7 +169,7 @@ private:
   value_type value_;
   value_type scale_ = Scale;
 
-  constexpr Decimal(int64_t v, int /*tag*/) : value_(v) {}
+  constexpr Decimal(value_type v, int /*tag*/) : value_(v) {}
 
   static constexpr value_type power_of_10(std::size_t exp) {
     return Traits::power_of_10(exp);
@@ -129,8 +185,9 @@ public:
 
 template <std::size_t P, std::size_t S>
 std::string to_string(const Decimal<P, S> &d) {
-  details::DecimalTraits::value_type raw = static_cast<int64_t>(d);
-  char buf[details::DecimalTraits::max_str_length + 1];
+  using Traits = typename Decimal<P, S>::Traits;
+  auto raw = static_cast<typename Traits::value_type>(d);
+  char buf[Traits::max_str_length + 1];
   auto [ptr, ec] = details::to_chars(buf, buf + sizeof(buf), raw, S);
   assert(ec == std::errc{} && "Should never happened");
   return std::string{buf, ptr};
@@ -0,0 +1,163 @@
+#ifndef SQLINQ_TYPES_VIEW_HPP_
+#define SQLINQ_TYPES_VIEW_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "blob.hpp"
+
+namespace sqlinq {
+namespace detail {
+
+/*
+ * Row counter of a cursor. Views remember the row they were read from and
+ * assert on access that the cursor has not moved on since. Debug builds
+ * only; with NDEBUG both classes are empty.
+ */
+class ViewGuard {
+public:
+  ViewGuard() = default;
+#ifndef NDEBUG
+  explicit ViewGuard(std::shared_ptr<const uint64_t> row)
+      : row_(std::move(row)), seen_(*row_) {}
+#endif
+
+  void check() const noexcept {
+#ifndef NDEBUG
+    assert((!row_ || *row_ == seen_) &&
+           "Row view used after the cursor fetched the next row");
+#endif
+  }
+
+private:
+#ifndef NDEBUG
+  std::shared_ptr<const uint64_t> row_;
+  uint64_t seen_ = 0;
+#endif
+};
+
+class RowEpoch {
+public:
+  RowEpoch() = default;
+  RowEpoch(RowEpoch &&) noexcept = default;
+  RowEpoch &operator=(RowEpoch &&) noexcept = default;
+  ~RowEpoch() { advance(); }
+
+  void advance() noexcept {
+#ifndef NDEBUG
+    if (row_) {
+      ++*row_;
+    }
+#endif
+  }
+
+  ViewGuard guard() const {
+#ifndef NDEBUG
+    return ViewGuard{row_};
+#else
+    return ViewGuard{};
+#endif
+  }
+
+private:
+#ifndef NDEBUG
+  std::shared_ptr<uint64_t> row_ = std::make_shared<uint64_t>(0);
+#endif
+};
+} // namespace detail
+
+// Text column pointing into the buffer of the backend; valid until the
+// cursor fetches the next row or is destroyed
+class TextView {
+public:
+  TextView() = default;
+  TextView(std::string_view text, detail::ViewGuard guard)
+      : text_(text), guard_(std::move(guard)) {}
+
+  std::string_view view() const noexcept {
+    guard_.check();
+    return text_;
+  }
+  operator std::string_view() const noexcept { return view(); }
+
+  const char *data() const noexcept { return view().data(); }
+  std::size_t size() const noexcept { return text_.size(); }
+  bool empty() const noexcept { return text_.empty(); }
+  std::string str() const { return std::string{view()}; }
+
+  friend bool operator==(const TextView &lhs, std::string_view rhs) noexcept {
+    return lhs.view() == rhs;
+  }
+
+private:
+  std::string_view text_;
+  detail::ViewGuard guard_;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const TextView &text) {
+  return os << text.view();
+}
+
+// Blob column counterpart of TextView
+class BlobView {
+public:
+  BlobView() = default;
+  BlobView(std::span<const std::byte> bytes, detail::ViewGuard guard)
+      : bytes_(bytes), guard_(std::move(guard)) {}
+
+  std::span<const std::byte> bytes() const noexcept {
+    guard_.check();
+    return bytes_;
+  }
+  operator std::span<const std::byte>() const noexcept { return bytes(); }
+
+  const std::byte *data() const noexcept { return bytes().data(); }
+  std::size_t size() const noexcept { return bytes_.size(); }
+  bool empty() const noexcept { return bytes_.empty(); }
+  Blob to_blob() const { return Blob(bytes().begin(), bytes().end()); }
+
+private:
+  std::span<const std::byte> bytes_;
+  detail::ViewGuard guard_;
+};
+
+// Owning column type -> type read by a view cursor
+template <typename T> struct row_view {
+  using type = T;
+};
+template <> struct row_view<std::string> {
+  using type = TextView;
+};
+template <> struct row_view<Blob> {
+  using type = BlobView;
+};
+template <typename T> struct row_view<std::optional<T>> {
+  using type = std::optional<typename row_view<T>::type>;
+};
+template <typename... Ts> struct row_view<std::tuple<Ts...>> {
+  using type = std::tuple<typename row_view<std::remove_cvref_t<Ts>>::type...>;
+};
+template <typename T> using row_view_t = typename row_view<T>::type;
+
+template <typename T> struct has_row_view : std::false_type {};
+template <> struct has_row_view<TextView> : std::true_type {};
+template <> struct has_row_view<BlobView> : std::true_type {};
+template <typename T>
+struct has_row_view<std::optional<T>> : has_row_view<T> {};
+template <typename... Ts>
+struct has_row_view<std::tuple<Ts...>>
+    : std::disjunction<has_row_view<Ts>...> {};
+template <typename T>
+inline constexpr bool has_row_view_v = has_row_view<T>::value;
+} // namespace sqlinq
+
+#endif /* SQLINQ_TYPES_VIEW_HPP_ */
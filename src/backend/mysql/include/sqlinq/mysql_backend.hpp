@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <mysql/mysql.h>
+#include <vector>
 #include <sqlinq/backend/backend_iface.hpp>
 #include <sqlinq/backend/intermediate_storage.hpp>
 
@@ -17,15 +18,19 @@ public:
   void bind_result(const BindData *bd, const std::size_t size) override;
 
   void connect(const DatabaseConfig &cfg) override;
+  SqlDialect dialect() const noexcept override { return SqlDialect::MySQL; }
   void disconnect() override;
   bool is_connected() const noexcept override { return conn_ != nullptr; }
 
   uint64_t last_inserted_rowid() const noexcept override;
+  bool supports_returning(QueryAst::Operation op) const noexcept override;
 
   void stmt_close() override;
   ExecStatus stmt_execute() override;
   ExecStatus stmt_fetch() override;
+  void stmt_fetch_strategy(const FetchStrategy &strategy) override;
   void stmt_fetch_column(const int index, BindData &bd) override;
+  std::span<const std::byte> stmt_column_view(const int index) override;
   void stmt_init() override;
   void stmt_prepare(std::string_view sql) override;
 
@@ -41,8 +46,12 @@ private:
   MYSQL_STMT *stmt_;
   const BindData *bind_;
   std::size_t bind_size_;
+  FetchStrategy strategy_;
   IntermediateStorage<4096> storage_;
   std::unique_ptr<MYSQL_BIND[]> my_bind_;
+  // Per column buffers behind stmt_column_view(); they only grow, so a scan
+  // stops allocating once the longest value has been seen
+  std::vector<std::vector<std::byte>> view_buffers_;
 };
 } // namespace sqlinq
 
@@ -22,6 +22,26 @@ namespace sqlinq {
 
 constexpr std::size_t MAX_DECIMAL_STR_LEN = 68;
 
+// Decimals travel as text in both directions; Traits picks the raw width
+template <typename Traits>
+std::to_chars_result format_decimal(char *text, const BoundValue &p) {
+  auto value = *(const typename Traits::value_type *)p.ptr();
+  return details::to_chars(text, text + MAX_DECIMAL_STR_LEN, value, p.size());
+}
+
+template <typename Traits>
+void parse_decimal(const char *text, const char *end, void *buffer) {
+  // The server sends the column scale; read the unscaled value in place
+  const char *dot = std::find(text, end, '.');
+  std::size_t scale = dot == end ? 0 : std::size_t(end - dot - 1);
+  typename Traits::value_type raw;
+  auto res = details::from_chars(text, end, raw, scale);
+  if (res.ec != std::errc{}) {
+    raw = Traits::nan_sentinel;
+  }
+  std::memcpy(buffer, &raw, sizeof(raw));
+}
+
 enum_field_types map_buffer_type(column::Type type) {
   switch (type) {
   case column::Type::Bit:
@@ -50,6 +70,7 @@ enum_field_types map_buffer_type(column::Type type) {
   case column::Type::Timestamp:
     return MYSQL_TYPE_DATETIME;
   case column::Type::Decimal:
+  case column::Type::Decimal128:
     return MYSQL_TYPE_STRING;
     break;
   default:
@@ -84,6 +105,7 @@ void MySQLBackend::map_bind_result(const sqlinq::BindData *bd, MYSQL_BIND *mb) {
     mb->buffer = storage_.allocate<MYSQL_TIME>(1);
     break;
   case column::Type::Decimal:
+  case column::Type::Decimal128:
     mb->buffer = storage_.allocate<char>(MAX_DECIMAL_STR_LEN);
     mb->buffer_length = MAX_DECIMAL_STR_LEN;
     mb->length = (unsigned long *)storage_.allocate<unsigned long>(1);
@@ -129,15 +151,19 @@ void MySQLBackend::bind_params(std::span<BoundValue> params) {
       bind[i].length = length;
       break;
     }
-    case column::Type::Decimal: {
-      int64_t value = *(int64_t *)p.ptr();
-      int64_t scale = static_cast<int64_t>(p.size());
-      sqlinq::details::DecimalRuntime decimal{value, scale};
+    case column::Type::Decimal:
+    case column::Type::Decimal128: {
       ulong *length = (ulong *)storage_.allocate<ulong>(1);
-      std::string str = sqlinq::details::to_string(decimal);
-      bind[i].buffer = storage_.allocate<char>(str.size());
-      std::memcpy(bind[i].buffer, str.data(), str.size());
-      bind[i].buffer_length = *length = str.size();
+      char *text = (char *)storage_.allocate<char>(MAX_DECIMAL_STR_LEN);
+#ifdef SQLINQ_HAS_INT128
+      auto res = p.type() == column::Type::Decimal128
+                     ? format_decimal<details::WideDecimalTraits>(text, p)
+                     : format_decimal<details::DecimalTraits>(text, p);
+#else
+      auto res = format_decimal<details::DecimalTraits>(text, p);
+#endif
+      bind[i].buffer = text;
+      bind[i].buffer_length = *length = ulong(res.ptr - text);
       bind[i].length = length;
       break;
     }
@@ -249,6 +275,17 @@ uint64_t MySQLBackend::last_inserted_rowid() const noexcept {
   return mysql_insert_id(conn_);
 }
 
+bool MySQLBackend::supports_returning(
+    QueryAst::Operation op) const noexcept {
+  // MariaDB 10.5 accepts RETURNING on INSERT and DELETE, MySQL not at all
+  if (conn_ == nullptr ||
+      std::strstr(mysql_get_server_info(conn_), "MariaDB") == nullptr) {
+    return false;
+  }
+  return op != QueryAst::Operation::Update &&
+         mysql_get_server_version(conn_) >= 100500;
+}
+
 void MySQLBackend::stmt_close() {
   my_bind_.reset();
   storage_.clear();
@@ -262,9 +299,28 @@ ExecStatus MySQLBackend::stmt_execute() {
   if (mysql_stmt_execute(stmt_)) {
     throw std::runtime_error(mysql_stmt_error(stmt_));
   }
+  if (strategy_.mode == FetchStrategy::Mode::Buffered &&
+      mysql_stmt_store_result(stmt_)) {
+    throw std::runtime_error(mysql_stmt_error(stmt_));
+  }
   return ExecStatus::Ok;
 }
 
+void MySQLBackend::stmt_fetch_strategy(const FetchStrategy &strategy) {
+  unsigned long cursor_type = CURSOR_TYPE_NO_CURSOR;
+  unsigned long prefetch_rows = 1;
+  if (strategy.mode == FetchStrategy::Mode::ServerCursor) {
+    cursor_type = CURSOR_TYPE_READ_ONLY;
+    prefetch_rows = static_cast<unsigned long>(
+        std::max<std::size_t>(strategy.prefetch_rows, 1));
+  }
+  if (mysql_stmt_attr_set(stmt_, STMT_ATTR_CURSOR_TYPE, &cursor_type) ||
+      mysql_stmt_attr_set(stmt_, STMT_ATTR_PREFETCH_ROWS, &prefetch_rows)) {
+    throw std::runtime_error(mysql_stmt_error(stmt_));
+  }
+  strategy_ = strategy;
+}
+
 void MySQLBackend::stmt_fetch_column(const int index, BindData &bd) {
   MYSQL_BIND bind;
   map_bind_data(&bd, &bind);
@@ -273,6 +329,26 @@ void MySQLBackend::stmt_fetch_column(const int index, BindData &bd) {
   }
 }
 
+// The C API has no access to the row buffer of a prepared statement, the
+// value is fetched once into a buffer which is reused for later rows
+std::span<const std::byte> MySQLBackend::stmt_column_view(const int index) {
+  if (view_buffers_.size() < bind_size_) {
+    view_buffers_.resize(bind_size_);
+  }
+  std::vector<std::byte> &buffer = view_buffers_[(std::size_t)index];
+  std::size_t length = *bind_[index].length;
+  if (buffer.size() < length) {
+    buffer.resize(length);
+  }
+  if (length != 0) {
+    BindData bd = bind_[index];
+    bd.buffer = buffer.data();
+    bd.buffer_length = length;
+    stmt_fetch_column(index, bd);
+  }
+  return {buffer.data(), length};
+}
+
 ExecStatus MySQLBackend::stmt_fetch() {
   int status = mysql_stmt_fetch(stmt_);
   if (status == 1) {
@@ -328,12 +404,19 @@ ExecStatus MySQLBackend::stmt_fetch() {
       break;
     }
     case column::Type::Decimal: {
-      std::string s{(const char *)my_bind_[i].buffer, *my_bind_[i].length};
-      s.erase(std::remove(s.begin(), s.end(), '.'), s.end());
-      sqlinq::Decimal<18, 0> decimal{s};
-      std::memcpy(bind_[i].buffer, &decimal, sizeof(decimal));
+      const char *text = (const char *)my_bind_[i].buffer;
+      parse_decimal<details::DecimalTraits>(text, text + *my_bind_[i].length,
+                                            bind_[i].buffer);
       break;
     }
+#ifdef SQLINQ_HAS_INT128
+    case column::Type::Decimal128: {
+      const char *text = (const char *)my_bind_[i].buffer;
+      parse_decimal<details::WideDecimalTraits>(
+          text, text + *my_bind_[i].length, bind_[i].buffer);
+      break;
+    }
+#endif
     default:
       continue;
     }
@@ -346,6 +429,7 @@ ExecStatus MySQLBackend::stmt_fetch() {
 }
 
 void MySQLBackend::stmt_init() {
+  strategy_ = FetchStrategy{};
   stmt_ = mysql_stmt_init(conn_);
   if (stmt_ == nullptr) {
     throw std::bad_alloc();
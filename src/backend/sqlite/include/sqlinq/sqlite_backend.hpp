@@ -1,15 +1,33 @@
 #ifndef SQLINQ_SQLITE_BACKEND_HPP_
 #define SQLINQ_SQLITE_BACKEND_HPP_
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
 #include <sqlinq/backend/backend_iface.hpp>
 #include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace sqlinq {
+
+// Row written through a connection, as reported by sqlite3_update_hook()
+struct RowChange {
+  enum class Op { Insert, Update, Delete };
+  Op op;
+  std::string table;
+  int64_t rowid;
+};
+
 class SQLiteBackend final : public BackendIface {
 public:
+  using ChangeHook = std::function<void(std::span<const RowChange>)>;
+
   explicit SQLiteBackend()
       : db_(nullptr), stmt_(nullptr), truncated_(false), bind_(nullptr),
-        bind_size_(0), stmt_exec_status_(ExecStatus::Ok) {}
+        bind_size_(0), stmt_exec_status_(ExecStatus::Ok), next_hook_id_(0) {}
 
   ~SQLiteBackend();
 
@@ -17,18 +35,36 @@ public:
   void bind_result(const BindData *bd, const std::size_t size) override;
 
   void connect(const DatabaseConfig &cfg) override;
+  SqlDialect dialect() const noexcept override { return SqlDialect::SQLite; }
   void disconnect() override;
   bool is_connected() const noexcept override { return db_ != nullptr; }
 
   uint64_t last_inserted_rowid() const noexcept override;
+  // False in autocommit mode, also after SQLite rolled a transaction back
+  bool in_transaction() const noexcept;
+  bool supports_returning(QueryAst::Operation op) const noexcept override;
 
   void stmt_close() override;
   ExecStatus stmt_execute() override;
   ExecStatus stmt_fetch() override;
+  // Rows are always stepped in process, there is nothing to configure
+  void stmt_fetch_strategy(const FetchStrategy &) noexcept override {}
   void stmt_fetch_column(const int index, BindData &bd) override;
+  std::span<const std::byte> stmt_column_view(const int index) override;
   void stmt_init() noexcept override {}
   void stmt_prepare(std::string_view sql) override;
 
+  /*
+   * Registers fn to receive the rows changed by each transaction committed
+   * on this connection. It runs on the committing thread right after the
+   * commit; rolled back changes are never reported. SQLite does not report
+   * WITHOUT ROWID tables nor a DELETE without WHERE (truncate optimization).
+   * Exceptions thrown by fn are ignored. Returns an id for
+   * remove_change_hook().
+   */
+  std::size_t add_change_hook(ChangeHook fn);
+  void remove_change_hook(std::size_t id);
+
 private:
   sqlite3 *db_;
   sqlite3_stmt *stmt_;
@@ -36,6 +72,14 @@ private:
   const BindData *bind_;
   std::size_t bind_size_;
   ExecStatus stmt_exec_status_;
+
+  std::vector<std::pair<std::size_t, ChangeHook>> change_hooks_;
+  std::vector<RowChange> changes_;   // current transaction
+  std::vector<RowChange> committed_; // passed the commit hook
+  std::size_t next_hook_id_;
+
+  void install_hooks() noexcept;
+  void flush_changes() noexcept;
 };
 } // namespace sqlinq
 
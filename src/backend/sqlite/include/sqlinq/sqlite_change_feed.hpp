@@ -0,0 +1,132 @@
+#ifndef SQLINQ_SQLITE_CHANGE_FEED_HPP_
+#define SQLINQ_SQLITE_CHANGE_FEED_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sqlite_database.hpp"
+
+namespace sqlinq {
+
+// Rows of one or more committed transactions, in commit order
+struct ChangeBatch {
+  std::vector<RowChange> changes;
+  // Earlier batches were dropped because the queue was full; the subscriber
+  // has to resynchronize from the tables
+  bool overrun = false;
+};
+
+/*
+ * Delivers the rows committed through a SQLite connection to subscribers.
+ * Changes are collected per transaction by the update, commit and rollback
+ * hooks of the connection and published once the commit has completed, so
+ * subscribers never see rolled back rows.
+ *
+ * Every subscription owns a bounded queue and a thread which calls its
+ * handler, so a slow subscriber does not delay the others. When the queue is
+ * full the committing thread either waits (Overflow::Block) or the queued
+ * batches are dropped and the next batch is flagged as overrun
+ * (Overflow::Resync). Exceptions thrown by a handler are ignored.
+ *
+ * With Overflow::Block a handler must not wait for a write on the observed
+ * connection. Changes which SQLite does not report to the update hook are
+ * missing as well: WITHOUT ROWID tables, DELETE without WHERE and rows of a
+ * savepoint which was rolled back inside a committed transaction.
+ */
+class SQLiteChangeFeed {
+public:
+  enum class Overflow { Block, Resync };
+
+  struct Options {
+    std::size_t capacity = 1024; // batches
+    Overflow overflow = Overflow::Block;
+  };
+
+  using Handler = std::function<void(const ChangeBatch &)>;
+
+private:
+  struct Subscriber;
+
+public:
+  // Delivery stops, after the queued batches, when the subscription is
+  // destroyed or cancelled
+  class Subscription {
+  public:
+    Subscription() = default;
+    Subscription(Subscription &&) noexcept = default;
+    Subscription &operator=(Subscription &&other) noexcept {
+      cancel();
+      subscriber_ = std::move(other.subscriber_);
+      return *this;
+    }
+    ~Subscription() { cancel(); }
+
+    void cancel();
+    // Batches waiting for the handler
+    std::size_t pending() const;
+
+  private:
+    friend class SQLiteChangeFeed;
+    explicit Subscription(std::shared_ptr<Subscriber> s)
+        : subscriber_(std::move(s)) {}
+
+    std::shared_ptr<Subscriber> subscriber_;
+  };
+
+  explicit SQLiteChangeFeed(SQLiteBackend &backend);
+  explicit SQLiteChangeFeed(SQLiteDatabase &db);
+  ~SQLiteChangeFeed();
+
+  SQLiteChangeFeed(const SQLiteChangeFeed &) = delete;
+  SQLiteChangeFeed &operator=(const SQLiteChangeFeed &) = delete;
+
+  // Subscribes to the given tables, all tables when the list is empty
+  [[nodiscard]] Subscription subscribe(std::vector<std::string> tables,
+                                       Handler fn, Options opts);
+  [[nodiscard]] Subscription subscribe(std::vector<std::string> tables,
+                                       Handler fn) {
+    return subscribe(std::move(tables), std::move(fn), Options{});
+  }
+
+  template <typename Entity>
+  [[nodiscard]] Subscription subscribe(Handler fn, Options opts = {}) {
+    return subscribe({std::string{Table<Entity>::meta().name}}, std::move(fn),
+                     opts);
+  }
+
+private:
+  std::function<void()> detach_;
+  std::mutex mtx_;
+  std::vector<std::shared_ptr<Subscriber>> subscribers_;
+
+  void publish(std::span<const RowChange> changes);
+};
+
+struct SQLiteChangeFeed::Subscriber {
+  std::vector<std::string> tables;
+  Handler fn;
+  Options opts;
+
+  mutable std::mutex mtx;
+  std::condition_variable ready_cv;
+  std::condition_variable space_cv;
+  std::deque<ChangeBatch> queue;
+  bool overrun = false;
+  bool closed = false;
+  std::thread worker;
+
+  void push(std::span<const RowChange> changes);
+  void close();
+  void run();
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_SQLITE_CHANGE_FEED_HPP_
@@ -0,0 +1,205 @@
+#ifndef SQLINQ_SQLITE_DATABASE_HPP_
+#define SQLINQ_SQLITE_DATABASE_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sqlinq/connection_pool.hpp>
+#include <sqlinq/database.hpp>
+#include <sqlinq/parallel_scan.hpp>
+#include <sqlinq/sqlite_backend.hpp>
+
+namespace sqlinq {
+
+/*
+ * SQLite front end for WAL databases: one writer connection plus a pool of
+ * read-only connections. Queries are routed to a reader, mutations to the
+ * writer. Writers are served in arrival order, one at a time.
+ *
+ * The database has to be a file; readers cannot see an in-memory database
+ * opened by the writer. The writer switches it to WAL mode unless the
+ * config sets a journal_mode, and throws when that is not possible.
+ */
+class SQLiteDatabase {
+public:
+  using reader_pool = ConnectionPool<SQLiteBackend>;
+  template <typename T> using cursor = PooledCursor<SQLiteBackend, T>;
+
+  // readers == 0 selects std::thread::hardware_concurrency()
+  explicit SQLiteDatabase(const DatabaseConfig &cfg, std::size_t readers = 0);
+
+  SQLiteDatabase(const SQLiteDatabase &) = delete;
+  SQLiteDatabase &operator=(const SQLiteDatabase &) = delete;
+
+  template <typename Entity>
+  [[nodiscard]] auto find(auto &&val) -> std::optional<Entity> {
+    auto lease = readers_.acquire();
+    return Database{*lease, cache_}.find<Entity>(std::forward<decltype(val)>(val));
+  }
+
+  template <typename Entity>
+  auto get_all(int skip = 0, int fetch = 50) -> cursor<Entity> {
+    return cursor<Entity>{readers_.acquire(), [&](BackendIface &b) {
+                            return Database{b, cache_}.get_all<Entity>(skip, fetch);
+                          }};
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto execute(SelectQuery<Entity, Ts...> &q) {
+    using return_type =
+        std::conditional_t<(sizeof...(Ts) > 0), std::tuple<Ts...>, Entity>;
+    return cursor<return_type>{
+        readers_.acquire(),
+        [&](BackendIface &b) { return Database{b, cache_}.execute(q); }};
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto execute(JoinQuery<Entity, Ts...> &q) {
+    return cursor<Joined<Entity, Ts...>>{
+        readers_.acquire(),
+        [&](BackendIface &b) { return Database{b, cache_}.execute(q); }};
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_vector(JoinQuery<Entity, Ts...> &q) {
+    auto lease = readers_.acquire();
+    return Database{*lease, cache_}.to_vector(q);
+  }
+
+  // Each query of the loader runs on a reader; see Database::load()
+  template <typename Entity> [[nodiscard]] auto load(SelectQuery<Entity> &q) {
+    return EagerLoader<SQLiteDatabase, Entity>{*this, q};
+  }
+
+  // Text and blob columns as views; see Database::execute_view()
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto execute_view(SelectQuery<Entity, Ts...> &q) {
+    using view_cursor = decltype(std::declval<Database &>().execute_view(q));
+    return cursor<typename view_cursor::value_type>{
+        readers_.acquire(),
+        [&](BackendIface &b) { return Database{b, cache_}.execute_view(q); }};
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_vector(SelectQuery<Entity, Ts...> &q) {
+    auto lease = readers_.acquire();
+    return Database{*lease, cache_}.to_vector(q);
+  }
+
+  template <typename Entity, typename... Ts>
+  [[nodiscard]] auto to_table(SelectQuery<Entity, Ts...> &q,
+                              std::size_t reserve_rows = 0) {
+    auto lease = readers_.acquire();
+    return Database{*lease, cache_}.to_table(q, reserve_rows);
+  }
+
+  // Full scan split across the readers; see sqlinq::parallel_scan()
+  template <typename Entity, typename Fn>
+  void parallel_scan(std::size_t partitions, Fn &&fn,
+                     std::size_t batch_rows = 256) {
+    sqlinq::parallel_scan<Entity>(readers_, partitions, std::forward<Fn>(fn),
+                                  batch_rows);
+  }
+
+  template <typename Entity>
+  [[nodiscard]] auto parallel_to_vector(std::size_t partitions = 0) {
+    return sqlinq::parallel_to_vector<Entity>(readers_, partitions);
+  }
+
+  template <typename Entity> auto create(Entity &entity) {
+    return with_writer([&](Database &db) { return db.create(entity); });
+  }
+
+  template <typename Entity> void update(const Entity &entity) {
+    with_writer([&](Database &db) { db.update(entity); });
+  }
+
+  template <typename Entity> bool update(Tracked<Entity> &tracked) {
+    return with_writer([&](Database &db) { return db.update(tracked); });
+  }
+
+  template <typename Entity> void save(Entity &entity) {
+    with_writer([&](Database &db) { db.save(entity); });
+  }
+
+  template <typename Entity> void save(std::span<Entity> entities) {
+    with_writer([&](Database &db) { db.save(entities); });
+  }
+
+  template <typename Entity> void remove(auto &&val) {
+    with_writer([&](Database &db) {
+      db.remove<Entity>(std::forward<decltype(val)>(val));
+    });
+  }
+
+  template <typename Entity> void execute(InsertQuery<Entity> &q) {
+    with_writer([&](Database &db) { db.execute(q); });
+  }
+
+  template <typename Entity> void execute(WhereQuery<Entity> &q) {
+    with_writer([&](Database &db) { db.execute(q); });
+  }
+
+  // Rows written by the query; they are read before the writer is released
+  template <typename Entity>
+  [[nodiscard]] auto to_vector(ReturningQuery<Entity> &q) {
+    return with_writer([&](Database &db) { return db.to_vector(q); });
+  }
+
+  // Runs fn(Database &) on the writer connection once all earlier writers
+  // have finished.
+  template <typename Fn> decltype(auto) with_writer(Fn &&fn) {
+    WriteTicket ticket{*this};
+    Database db{writer_, cache_};
+    return std::forward<Fn>(fn)(db);
+  }
+
+  reader_pool &readers() noexcept { return readers_; }
+
+  /*
+   * Serves selects from cache; it must outlive the database. Besides the
+   * mutations of this class, every transaction committed by the writer
+   * connection, including raw statements run with with_writer(), invalidates
+   * the tables it changed. Writes made by other processes are not seen.
+   */
+  void attach_cache(QueryCache &cache);
+
+  // Change hooks of the writer connection; see SQLiteBackend::add_change_hook()
+  std::size_t add_change_hook(SQLiteBackend::ChangeHook fn);
+  void remove_change_hook(std::size_t id);
+
+private:
+  // checks the transaction state of the writer between its statements
+  friend class SQLiteWriteQueue;
+
+  class WriteTicket {
+  public:
+    explicit WriteTicket(SQLiteDatabase &db) : db_(db) { db_.acquire_write(); }
+    ~WriteTicket() { db_.release_write(); }
+
+    WriteTicket(const WriteTicket &) = delete;
+    WriteTicket &operator=(const WriteTicket &) = delete;
+
+  private:
+    SQLiteDatabase &db_;
+  };
+
+  SQLiteBackend writer_;
+  reader_pool readers_;
+  QueryCache *cache_ = nullptr;
+
+  std::mutex write_mtx_;
+  std::condition_variable write_cv_;
+  uint64_t next_ticket_;
+  uint64_t serving_ticket_;
+
+  void acquire_write();
+  void release_write() noexcept;
+
+  static const DatabaseConfig &connect_writer(SQLiteBackend &writer,
+                                              const DatabaseConfig &cfg);
+  static DatabaseConfig reader_config(const DatabaseConfig &cfg);
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_SQLITE_DATABASE_HPP_
@@ -0,0 +1,98 @@
+#ifndef SQLINQ_SQLITE_WRITE_QUEUE_HPP_
+#define SQLINQ_SQLITE_WRITE_QUEUE_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "sqlite_database.hpp"
+
+namespace sqlinq {
+
+/*
+ * Asynchronous write path for SQLiteDatabase. Mutations are turned into
+ * statements owning their parameters and queued; a single thread drains the
+ * queue and commits up to max_batch statements per transaction.
+ *
+ * A failing statement only fails its own future, the rest of the batch is
+ * still committed; when SQLite rolls the whole transaction back on such an
+ * error, the statements before it are run again in a new one. If the
+ * commit itself fails, every future of the batch receives the error. The
+ * destructor waits until the queue is drained.
+ */
+class SQLiteWriteQueue {
+public:
+  explicit SQLiteWriteQueue(SQLiteDatabase &db, std::size_t max_batch = 256);
+  ~SQLiteWriteQueue();
+
+  SQLiteWriteQueue(const SQLiteWriteQueue &) = delete;
+  SQLiteWriteQueue &operator=(const SQLiteWriteQueue &) = delete;
+
+  // The future holds the rowid of the inserted row
+  template <typename Entity>
+  [[nodiscard]] std::future<uint64_t> create(const Entity &entity) {
+    return push<uint64_t>(Database::insert_statement(entity));
+  }
+
+  template <typename Entity>
+  [[nodiscard]] std::future<void> update(const Entity &entity) {
+    return push<void>(Database::update_statement(entity));
+  }
+
+  template <typename Entity>
+  [[nodiscard]] std::future<void> remove(auto &&val) {
+    return push<void>(
+        Database::remove_statement<Entity>(std::forward<decltype(val)>(val)));
+  }
+
+  template <typename Entity>
+  [[nodiscard]] std::future<uint64_t> execute(InsertQuery<Entity> &q) {
+    return push<uint64_t>(Database::insert_statement(q, SqlDialect::SQLite));
+  }
+
+  template <typename Entity>
+  [[nodiscard]] std::future<void> execute(WhereQuery<Entity> &q) {
+    return push<void>(Database::where_statement(q, SqlDialect::SQLite));
+  }
+
+  std::size_t pending() const;
+
+private:
+  struct Op {
+    Statement stmt;
+    std::variant<std::promise<void>, std::promise<uint64_t>> result;
+  };
+
+  SQLiteDatabase &db_;
+  std::size_t max_batch_;
+  std::deque<Op> queue_;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stop_;
+  std::thread worker_;
+
+  template <typename R> std::future<R> push(Statement &&stmt) {
+    Op op;
+    op.stmt.sql = std::move(stmt.sql);
+    op.stmt.params.reserve(stmt.params.size());
+    for (auto &p : stmt.params) {
+      op.stmt.params.emplace_back(p.clone());
+    }
+    auto &promise = op.result.template emplace<std::promise<R>>();
+    std::future<R> future = promise.get_future();
+    enqueue(std::move(op));
+    return future;
+  }
+
+  void enqueue(Op &&op);
+  void run();
+  void commit(std::vector<Op> &batch);
+};
+} // namespace sqlinq
+
+#endif // SQLINQ_SQLITE_WRITE_QUEUE_HPP_
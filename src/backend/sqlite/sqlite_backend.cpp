@@ -2,6 +2,7 @@
 #include "sqlinq/backend/backend_iface.hpp"
 #include "sqlinq/config.hpp"
 #include <cassert>
+#include <cctype>
 #include <cstring>
 #include <sqlinq/types.h>
 #include <stdexcept>
@@ -112,12 +113,13 @@ void fetch_datetime_column(sqlite3_stmt *stmt, const int index,
   if (bind.type == column::Type::Timestamp) {
     assert(col_type == SQLITE_INTEGER && "Invalid column type");
   } else {
-    assert(col_type == SQLITE_TEXT && "Invalid column type");
+    assert((col_type == SQLITE_TEXT || col_type == SQLITE_INTEGER) &&
+           "Invalid column type");
   }
   if (bind.error != nullptr) {
     *bind.error = bind.type == column::Type::Timestamp
                       ? col_type == SQLITE_INTEGER
-                      : col_type != SQLITE_TEXT;
+                      : col_type != SQLITE_TEXT && col_type != SQLITE_INTEGER;
   }
 
   if (bind.is_null != nullptr) {
@@ -128,26 +130,44 @@ void fetch_datetime_column(sqlite3_stmt *stmt, const int index,
     return;
   }
 
-  const char *data;
+  // Integer columns hold the value in column::Storage form
+  const bool integer = col_type == SQLITE_INTEGER;
+  const char *data = nullptr;
+  const char *end = nullptr;
+  if (!integer) {
+    data = (const char *)sqlite3_column_text(stmt, index);
+    end = data + sqlite3_column_bytes(stmt, index);
+  }
   switch (bind.type) {
   case column::Type::Date: {
-    data = (const char *)sqlite3_column_text(stmt, index);
     sqlinq::Date date;
-    sqlinq::from_string(data, date);
+    if (integer) {
+      date = Date{std::chrono::sys_days{
+          std::chrono::days{sqlite3_column_int64(stmt, index)}}};
+    } else {
+      sqlinq::details::from_chars(data, end, date);
+    }
     memcpy(bind.buffer, (void *)&date, sizeof(date));
     break;
   }
   case column::Type::Time: {
-    data = (const char *)sqlite3_column_text(stmt, index);
     sqlinq::Time time;
-    sqlinq::from_string(data, time);
+    if (integer) {
+      time = Time{std::chrono::seconds{sqlite3_column_int64(stmt, index)}};
+    } else {
+      sqlinq::details::from_chars(data, end, time);
+    }
     memcpy(bind.buffer, (void *)&time, sizeof(time));
     break;
   }
   case column::Type::Datetime: {
-    data = (const char *)sqlite3_column_text(stmt, index);
     sqlinq::Datetime dt;
-    sqlinq::from_string(data, dt);
+    if (integer) {
+      dt = std::chrono::sys_seconds{
+          std::chrono::seconds{sqlite3_column_int64(stmt, index)}};
+    } else {
+      sqlinq::details::from_chars(data, end, dt);
+    }
     memcpy(bind.buffer, (void *)&dt, sizeof(dt));
     break;
   }
@@ -184,6 +204,141 @@ void fetch_decimal_column(sqlite3_stmt *stmt, const int index,
   memcpy(bind.buffer, (void *)&decimal, sizeof(decimal));
 }
 
+#ifdef SQLINQ_HAS_INT128
+/*
+ * Decimal128 values are stored as 16 byte big endian blobs with the sign bit
+ * flipped, so memcmp order (and ORDER BY) matches numeric order.
+ */
+constexpr std::size_t wide_blob_size = sizeof(details::int128_t);
+
+void encode_wide(details::int128_t v, unsigned char (&out)[wide_blob_size]) {
+  auto u = static_cast<details::uint128_t>(v) ^
+           (details::uint128_t{1} << (8 * wide_blob_size - 1));
+  for (std::size_t i = wide_blob_size; i-- > 0;) {
+    out[i] = static_cast<unsigned char>(u);
+    u >>= 8;
+  }
+}
+
+details::int128_t decode_wide(const unsigned char *in) {
+  details::uint128_t u = 0;
+  for (std::size_t i = 0; i < wide_blob_size; i++) {
+    u = u << 8 | in[i];
+  }
+  u ^= details::uint128_t{1} << (8 * wide_blob_size - 1);
+  return static_cast<details::int128_t>(u);
+}
+
+void fetch_wide_decimal_column(sqlite3_stmt *stmt, const int index,
+                               const BindData &bind) {
+  int col_type = sqlite3_column_type(stmt, index);
+  bool valid =
+      col_type == SQLITE_INTEGER ||
+      (col_type == SQLITE_BLOB &&
+       sqlite3_column_bytes(stmt, index) == int(wide_blob_size));
+  assert(valid && "Invalid column type");
+  if (bind.error != nullptr) {
+    *bind.error = !valid;
+  }
+
+  if (bind.is_null != nullptr) {
+    *bind.is_null = false;
+  }
+
+  if (bind.buffer == nullptr || !valid) {
+    return;
+  }
+
+  // Integers come from rows written by hand or by SQL arithmetic
+  details::int128_t raw =
+      col_type == SQLITE_INTEGER
+          ? details::int128_t{sqlite3_column_int64(stmt, index)}
+          : decode_wide(static_cast<const unsigned char *>(
+                sqlite3_column_blob(stmt, index)));
+  memcpy(bind.buffer, &raw, sizeof(raw));
+}
+#endif
+
+int parse_open_flags(std::string_view flags) {
+  int result = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  while (!flags.empty()) {
+    std::size_t pos = flags.find_first_of(",|");
+    std::string flag = trim(std::string{flags.substr(0, pos)});
+    flags = (pos == std::string_view::npos) ? std::string_view{}
+                                            : flags.substr(pos + 1);
+    if (flag.empty()) {
+      continue;
+    } else if (flag == "readonly") {
+      result &= ~(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+      result |= SQLITE_OPEN_READONLY;
+    } else if (flag == "nocreate") {
+      result &= ~SQLITE_OPEN_CREATE;
+    } else if (flag == "nomutex") {
+      result |= SQLITE_OPEN_NOMUTEX;
+    } else if (flag == "fullmutex") {
+      result |= SQLITE_OPEN_FULLMUTEX;
+    } else if (flag == "sharedcache") {
+      result |= SQLITE_OPEN_SHAREDCACHE;
+    } else if (flag == "privatecache") {
+      result |= SQLITE_OPEN_PRIVATECACHE;
+    } else if (flag == "uri") {
+      result |= SQLITE_OPEN_URI;
+    } else if (flag == "memory") {
+      result |= SQLITE_OPEN_MEMORY;
+    } else {
+      throw std::invalid_argument("Unknown sqlite open flag: " + flag);
+    }
+  }
+  return result;
+}
+
+void exec_pragma(sqlite3 *db, std::string_view name, std::string_view value) {
+  bool valid = !value.empty();
+  for (char c : value) {
+    valid = valid && (std::isalnum((unsigned char)c) || c == '-');
+  }
+  if (!valid) {
+    throw std::invalid_argument("Invalid value for PRAGMA " +
+                                std::string{name});
+  }
+
+  std::string sql{"PRAGMA "};
+  sql += name;
+  sql += '=';
+  sql += value;
+  char *errmsg = nullptr;
+  if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errmsg) != SQLITE_OK) {
+    std::string msg = errmsg ? errmsg : sqlite3_errmsg(db);
+    sqlite3_free(errmsg);
+    throw std::runtime_error("Failed to apply " + sql + ": " + msg);
+  }
+}
+
+void apply_options(sqlite3 *db, const SQLiteOptions &opts) {
+  // page_size has to be set before the database switches to WAL mode
+  if (opts.page_size) {
+    exec_pragma(db, "page_size", std::to_string(*opts.page_size));
+  }
+  if (opts.busy_timeout) {
+    sqlite3_busy_timeout(db, *opts.busy_timeout);
+  }
+  if (opts.journal_mode) {
+    exec_pragma(db, "journal_mode", *opts.journal_mode);
+  }
+  if (opts.synchronous) {
+    exec_pragma(db, "synchronous", *opts.synchronous);
+  }
+  if (opts.cache_size) {
+    exec_pragma(db, "cache_size", std::to_string(*opts.cache_size));
+  }
+  if (opts.mmap_size) {
+    exec_pragma(db, "mmap_size", std::to_string(*opts.mmap_size));
+  }
+  if (opts.temp_store) {
+    exec_pragma(db, "temp_store", *opts.temp_store);
+  }
+}
+
 SQLiteBackend::~SQLiteBackend() {
   stmt_close();
   if (db_ != nullptr) {
@@ -196,7 +351,8 @@ void SQLiteBackend::bind_params(std::span<BoundValue> params) {
   sqlite3_reset(stmt_);
   sqlite3_clear_bindings(stmt_);
   for (int idx = 1; idx <= static_cast<int>(params.size()); idx++) {
-    std::string s;
+    char buf[details::DatetimeTraits::max_str_length];
+    std::to_chars_result res{};
     BoundValue &p = params[std::size_t(idx) - 1];
     switch (p.type()) {
     case column::Type::Null:
@@ -226,22 +382,46 @@ void SQLiteBackend::bind_params(std::span<BoundValue> params) {
     case column::Type::Blob:
       rc = sqlite3_bind_blob(stmt_, idx, (char *)p.ptr(), (int)p.size(), NULL);
       break;
+#ifdef SQLINQ_HAS_INT128
+    case column::Type::Decimal128: {
+      unsigned char blob[wide_blob_size];
+      encode_wide(*(const details::int128_t *)p.ptr(), blob);
+      rc = sqlite3_bind_blob(stmt_, idx, blob, sizeof(blob), SQLITE_TRANSIENT);
+      break;
+    }
+#endif
     case column::Type::Text:
       rc = sqlite3_bind_text(stmt_, idx, (char *)p.ptr(), (int)p.size(), NULL);
       break;
     case column::Type::Date:
-      s = sqlinq::to_string(*(Date *)p.ptr());
-      rc = sqlite3_bind_text(stmt_, idx, (char *)s.data(), (int)s.size(),
+      if (p.storage() == column::Storage::EpochDays) {
+        auto days = std::chrono::sys_days{*(Date *)p.ptr()};
+        rc = sqlite3_bind_int64(stmt_, idx, days.time_since_epoch().count());
+        break;
+      }
+      res = details::to_chars(buf, buf + sizeof(buf), *(Date *)p.ptr());
+      rc = sqlite3_bind_text(stmt_, idx, buf, (int)(res.ptr - buf),
                              SQLITE_TRANSIENT);
       break;
     case column::Type::Time:
-      s = sqlinq::to_string(*(Time *)p.ptr());
-      rc = sqlite3_bind_text(stmt_, idx, (char *)s.data(), (int)s.size(),
+      if (p.storage() == column::Storage::UnixSeconds) {
+        auto secs = ((Time *)p.ptr())->to_duration();
+        rc = sqlite3_bind_int64(stmt_, idx, secs.count());
+        break;
+      }
+      res = details::to_chars(buf, buf + sizeof(buf), *(Time *)p.ptr());
+      rc = sqlite3_bind_text(stmt_, idx, buf, (int)(res.ptr - buf),
                              SQLITE_TRANSIENT);
       break;
     case column::Type::Datetime:
-      s = sqlinq::to_string(*(Datetime *)p.ptr());
-      rc = sqlite3_bind_text(stmt_, idx, (char *)s.data(), (int)s.size(),
+      if (p.storage() == column::Storage::UnixSeconds) {
+        auto secs = std::chrono::floor<std::chrono::seconds>(
+            *(Datetime *)p.ptr());
+        rc = sqlite3_bind_int64(stmt_, idx, secs.time_since_epoch().count());
+        break;
+      }
+      res = details::to_chars(buf, buf + sizeof(buf), *(Datetime *)p.ptr());
+      rc = sqlite3_bind_text(stmt_, idx, buf, (int)(res.ptr - buf),
                              SQLITE_TRANSIENT);
       break;
     }
@@ -262,9 +442,23 @@ void SQLiteBackend::connect(const DatabaseConfig &cfg) {
   if (fname.empty()) {
     throw std::runtime_error("sqlite database field required");
   }
-  if (int rc = sqlite3_open(fname.c_str(), &db_); rc != SQLITE_OK) {
+
+  SQLiteOptions opts = cfg.sqlite;
+  apply_sqlite_preset(opts);
+  int flags = parse_open_flags(opts.open_flags);
+  if (int rc = sqlite3_open_v2(fname.c_str(), &db_, flags, nullptr);
+      rc != SQLITE_OK) {
+    disconnect();
     throw std::runtime_error("Failed to open database: " + fname);
   }
+
+  try {
+    apply_options(db_, opts);
+  } catch (...) {
+    disconnect();
+    throw;
+  }
+  install_hooks();
 }
 
 void SQLiteBackend::disconnect() {
@@ -279,15 +473,26 @@ uint64_t SQLiteBackend::last_inserted_rowid() const noexcept {
   return (uint64_t)sqlite3_last_insert_rowid(db_);
 }
 
+bool SQLiteBackend::in_transaction() const noexcept {
+  return db_ != nullptr && sqlite3_get_autocommit(db_) == 0;
+}
+
+bool SQLiteBackend::supports_returning(
+    QueryAst::Operation /*op*/) const noexcept {
+  return sqlite3_libversion_number() >= 3035000;
+}
+
 void SQLiteBackend::stmt_close() {
   if (stmt_ != nullptr) {
     bind_ = nullptr;
     sqlite3_finalize(stmt_);
     stmt_ = nullptr;
+    flush_changes();
   }
 }
 
 ExecStatus SQLiteBackend::stmt_execute() {
+  std::size_t changes_before = changes_.size();
   int rc = sqlite3_step(stmt_);
   ExecStatus status = ExecStatus::Ok;
   switch (rc) {
@@ -303,8 +508,13 @@ ExecStatus SQLiteBackend::stmt_execute() {
   }
 
   if (status == ExecStatus::Error) {
+    // the failed statement was undone
+    if (changes_.size() > changes_before) {
+      changes_.resize(changes_before);
+    }
     throw std::runtime_error(sqlite3_errmsg(db_));
   }
+  flush_changes();
   return status;
 }
 
@@ -355,6 +565,11 @@ ExecStatus SQLiteBackend::stmt_fetch() {
     case column::Type::Decimal:
       fetch_decimal_column(stmt_, index, *bind);
       break;
+#ifdef SQLINQ_HAS_INT128
+    case column::Type::Decimal128:
+      fetch_wide_decimal_column(stmt_, index, *bind);
+      break;
+#endif
     default:
       break;
     }
@@ -384,9 +599,91 @@ void SQLiteBackend::stmt_fetch_column(const int index, BindData &bind) {
   truncated_ = fetch_container_column(stmt_, index, bind);
 }
 
+std::span<const std::byte> SQLiteBackend::stmt_column_view(const int index) {
+  const void *data = bind_[index].type == column::Type::Text
+                         ? (const void *)sqlite3_column_text(stmt_, index)
+                         : sqlite3_column_blob(stmt_, index);
+  auto size = (std::size_t)sqlite3_column_bytes(stmt_, index);
+  return {static_cast<const std::byte *>(data), size};
+}
+
 void SQLiteBackend::stmt_prepare(std::string_view sql) {
   if (sqlite3_prepare_v2(db_, sql.data(), (int)sql.size(), &stmt_, 0)) {
     throw std::runtime_error(sqlite3_errmsg(db_));
   }
 }
+
+std::size_t SQLiteBackend::add_change_hook(ChangeHook fn) {
+  change_hooks_.emplace_back(next_hook_id_, std::move(fn));
+  install_hooks();
+  return next_hook_id_++;
+}
+
+void SQLiteBackend::remove_change_hook(std::size_t id) {
+  std::erase_if(change_hooks_, [id](const auto &h) { return h.first == id; });
+  install_hooks();
+}
+
+void SQLiteBackend::install_hooks() noexcept {
+  if (db_ == nullptr) {
+    return;
+  }
+  if (change_hooks_.empty()) {
+    sqlite3_update_hook(db_, nullptr, nullptr);
+    sqlite3_commit_hook(db_, nullptr, nullptr);
+    sqlite3_rollback_hook(db_, nullptr, nullptr);
+    changes_.clear();
+    committed_.clear();
+    return;
+  }
+  sqlite3_update_hook(
+      db_,
+      [](void *self, int op, const char * /*db*/, const char *table,
+         sqlite3_int64 rowid) {
+        RowChange::Op kind = op == SQLITE_INSERT   ? RowChange::Op::Insert
+                             : op == SQLITE_UPDATE ? RowChange::Op::Update
+                                                   : RowChange::Op::Delete;
+        static_cast<SQLiteBackend *>(self)->changes_.push_back(
+            RowChange{kind, table, rowid});
+      },
+      this);
+  // the commit may still fail afterwards, flush_changes() waits until the
+  // connection is back in autocommit mode
+  sqlite3_commit_hook(
+      db_,
+      [](void *self) {
+        auto *backend = static_cast<SQLiteBackend *>(self);
+        backend->committed_.insert(backend->committed_.end(),
+                                   backend->changes_.begin(),
+                                   backend->changes_.end());
+        backend->changes_.clear();
+        return 0;
+      },
+      this);
+  sqlite3_rollback_hook(
+      db_,
+      [](void *self) {
+        auto *backend = static_cast<SQLiteBackend *>(self);
+        backend->changes_.clear();
+        backend->committed_.clear(); // the commit failed
+      },
+      this);
+}
+
+// Hands the changes over once no transaction is open any more. Runs from
+// stmt_close(), i.e. from cursor destructors, so hook errors are dropped.
+void SQLiteBackend::flush_changes() noexcept {
+  if (committed_.empty() || db_ == nullptr ||
+      sqlite3_get_autocommit(db_) == 0) {
+    return;
+  }
+  std::vector<RowChange> committed = std::move(committed_);
+  committed_.clear();
+  for (auto &[id, fn] : change_hooks_) {
+    try {
+      fn(committed);
+    } catch (...) {
+    }
+  }
+}
 } // namespace sqlinq
@@ -0,0 +1,136 @@
+#include "include/sqlinq/sqlite_change_feed.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace sqlinq {
+SQLiteChangeFeed::SQLiteChangeFeed(SQLiteBackend &backend) {
+  std::size_t id = backend.add_change_hook(
+      [this](std::span<const RowChange> changes) { publish(changes); });
+  detach_ = [&backend, id] { backend.remove_change_hook(id); };
+}
+
+SQLiteChangeFeed::SQLiteChangeFeed(SQLiteDatabase &db) {
+  std::size_t id = db.add_change_hook(
+      [this](std::span<const RowChange> changes) { publish(changes); });
+  detach_ = [&db, id] { db.remove_change_hook(id); };
+}
+
+SQLiteChangeFeed::~SQLiteChangeFeed() {
+  detach_();
+  std::lock_guard lock{mtx_};
+  for (auto &s : subscribers_) {
+    s->close();
+  }
+}
+
+SQLiteChangeFeed::Subscription
+SQLiteChangeFeed::subscribe(std::vector<std::string> tables, Handler fn,
+                            Options opts) {
+  auto s = std::make_shared<Subscriber>();
+  s->tables = std::move(tables);
+  s->fn = std::move(fn);
+  s->opts = opts;
+  s->opts.capacity = std::max<std::size_t>(opts.capacity, 1);
+  s->worker = std::thread{[s] { s->run(); }};
+  std::lock_guard lock{mtx_};
+  subscribers_.push_back(s);
+  return Subscription{std::move(s)};
+}
+
+// Runs on the committing thread
+void SQLiteChangeFeed::publish(std::span<const RowChange> changes) {
+  std::vector<std::shared_ptr<Subscriber>> subscribers;
+  {
+    std::lock_guard lock{mtx_};
+    std::erase_if(subscribers_, [](const auto &s) {
+      std::lock_guard slock{s->mtx};
+      return s->closed;
+    });
+    subscribers = subscribers_;
+  }
+  for (auto &s : subscribers) {
+    s->push(changes);
+  }
+}
+
+void SQLiteChangeFeed::Subscriber::push(std::span<const RowChange> changes) {
+  ChangeBatch batch;
+  for (const RowChange &change : changes) {
+    if (tables.empty() ||
+        std::find(tables.begin(), tables.end(), change.table) != tables.end()) {
+      batch.changes.push_back(change);
+    }
+  }
+  if (batch.changes.empty()) {
+    return;
+  }
+  {
+    std::unique_lock lock{mtx};
+    if (queue.size() >= opts.capacity) {
+      if (opts.overflow == Overflow::Block) {
+        space_cv.wait(lock,
+                      [this] { return closed || queue.size() < opts.capacity; });
+      } else {
+        queue.clear();
+        overrun = true;
+      }
+    }
+    if (closed) {
+      return;
+    }
+    batch.overrun = std::exchange(overrun, false);
+    queue.push_back(std::move(batch));
+  }
+  ready_cv.notify_one();
+}
+
+void SQLiteChangeFeed::Subscriber::close() {
+  {
+    std::lock_guard lock{mtx};
+    closed = true;
+  }
+  ready_cv.notify_one();
+  space_cv.notify_all();
+}
+
+void SQLiteChangeFeed::Subscriber::run() {
+  for (;;) {
+    ChangeBatch batch;
+    {
+      std::unique_lock lock{mtx};
+      ready_cv.wait(lock, [this] { return closed || !queue.empty(); });
+      if (queue.empty()) {
+        return;
+      }
+      batch = std::move(queue.front());
+      queue.pop_front();
+    }
+    space_cv.notify_one();
+    try {
+      fn(batch);
+    } catch (...) {
+    }
+  }
+}
+
+void SQLiteChangeFeed::Subscription::cancel() {
+  if (!subscriber_) {
+    return;
+  }
+  subscriber_->close();
+  if (subscriber_->worker.get_id() == std::this_thread::get_id()) {
+    subscriber_->worker.detach(); // cancelled from its own handler
+  } else {
+    subscriber_->worker.join();
+  }
+  subscriber_.reset();
+}
+
+std::size_t SQLiteChangeFeed::Subscription::pending() const {
+  if (!subscriber_) {
+    return 0;
+  }
+  std::lock_guard lock{subscriber_->mtx};
+  return subscriber_->queue.size();
+}
+} // namespace sqlinq
@@ -0,0 +1,110 @@
+#include "include/sqlinq/sqlite_database.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace sqlinq {
+std::size_t reader_pool_size(std::size_t readers) {
+  if (readers != 0) {
+    return readers;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+SQLiteDatabase::SQLiteDatabase(const DatabaseConfig &cfg, std::size_t readers)
+    : readers_(reader_config(connect_writer(writer_, cfg)),
+               reader_pool_size(readers)),
+      next_ticket_(0), serving_ticket_(0) {}
+
+void SQLiteDatabase::attach_cache(QueryCache &cache) {
+  WriteTicket ticket{*this};
+  if (cache_ == nullptr) {
+    writer_.add_change_hook([this](std::span<const RowChange> changes) {
+      std::string_view last;
+      for (const RowChange &change : changes) {
+        if (change.table != last) {
+          cache_->invalidate(change.table);
+          last = change.table;
+        }
+      }
+    });
+  }
+  cache_ = &cache;
+}
+
+std::size_t SQLiteDatabase::add_change_hook(SQLiteBackend::ChangeHook fn) {
+  WriteTicket ticket{*this};
+  return writer_.add_change_hook(std::move(fn));
+}
+
+void SQLiteDatabase::remove_change_hook(std::size_t id) {
+  WriteTicket ticket{*this};
+  writer_.remove_change_hook(id);
+}
+
+const DatabaseConfig &SQLiteDatabase::connect_writer(SQLiteBackend &writer,
+                                                     const DatabaseConfig &cfg) {
+  if (cfg.database.empty() || cfg.database == ":memory:") {
+    throw std::invalid_argument(
+        "SQLiteDatabase requires a file database shared by all connections");
+  }
+  DatabaseConfig wcfg = cfg;
+  apply_sqlite_preset(wcfg.sqlite);
+  bool wal = !wcfg.sqlite.journal_mode.has_value();
+  if (wal) {
+    wcfg.sqlite.journal_mode = "WAL";
+  }
+  writer.connect(wcfg);
+  if (!wal) {
+    return cfg; // the caller chose the journal mode
+  }
+
+  // SQLite keeps the old mode when it cannot switch, e.g. on some VFS
+  std::string mode;
+  writer.stmt_init();
+  writer.stmt_prepare("PRAGMA journal_mode");
+  writer.stmt_execute();
+  {
+    Cursor<std::tuple<std::string>> cursor{writer};
+    if (cursor.next()) {
+      mode = std::get<0>(cursor.current());
+    }
+  }
+  if (mode != "wal") {
+    writer.disconnect();
+    throw std::runtime_error("Failed to enable WAL mode, journal mode is " +
+                             mode);
+  }
+  return cfg;
+}
+
+DatabaseConfig SQLiteDatabase::reader_config(const DatabaseConfig &cfg) {
+  DatabaseConfig rcfg = cfg;
+  apply_sqlite_preset(rcfg.sqlite);
+  rcfg.sqlite.preset.clear();
+  // journal mode and page size are persistent, the writer already set them
+  rcfg.sqlite.journal_mode.reset();
+  rcfg.sqlite.page_size.reset();
+  if (!rcfg.sqlite.open_flags.empty()) {
+    rcfg.sqlite.open_flags += ',';
+  }
+  rcfg.sqlite.open_flags += "readonly";
+  return rcfg;
+}
+
+void SQLiteDatabase::acquire_write() {
+  std::unique_lock lock{write_mtx_};
+  uint64_t ticket = next_ticket_++;
+  write_cv_.wait(lock, [&] { return serving_ticket_ == ticket; });
+}
+
+void SQLiteDatabase::release_write() noexcept {
+  {
+    std::lock_guard lock{write_mtx_};
+    serving_ticket_++;
+  }
+  write_cv_.notify_all();
+}
+} // namespace sqlinq
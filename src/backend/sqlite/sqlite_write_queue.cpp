@@ -0,0 +1,131 @@
+#include "include/sqlinq/sqlite_write_queue.hpp"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+namespace sqlinq {
+SQLiteWriteQueue::SQLiteWriteQueue(SQLiteDatabase &db, std::size_t max_batch)
+    : db_(db), max_batch_(std::max<std::size_t>(max_batch, 1)), stop_(false),
+      worker_([this] { run(); }) {}
+
+SQLiteWriteQueue::~SQLiteWriteQueue() {
+  {
+    std::lock_guard lock{mtx_};
+    stop_ = true;
+  }
+  cv_.notify_one();
+  worker_.join();
+}
+
+std::size_t SQLiteWriteQueue::pending() const {
+  std::lock_guard lock{mtx_};
+  return queue_.size();
+}
+
+void SQLiteWriteQueue::enqueue(Op &&op) {
+  {
+    std::lock_guard lock{mtx_};
+    if (stop_) {
+      throw std::runtime_error("Write queue is shutting down");
+    }
+    queue_.emplace_back(std::move(op));
+  }
+  cv_.notify_one();
+}
+
+void SQLiteWriteQueue::run() {
+  std::vector<Op> batch;
+  batch.reserve(max_batch_);
+  for (;;) {
+    {
+      std::unique_lock lock{mtx_};
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      std::size_t n = std::min(max_batch_, queue_.size());
+      for (std::size_t i = 0; i < n; i++) {
+        batch.emplace_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    commit(batch);
+    batch.clear();
+  }
+}
+
+void SQLiteWriteQueue::commit(std::vector<Op> &batch) {
+  std::vector<uint64_t> rowids(batch.size(), 0);
+  std::vector<std::exception_ptr> errors(batch.size());
+  std::exception_ptr batch_error;
+
+  db_.with_writer([&](Database &db) {
+    Statement begin{"BEGIN IMMEDIATE", {}};
+    Statement commit{"COMMIT", {}};
+    try {
+      db.execute(begin);
+    } catch (...) {
+      batch_error = std::current_exception();
+      return;
+    }
+    std::deque<std::size_t> todo(batch.size());
+    std::iota(todo.begin(), todo.end(), std::size_t{0});
+    std::vector<std::size_t> done; // executed in the open transaction
+    while (!todo.empty()) {
+      std::size_t i = todo.front();
+      todo.pop_front();
+      try {
+        db.execute(batch[i].stmt);
+        if (std::holds_alternative<std::promise<uint64_t>>(batch[i].result)) {
+          rowids[i] = db.last_inserted_rowid();
+        }
+        done.push_back(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+        if (db_.writer_.in_transaction()) {
+          continue;
+        }
+        // SQLite rolled the whole transaction back (SQLITE_FULL, IOERR,
+        // RAISE(ROLLBACK), ...); redo the earlier statements in a new one
+        todo.insert(todo.begin(), done.begin(), done.end());
+        done.clear();
+        try {
+          db.execute(begin);
+        } catch (...) {
+          batch_error = std::current_exception();
+          return;
+        }
+      }
+    }
+    try {
+      db.execute(commit);
+    } catch (...) {
+      batch_error = std::current_exception();
+      try {
+        Statement rollback{"ROLLBACK", {}};
+        db.execute(rollback);
+      } catch (...) {
+      }
+    }
+  });
+
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    std::exception_ptr error = batch_error ? batch_error : errors[i];
+    std::visit(
+        [&](auto &promise) {
+          if (error) {
+            promise.set_exception(error);
+          } else if constexpr (std::is_same_v<std::decay_t<decltype(promise)>,
+                                              std::promise<void>>) {
+            promise.set_value();
+          } else {
+            promise.set_value(rowids[i]);
+          }
+        },
+        batch[i].result);
+  }
+}
+} // namespace sqlinq
@@ -1,89 +1,248 @@
 #include "sqlinq/types/datetime.hpp"
+#include <bit>
 #include <charconv>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
-#include <ctime>
-#include <iomanip>
-
-#ifdef _WIN32
-#define timegm _mkgmtime
-#endif
 
 namespace sqlinq {
 
 using namespace std;
 
-std::string to_string(const Date &d) {
-  std::ostringstream oss;
-  oss << std::setw(4) << int(d.year()) << '-' << std::setw(2)
-      << std::setfill('0') << unsigned(d.month()) << '-' << std::setw(2)
-      << std::setfill('0') << unsigned(d.day());
-  return oss.str();
-};
-
-std::string to_string(const Time &t) {
-  std::ostringstream oss;
-  oss << std::setw(2) << std::setfill('0') << t.hours().count() << ':'
-      << std::setw(2) << std::setfill('0') << t.minutes().count() << ':'
-      << std::setw(2) << std::setfill('0') << t.seconds().count();
-  return oss.str();
-};
-
-std::string to_string(const Datetime &dt) {
-  std::time_t tt = std::chrono::system_clock::to_time_t(dt);
-#ifdef _WIN32
-  std::tm tm;
-  gmtime_s(&tm, &tt);
-#else
-  std::tm tm = *std::gmtime(&tt);
-#endif
-  char buf[20];
-  std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
-  return std::string{buf};
+namespace details {
+namespace {
+
+constexpr char digit_pairs[] = "0001020304050607080910111213141516171819"
+                               "2021222324252627282930313233343536373839"
+                               "4041424344454647484950515253545556575859"
+                               "6061626364656667686970717273747576777879"
+                               "8081828384858687888990919293949596979899";
+
+inline char *write2(char *p, unsigned v) noexcept {
+  std::memcpy(p, digit_pairs + 2 * v, 2);
+  return p + 2;
 }
 
-std::string to_string(const Timestamp &ts) {
-  return std::to_string(ts.count());
+inline char *write4(char *p, unsigned v) noexcept {
+  write2(p, v / 100);
+  return write2(p + 2, v % 100);
 }
 
-bool from_string(std::string_view str, Date &date) {
-  int y;
-  unsigned int m, d;
-#ifdef _WIN32
-  if (sscanf_s(str.data(), "%d-%u-%u", &y, &m, &d) != 3) {
-#else
-  if (std::sscanf(str.data(), "%d-%u-%u", &y, &m, &d) != 3) {
-#endif
-    return false;
+inline bool read2(const char *p, unsigned &v) noexcept {
+  unsigned hi = static_cast<unsigned char>(p[0] - '0');
+  unsigned lo = static_cast<unsigned char>(p[1] - '0');
+  v = hi * 10 + lo;
+  return hi < 10 && lo < 10;
+}
+
+/*
+ * Reads "dd?dd?dd", ? being sep, into three two digit numbers. Little endian
+ * targets validate and convert all eight bytes at once in a 64-bit word.
+ */
+inline bool read_triplet(const char *p, char sep, unsigned (&v)[3]) noexcept {
+  if constexpr (std::endian::native == std::endian::little) {
+    const uint64_t s = static_cast<unsigned char>(sep);
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    w -= 0x3030003030003030ULL | s << 16 | s << 40;
+    // Digits are 0-9 now and separators 0; a borrow sets a high bit
+    if ((((w + 0x7676767676767676ULL) | w) & 0x8080808080808080ULL) != 0 ||
+        (w & 0x0000ff0000ff0000ULL) != 0) {
+      return false;
+    }
+    w = w * 10 + (w >> 8);
+    v[0] = static_cast<unsigned>(w & 0xff);
+    v[1] = static_cast<unsigned>((w >> 24) & 0xff);
+    v[2] = static_cast<unsigned>((w >> 48) & 0xff);
+    return true;
+  } else {
+    return read2(p, v[0]) && p[2] == sep && read2(p + 3, v[1]) &&
+           p[5] == sep && read2(p + 6, v[2]);
   }
-  date = Date{chrono::year{y}, chrono::month{m}, chrono::day{d}};
-  return date.ok();
 }
 
-bool from_string(std::string_view str, Time &t) {
-  int h, m, s;
-#ifdef _WIN32
-  if (sscanf_s(str.data(), "%d:%d:%d", &h, &m, &s) != 3) {
-#else
-  if (std::sscanf(str.data(), "%d:%d:%d", &h, &m, &s) != 3) {
-#endif
-    return false;
+constexpr std::to_chars_result too_large(char *last) noexcept {
+  return {last, std::errc::value_too_large};
+}
+} // namespace
+
+std::to_chars_result to_chars(char *first, char *last, const Date &d) noexcept {
+  int y = int(d.year());
+  unsigned m = unsigned(d.month());
+  unsigned dd = unsigned(d.day());
+  if (m > 99 || dd > 99) {
+    return {first, std::errc::invalid_argument};
   }
-  t = Time{chrono::hours{h} + chrono::minutes{m} + chrono::seconds{s}};
-  return true;
+
+  char *p = first;
+  if (y >= 0 && y <= 9999) {
+    if (last - p < 4) {
+      return too_large(last);
+    }
+    p = write4(p, unsigned(y));
+  } else {
+    auto res = std::to_chars(p, last, y);
+    if (res.ec != std::errc{}) {
+      return res;
+    }
+    p = res.ptr;
+  }
+  if (last - p < 6) {
+    return too_large(last);
+  }
+  *p++ = '-';
+  p = write2(p, m);
+  *p++ = '-';
+  return {write2(p, dd), std::errc{}};
 }
 
-bool from_string(std::string_view str, Datetime &dt) {
-  std::tm tm{};
-  if (str.size() != 19 || !strchr(str.data(), ' '))
-    return false;
-  std::istringstream iss{std::string{str}};
-  iss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-  if (iss.fail())
-    return false;
-  dt = std::chrono::system_clock::from_time_t(timegm(&tm));
-  return true;
+std::to_chars_result to_chars(char *first, char *last, const Time &t) noexcept {
+  auto h = t.hours().count();
+  char *p = first;
+  if (t.is_negative()) {
+    if (p == last) {
+      return too_large(last);
+    }
+    *p++ = '-';
+  }
+  if (h < 100) {
+    if (last - p < 2) {
+      return too_large(last);
+    }
+    p = write2(p, unsigned(h));
+  } else {
+    auto res = std::to_chars(p, last, h);
+    if (res.ec != std::errc{}) {
+      return res;
+    }
+    p = res.ptr;
+  }
+  if (last - p < 6) {
+    return too_large(last);
+  }
+  *p++ = ':';
+  p = write2(p, unsigned(t.minutes().count()));
+  *p++ = ':';
+  return {write2(p, unsigned(t.seconds().count())), std::errc{}};
+}
+
+std::to_chars_result to_chars(char *first, char *last,
+                              const Datetime &dt) noexcept {
+  auto secs = chrono::floor<chrono::seconds>(dt);
+  auto days = chrono::floor<chrono::days>(secs);
+  auto res = to_chars(first, last, Date{days});
+  if (res.ec != std::errc{}) {
+    return res;
+  }
+  if (res.ptr == last) {
+    return too_large(last);
+  }
+  *res.ptr++ = ' ';
+  return to_chars(res.ptr, last, Time{secs - days});
+}
+
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Date &date) noexcept {
+  unsigned century;
+  unsigned v[3];
+  if (last - first < ptrdiff_t(DatetimeTraits::date_length) ||
+      !read2(first, century) || !read_triplet(first + 2, '-', v)) {
+    return {first, std::errc::invalid_argument};
+  }
+  Date d{chrono::year{int(century * 100 + v[0])}, chrono::month{v[1]},
+         chrono::day{v[2]}};
+  if (!d.ok()) {
+    return {first, std::errc::invalid_argument};
+  }
+  date = d;
+  return {first + DatetimeTraits::date_length, std::errc{}};
+}
+
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Time &t) noexcept {
+  const std::from_chars_result invalid{first, std::errc::invalid_argument};
+  // MySQL TIME values may be negative, as written by to_chars()
+  const bool negative = first != last && *first == '-';
+  const char *p = negative ? first + 1 : first;
+  unsigned v[3];
+  long h;
+  if (last - p >= ptrdiff_t(DatetimeTraits::time_length) &&
+      read_triplet(p, ':', v)) {
+    h = v[0];
+    p += DatetimeTraits::time_length;
+  } else {
+    // More than two hour digits, e.g. MySQL TIME values
+    if (p == last || static_cast<unsigned char>(*p - '0') >= 10) {
+      return invalid;
+    }
+    auto [ptr, ec] = std::from_chars(p, last, h);
+    if (ec != std::errc{} || last - ptr < 6 || ptr[0] != ':' || ptr[3] != ':' ||
+        !read2(ptr + 1, v[1]) || !read2(ptr + 4, v[2])) {
+      return invalid;
+    }
+    p = ptr + 6;
+  }
+  if (v[1] > 59 || v[2] > 59) {
+    return invalid;
+  }
+  chrono::seconds secs =
+      chrono::hours{h} + chrono::minutes{v[1]} + chrono::seconds{v[2]};
+  t = Time{negative ? -secs : secs};
+  return {p, std::errc{}};
+}
+
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  Datetime &dt) noexcept {
+  const std::from_chars_result invalid{first, std::errc::invalid_argument};
+  Date d;
+  unsigned v[3];
+  if (last - first < ptrdiff_t(DatetimeTraits::datetime_length) ||
+      from_chars(first, last, d).ec != std::errc{} || first[10] != ' ' ||
+      !read_triplet(first + 11, ':', v) || v[0] > 23 || v[1] > 59 ||
+      v[2] > 59) {
+    return invalid;
+  }
+  dt = chrono::sys_days{d} + chrono::hours{v[0]} + chrono::minutes{v[1]} +
+       chrono::seconds{v[2]};
+  return {first + DatetimeTraits::datetime_length, std::errc{}};
+}
+} // namespace details
+
+namespace {
+template <typename T> std::string format(const T &v) {
+  char buf[details::DatetimeTraits::max_str_length];
+  auto [ptr, ec] = details::to_chars(buf, buf + sizeof(buf), v);
+  return ec == std::errc{} ? std::string(buf, ptr) : std::string{};
+}
+
+template <typename T> bool parse(std::string_view str, T &v) {
+  const char *last = str.data() + str.size();
+  auto [ptr, ec] = details::from_chars(str.data(), last, v);
+  return ec == std::errc{} && ptr == last;
+}
+
+template <typename T> std::ostream &write(std::ostream &os, const T &v) {
+  char buf[details::DatetimeTraits::max_str_length];
+  auto [ptr, ec] = details::to_chars(buf, buf + sizeof(buf), v);
+  return os.write(buf, ec == std::errc{} ? ptr - buf : 0);
 }
+} // namespace
+
+std::string to_string(const Date &d) { return format(d); }
+
+std::string to_string(const Time &t) { return format(t); }
+
+std::string to_string(const Datetime &dt) { return format(dt); }
+
+std::string to_string(const Timestamp &ts) {
+  return std::to_string(ts.count());
+}
+
+bool from_string(std::string_view str, Date &date) { return parse(str, date); }
+
+bool from_string(std::string_view str, Time &t) { return parse(str, t); }
+
+bool from_string(std::string_view str, Datetime &dt) { return parse(str, dt); }
 
 bool from_string(std::string_view str, Timestamp &ts) {
   long long v;
@@ -97,15 +256,15 @@ bool from_string(std::string_view str, Timestamp &ts) {
 }
 
 std::ostream &operator<<(std::ostream &os, const Date &d) {
-  return os << to_string(d);
+  return write(os, d);
 }
 
 std::ostream &operator<<(std::ostream &os, const Time &t) {
-  return os << to_string(t);
+  return write(os, t);
 }
 
 std::ostream &operator<<(std::ostream &os, const Datetime &dt) {
-  return os << to_string(dt);
+  return write(os, dt);
 }
 
 std::ostream &operator<<(std::ostream &os, const Timestamp &ts) {
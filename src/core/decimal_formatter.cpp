@@ -1,61 +1,111 @@
+#include <cstring>
 #include <sqlinq/types/decimal.hpp>
 
 namespace sqlinq::details {
+namespace {
+constexpr char digit_pairs[] = "0001020304050607080910111213141516171819"
+                               "2021222324252627282930313233343536373839"
+                               "4041424344454647484950515253545556575859"
+                               "6061626364656667686970717273747576777879"
+                               "8081828384858687888990919293949596979899";
 
-std::to_chars_result to_chars(char *first, char *last,
-                              const DecimalTraits::value_type &v,
-                              std::size_t scale) noexcept {
-  std::to_chars_result result;
-  if (first == nullptr || last == nullptr) {
-    return {nullptr, std::errc::invalid_argument};
+// Writes the digits of value backwards ending at it, returns the first one
+inline char *write_digits(char *it, uint64_t value) noexcept {
+  while (value >= 100) {
+    it -= 2;
+    std::memcpy(it, digit_pairs + 2 * (value % 100), 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    it -= 2;
+    std::memcpy(it, digit_pairs + 2 * value, 2);
+  } else {
+    *--it = static_cast<char>('0' + value);
   }
+  return it;
+}
 
-  if (v == DecimalTraits::nan_sentinel) {
-    const char nan_str[] = {'N', 'a', 'N'};
-    const char *nan_str_last = nan_str + sizeof(nan_str);
-    if (std::distance(first, last) < std::distance(nan_str, nan_str_last)) {
-      return {first, std::errc::invalid_argument};
+#ifdef SQLINQ_HAS_INT128
+/*
+ * 128-bit division is a library call, so only chunks of 19 digits are split
+ * off with it; each chunk is then written with 64-bit arithmetic.
+ */
+inline char *write_digits(char *it, uint128_t value) noexcept {
+  constexpr uint64_t chunk_div = 10000000000000000000ULL;
+  while (value > std::numeric_limits<uint64_t>::max()) {
+    char *end = it;
+    it = write_digits(it, static_cast<uint64_t>(value % chunk_div));
+    while (end - it < 19) {
+      *--it = '0';
     }
-    result.ptr = std::copy(nan_str, nan_str_last, first);
-    result.ec = {};
-    return result;
+    value /= chunk_div;
   }
+  return write_digits(it, static_cast<uint64_t>(value));
+}
+#endif
 
-  char sign = (v < 0) ? '-' : '+';
-  char buf[DecimalTraits::max_str_length];
-  DecimalTraits::value_type value = std::abs(v);
-
-  char *begin = buf;
-  char *end = buf + sizeof(buf);
+template <typename Traits>
+std::to_chars_result format(char *first, char *last,
+                            typename Traits::value_type v,
+                            std::size_t scale) noexcept {
+  using unsigned_type = typename Traits::unsigned_type;
+  if (first == nullptr || last == nullptr) {
+    return {nullptr, std::errc::invalid_argument};
+  }
+  if (scale > Traits::max_precision) {
+    return {first, std::errc::invalid_argument};
+  }
 
-  char *it = end - 1;
-  char *sign_it = it - scale;
-  *sign_it = '.';
-  for (; it != begin; --it) {
-    if (it == sign_it) {
-      continue;
-    }
-    *it = (char)(value % 10) + '0';
-    value = value / 10;
-    if (value == 0 && it < sign_it) {
-      break;
+  if (v == Traits::nan_sentinel) {
+    const char nan_str[] = {'N', 'a', 'N'};
+    if (last - first < ptrdiff_t(sizeof(nan_str))) {
+      return {first, std::errc::invalid_argument};
     }
+    std::memcpy(first, nan_str, sizeof(nan_str));
+    return {first + sizeof(nan_str), std::errc{}};
   }
 
-  if (sign == '-') {
-    --it;
-    *it = sign;
+  // Digits of the magnitude, zero padded to at least one integer digit
+  char digits[Traits::max_str_length];
+  char *end = digits + sizeof(digits);
+  unsigned_type value = v < 0 ? 0 - static_cast<unsigned_type>(v)
+                              : static_cast<unsigned_type>(v);
+  char *it = write_digits(end, value);
+  while (std::size_t(end - it) <= scale) {
+    *--it = '0';
   }
 
-  end = (scale == 0) ? end - 1 : end;
-  auto src_len = std::distance(it, end);
-  auto dst_len = std::distance(first, last);
-  if (src_len > dst_len) {
+  std::size_t int_len = std::size_t(end - it) - scale;
+  std::size_t len = (v < 0) + int_len + (scale != 0) + scale;
+  if (len > std::size_t(last - first)) {
     return {first, std::errc::invalid_argument};
   }
+  char *p = first;
+  if (v < 0) {
+    *p++ = '-';
+  }
+  std::memcpy(p, it, int_len);
+  p += int_len;
+  if (scale != 0) {
+    *p++ = '.';
+    std::memcpy(p, it + int_len, scale);
+    p += scale;
+  }
+  return {p, std::errc{}};
+}
+} // namespace
 
-  result.ptr = std::copy(it, end, first);
-  result.ec = std::errc{};
-  return result;
+std::to_chars_result to_chars(char *first, char *last,
+                              const DecimalTraits::value_type &v,
+                              std::size_t scale) noexcept {
+  return format<DecimalTraits>(first, last, v, scale);
+}
+
+#ifdef SQLINQ_HAS_INT128
+std::to_chars_result to_chars(char *first, char *last,
+                              const WideDecimalTraits::value_type &v,
+                              std::size_t scale) noexcept {
+  return format<WideDecimalTraits>(first, last, v, scale);
 }
+#endif
 } // namespace sqlinq::details
@@ -1,66 +1,133 @@
-#include <cctype>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <sqlinq/types/decimal.hpp>
 
 namespace sqlinq::details {
-enum class State { Sign, Integer, Fractional };
+namespace {
+inline bool is_digit(char c) noexcept {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
 
-std::from_chars_result from_chars(const char *first, const char *last,
-                                  DecimalTraits::value_type &v,
-                                  std::size_t scale) noexcept {
-  State state = State::Sign;
-  bool has_integer_digit = false;
+/*
+ * Eight ASCII digits -> their value, false if any byte is not a digit. On
+ * little endian targets the bytes are validated and combined as one 64-bit
+ * word: pairs, then quads, then the two halves.
+ */
+inline bool parse_eight(const char *p, uint64_t &v) noexcept {
+  if constexpr (std::endian::native == std::endian::little) {
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    w -= 0x3030303030303030ULL;
+    if ((((w + 0x7676767676767676ULL) | w) & 0x8080808080808080ULL) != 0) {
+      return false;
+    }
+    w = w * 10 + (w >> 8);
+    w = (((w & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+         (((w >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >>
+        32;
+    v = w;
+    return true;
+  } else {
+    uint64_t r = 0;
+    for (int i = 0; i < 8; i++) {
+      if (!is_digit(p[i])) {
+        return false;
+      }
+      r = r * 10 + static_cast<uint64_t>(p[i] - '0');
+    }
+    v = r;
+    return true;
+  }
+}
 
+// Appends up to max digits at p to value, eight at a time while possible
+template <typename UInt>
+inline const char *parse_digits(const char *p, const char *last, UInt &value,
+                                std::size_t max, std::size_t &count) noexcept {
+  uint64_t chunk;
+  count = 0;
+  while (max - count >= 8 && last - p >= 8 && parse_eight(p, chunk)) {
+    value = value * 100000000 + chunk;
+    p += 8;
+    count += 8;
+  }
+  while (count < max && p != last && is_digit(*p)) {
+    value = value * 10 + static_cast<UInt>(*p - '0');
+    p++;
+    count++;
+  }
+  return p;
+}
+
+template <typename Traits>
+std::from_chars_result parse(const char *first, const char *last,
+                             typename Traits::value_type &v,
+                             std::size_t scale) noexcept {
+  using value_type = typename Traits::value_type;
+  using unsigned_type = typename Traits::unsigned_type;
   if (first == nullptr || last == nullptr) {
     return {nullptr, std::errc::invalid_argument};
   }
+  if (scale > Traits::max_precision) {
+    return {first, std::errc::invalid_argument};
+  }
 
-  char sign{};
-  DecimalTraits::value_type value = 0;
-  while (first != last && *first != '\0') {
-    char c = *first;
-    switch (state) {
-    case State::Sign:
-      state = State::Integer;
-      if (c == '-' || c == '+') {
-        sign = c;
-        first++;
-        continue;
-      }
-    [[fallthrough]];
-    case State::Integer:
-      if (isdigit(c)) {
-        has_integer_digit = true;
-        value = value * 10 + (c - '0');
-      } else if (c == '.') {
-        if (!has_integer_digit) {
-          return {first, std::errc::invalid_argument};
-        }
-        state = State::Fractional;
-      } else {
-        return {first, std::errc::invalid_argument};
-      }
-      break;
-    case State::Fractional:
-      if (isdigit(c)) {
-        if (scale == 0) {
-          return {first, std::errc::result_out_of_range};
-        }
-        value = value * 10 + (c - '0');
-        scale--;
-      } else {
-        return {first, std::errc::invalid_argument};
-      }
-      break;
+  const char *p = first;
+  bool negative = false;
+  if (p != last && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  // Leading zeros do not count against the precision
+  const char *digits = p;
+  while (p != last && *p == '0') {
+    p++;
+  }
+  bool has_integer_digit = p != digits;
+
+  unsigned_type value = 0;
+  std::size_t count;
+  p = parse_digits(p, last, value, Traits::max_precision - scale, count);
+  has_integer_digit = has_integer_digit || count != 0;
+  if (p != last && is_digit(*p)) {
+    return {p, std::errc::result_out_of_range};
+  }
+
+  if (p != last && *p == '.') {
+    if (!has_integer_digit) {
+      return {p, std::errc::invalid_argument};
+    }
+    p = parse_digits(p + 1, last, value, scale, count);
+    scale -= count;
+    if (p != last && is_digit(*p)) {
+      return {p, std::errc::result_out_of_range};
     }
-    first++;
   }
 
-  if (!has_integer_digit) {
-    return {first, std::errc::invalid_argument};
+  if (!has_integer_digit || (p != last && *p != '\0')) {
+    return {p, std::errc::invalid_argument};
   }
 
-  value = value * DecimalTraits::power_of_10(scale);
-  v = value * ((sign == '-') ? -1 : 1);
-  return {first, std::errc{}};
+  value *= static_cast<unsigned_type>(Traits::power_of_10(scale));
+  v = negative ? -static_cast<value_type>(value)
+               : static_cast<value_type>(value);
+  return {p, std::errc{}};
+}
+} // namespace
+
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  DecimalTraits::value_type &v,
+                                  std::size_t scale) noexcept {
+  return parse<DecimalTraits>(first, last, v, scale);
+}
+
+#ifdef SQLINQ_HAS_INT128
+std::from_chars_result from_chars(const char *first, const char *last,
+                                  WideDecimalTraits::value_type &v,
+                                  std::size_t scale) noexcept {
+  return parse<WideDecimalTraits>(first, last, v, scale);
 }
-} // namespace sqlinq::detail
+#endif
+} // namespace sqlinq::details
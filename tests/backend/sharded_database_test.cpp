@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <sqlinq/column.hpp>
+#include <sqlinq/sharded_database.hpp>
+#include <sqlinq/sqlite_backend.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace sqlinq;
+
+struct Order {
+  int id;
+  std::string customer;
+  int total;
+};
+
+template <> struct sqlinq::Table<Order> {
+  SQLINQ_COLUMN(0, Order, id)
+  SQLINQ_COLUMN(1, Order, customer)
+  SQLINQ_COLUMN(2, Order, total)
+
+  static consteval auto meta() {
+    return make_table<Order>(
+        "orders",
+        SQLINQ_COLUMN_META(Order, id, "order_id").primary_key().autoincrement(),
+        SQLINQ_COLUMN_META(Order, customer, "customer"),
+        SQLINQ_COLUMN_META(Order, total, "total"));
+  }
+};
+
+class ShardedDatabaseTest : public ::testing::Test {
+protected:
+  std::vector<DatabaseConfig> configs_;
+
+  void SetUp() override {
+    DatabaseConfig cfg;
+    cfg.database = ":memory:";
+    configs_.assign(3, cfg);
+  }
+
+  static void create_tables(ShardedDatabase<SQLiteBackend> &db) {
+    for (std::size_t i = 0; i < db.size(); i++) {
+      SQLiteBackend &shard = db.shard(i);
+      shard.stmt_init();
+      shard.stmt_prepare("CREATE TABLE orders ("
+                         "order_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                         "customer TEXT NOT NULL,"
+                         "total INTEGER NOT NULL)");
+      ASSERT_EQ(shard.stmt_execute(), ExecStatus::Ok);
+      shard.stmt_close();
+    }
+  }
+
+  // order i has total (i * 7) % 30, customer "c<i % 4>"
+  static void fill(ShardedDatabase<SQLiteBackend> &db, int count) {
+    for (int i = 1; i <= count; i++) {
+      Order order{i, "c" + std::to_string(i % 4), (i * 7) % 30};
+      db.create(order);
+    }
+  }
+};
+
+TEST_F(ShardedDatabaseTest, RoutesRowsByPrimaryKey) {
+  ShardedDatabase<SQLiteBackend> db{configs_};
+  create_tables(db);
+  fill(db, 30);
+
+  std::set<std::size_t> used;
+  for (int id = 1; id <= 30; id++) {
+    std::size_t owner = db.shard_of(id);
+    used.insert(owner);
+    for (std::size_t i = 0; i < db.size(); i++) {
+      EXPECT_EQ(Database{db.shard(i)}.find<Order>(id).has_value(), i == owner);
+    }
+  }
+  EXPECT_EQ(used.size(), 3);
+
+  auto order = db.find<Order>(12);
+  ASSERT_TRUE(order.has_value());
+  order->total = 99;
+  db.update(*order);
+  EXPECT_EQ(db.find<Order>(12)->total, 99);
+  db.remove<Order>(12);
+  EXPECT_FALSE(db.find<Order>(12).has_value());
+
+  Order unkeyed{0, "c0", 1};
+  EXPECT_THROW(db.create(unkeyed), std::invalid_argument);
+}
+
+// Text keys hash with FNV-1a, so the placement is the same everywhere
+TEST_F(ShardedDatabaseTest, TextKeysHaveStablePlacement) {
+  ShardedDatabase<SQLiteBackend> db{configs_};
+  EXPECT_EQ(db.shard_of(std::string{"alice"}), 2);
+  EXPECT_EQ(db.shard_of(std::string{"bob"}), 1);
+  EXPECT_EQ(db.shard_of(std::string{"carol"}), 0);
+  EXPECT_EQ(db.shard_of(std::string{""}), 0);
+}
+
+TEST_F(ShardedDatabaseTest, MergesOrderedResultsWithLimit) {
+  ShardedDatabase<SQLiteBackend> db{configs_};
+  create_tables(db);
+  fill(db, 30);
+
+  auto q = Query<Order>().select_all().order_by(&Order::total).skip(3).fetch(5);
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(rows.size(), 5);
+  for (std::size_t i = 0; i < rows.size(); i++) {
+    EXPECT_EQ(rows[i].total, static_cast<int>(i) + 3);
+  }
+
+  auto all = Query<Order>().select_all().where(
+      [](auto o) { return o.customer == "c1"; });
+  EXPECT_EQ(db.to_vector(all).size(), 8);
+
+  auto by_key = Query<Order>().select_all().where(
+      [](auto o) { return o.id == 7; });
+  auto routed = db.to_vector(by_key);
+  ASSERT_EQ(routed.size(), 1);
+  EXPECT_EQ(routed[0].total, 19);
+}
+
+TEST_F(ShardedDatabaseTest, CombinesAggregates) {
+  ShardedDatabase<SQLiteBackend> db{configs_};
+  create_tables(db);
+  fill(db, 30);
+
+  auto count_q = Query<Order>().select(count());
+  EXPECT_EQ(std::get<0>(db.to_vector(count_q).at(0)), 30);
+
+  auto sum_q = Query<Order>().select(sum(&Order::total));
+  EXPECT_EQ(std::get<0>(db.to_vector(sum_q).at(0)), 435);
+
+  // only one row matches, the other shards report NULL
+  auto min_q = Query<Order>().select(min(&Order::total)).where([](auto o) {
+    return o.total > 28;
+  });
+  EXPECT_EQ(std::get<0>(db.to_vector(min_q).at(0)), 29);
+
+  auto max_q = Query<Order>().select(max(&Order::total));
+  EXPECT_EQ(std::get<0>(db.to_vector(max_q).at(0)), 29);
+
+  auto avg_q = Query<Order>().select(avg(&Order::total));
+  EXPECT_THROW((void)db.to_vector(avg_q), std::invalid_argument);
+}
+
+TEST_F(ShardedDatabaseTest, RangeSharding) {
+  EXPECT_THROW((ShardedDatabase<SQLiteBackend>{configs_, {10}}),
+               std::invalid_argument);
+
+  ShardedDatabase<SQLiteBackend> db{configs_, {10, 20}};
+  create_tables(db);
+  fill(db, 30);
+  EXPECT_EQ(db.shard_of(9), 0);
+  EXPECT_EQ(db.shard_of(10), 1);
+  EXPECT_EQ(db.shard_of(25), 2);
+
+  auto q = Query<Order>().select(count());
+  std::vector<std::tuple<int>> counts;
+  for (std::size_t i = 0; i < db.size(); i++) {
+    counts.push_back(Database{db.shard(i)}.to_vector(q).at(0));
+    q = Query<Order>().select(count());
+  }
+  EXPECT_EQ(counts, (std::vector<std::tuple<int>>{{9}, {10}, {11}}));
+}
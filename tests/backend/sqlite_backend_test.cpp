@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 #include <sqlinq/config.hpp>
+#include <sqlinq/cursor.hpp>
 #include <sqlinq/sqlite_backend.hpp>
 
 #include <cstring>
+#include <filesystem>
 
 #include "test_model.hpp"
 
@@ -106,6 +108,27 @@ TEST_F(SQLiteBackendTest, SelectRows) {
   EXPECT_TRUE(TestModel::AreEqual(db_rows[1], records[1]));
 }
 
+TEST_F(SQLiteBackendTest, SelectRowsAsViews) {
+  backend_.stmt_init();
+  backend_.stmt_prepare("SELECT id, blob_v, text_v FROM test ORDER BY id");
+  ASSERT_EQ(backend_.stmt_execute(), ExecStatus::Ok);
+
+  std::vector<std::tuple<int, Blob, std::optional<std::string>>> records;
+  {
+    Cursor<std::tuple<int, BlobView, std::optional<TextView>>> cursor{backend_};
+    for (auto &[id, blob, text] : cursor) {
+      records.emplace_back(id, blob.to_blob(),
+                           text ? std::optional{text->str()} : std::nullopt);
+    }
+  }
+
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(std::get<1>(records[0]), db_rows[0].blob_v);
+  EXPECT_FALSE(std::get<2>(records[0]).has_value());
+  EXPECT_EQ(std::get<1>(records[1]), db_rows[1].blob_v);
+  EXPECT_EQ(std::get<2>(records[1]), db_rows[1].text_v);
+}
+
 TEST_F(SQLiteBackendTest, SelectRowsWithBindedParams) {
   using Result = std::tuple<int8_t, Timestamp>;
   bool is_null[2];
@@ -298,3 +321,51 @@ TEST_F(SQLiteBackendTest, InsertRows) {
   EXPECT_TRUE(TestModel::AreEqual(rows[0], records[2]));
   EXPECT_TRUE(TestModel::AreEqual(rows[1], records[3]));
 }
+
+TEST(SQLiteBackendOptionsTest, ApplyPresetOnConnect) {
+  auto path = std::filesystem::temp_directory_path() / "sqlinq_preset.sqlite3";
+  std::filesystem::remove(path);
+
+  DatabaseConfig cfg;
+  cfg.database = path.string();
+  cfg.sqlite.preset = "throughput";
+  cfg.sqlite.open_flags = "nomutex";
+
+  SQLiteBackend backend;
+  backend.connect(cfg);
+  ASSERT_TRUE(backend.is_connected());
+
+  std::string mode(8, '\0');
+  std::size_t length = 0;
+  bool is_null = false;
+  BindData bind{};
+  bind.type = column::Type::Text;
+  bind.buffer = mode.data();
+  bind.buffer_length = mode.size();
+  bind.length = &length;
+  bind.is_null = &is_null;
+
+  backend.stmt_init();
+  backend.stmt_prepare("PRAGMA journal_mode");
+  ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+  backend.bind_result(&bind, 1);
+  backend.stmt_fetch();
+  backend.stmt_close();
+  mode.resize(length);
+  EXPECT_EQ(mode, "wal");
+
+  backend.disconnect();
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + "-wal");
+  std::filesystem::remove(path.string() + "-shm");
+}
+
+TEST(SQLiteBackendOptionsTest, RejectInvalidPragmaValue) {
+  DatabaseConfig cfg;
+  cfg.database = ":memory:";
+  cfg.sqlite.journal_mode = "WAL; DROP TABLE test";
+
+  SQLiteBackend backend;
+  EXPECT_THROW(backend.connect(cfg), std::invalid_argument);
+  EXPECT_FALSE(backend.is_connected());
+}
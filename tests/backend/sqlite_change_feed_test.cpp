@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <sqlinq/sqlite_change_feed.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace sqlinq;
+
+class SQLiteChangeFeedTest : public ::testing::Test {
+protected:
+  SQLiteBackend backend_;
+
+  void SetUp() override {
+    DatabaseConfig cfg;
+    cfg.database = ":memory:";
+    backend_.connect(cfg);
+    run("CREATE TABLE parts (id INTEGER PRIMARY KEY, qty INTEGER)");
+    run("CREATE TABLE logs (id INTEGER PRIMARY KEY, msg TEXT)");
+  }
+
+  void run(const char *sql) {
+    backend_.stmt_init();
+    backend_.stmt_prepare(sql);
+    backend_.stmt_execute();
+    backend_.stmt_close();
+  }
+};
+
+TEST_F(SQLiteChangeFeedTest, HookSeesOnlyCommittedRows) {
+  std::vector<RowChange> seen;
+  std::size_t id = backend_.add_change_hook(
+      [&](std::span<const RowChange> c) { seen.assign(c.begin(), c.end()); });
+
+  run("BEGIN");
+  run("INSERT INTO parts (id, qty) VALUES (1, 5), (2, 7)");
+  run("UPDATE parts SET qty = 6 WHERE id = 1");
+  EXPECT_TRUE(seen.empty());
+  run("COMMIT");
+  ASSERT_EQ(seen.size(), 3);
+  EXPECT_EQ(seen[0].op, RowChange::Op::Insert);
+  EXPECT_EQ(seen[0].table, "parts");
+  EXPECT_EQ(seen[1].rowid, 2);
+  EXPECT_EQ(seen[2].op, RowChange::Op::Update);
+
+  seen.clear();
+  run("BEGIN");
+  run("DELETE FROM parts WHERE id = 2");
+  run("ROLLBACK");
+  EXPECT_TRUE(seen.empty());
+
+  EXPECT_THROW(run("INSERT INTO parts (id, qty) VALUES (1, 0)"),
+               std::runtime_error);
+  EXPECT_TRUE(seen.empty());
+
+  run("DELETE FROM parts WHERE id = 2");
+  ASSERT_EQ(seen.size(), 1);
+  EXPECT_EQ(seen[0].op, RowChange::Op::Delete);
+
+  backend_.remove_change_hook(id);
+  seen.clear();
+  run("DELETE FROM parts WHERE id = 1");
+  EXPECT_TRUE(seen.empty());
+}
+
+TEST_F(SQLiteChangeFeedTest, ThrowingHookDoesNotEscape) {
+  std::size_t seen = 0;
+  backend_.add_change_hook(
+      [](std::span<const RowChange>) { throw std::bad_alloc{}; });
+  backend_.add_change_hook(
+      [&](std::span<const RowChange> c) { seen += c.size(); });
+
+  EXPECT_NO_THROW(run("INSERT INTO parts (id, qty) VALUES (1, 5)"));
+  EXPECT_EQ(seen, 1);
+}
+
+TEST_F(SQLiteChangeFeedTest, DeliversBatchesPerTableOnSubscriberThread) {
+  SQLiteChangeFeed feed{backend_};
+  std::mutex mtx;
+  std::vector<ChangeBatch> batches;
+  std::promise<void> done;
+  auto sub = feed.subscribe({"parts"}, [&](const ChangeBatch &b) {
+    std::lock_guard lock{mtx};
+    batches.push_back(b);
+    if (batches.size() == 2) {
+      done.set_value();
+    }
+  });
+
+  run("INSERT INTO logs (msg) VALUES ('ignored')");
+  run("BEGIN");
+  run("INSERT INTO parts (id, qty) VALUES (1, 1)");
+  run("INSERT INTO logs (msg) VALUES ('filtered')");
+  run("INSERT INTO parts (id, qty) VALUES (2, 2)");
+  run("COMMIT");
+  run("UPDATE parts SET qty = 3 WHERE id = 2");
+
+  ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds{5}),
+            std::future_status::ready);
+  std::lock_guard lock{mtx};
+  ASSERT_EQ(batches[0].changes.size(), 2);
+  EXPECT_EQ(batches[0].changes[1].rowid, 2);
+  ASSERT_EQ(batches[1].changes.size(), 1);
+  EXPECT_EQ(batches[1].changes[0].op, RowChange::Op::Update);
+  EXPECT_FALSE(batches[1].overrun);
+}
+
+TEST_F(SQLiteChangeFeedTest, ResyncDropsBatchesWhenQueueIsFull) {
+  SQLiteChangeFeed feed{backend_};
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::vector<ChangeBatch> batches;
+  auto sub = feed.subscribe(
+      {},
+      [&](const ChangeBatch &b) {
+        released.wait();
+        batches.push_back(b);
+      },
+      {.capacity = 2, .overflow = SQLiteChangeFeed::Overflow::Resync});
+
+  for (int i = 0; i < 10; i++) {
+    run("INSERT INTO logs (msg) VALUES ('x')");
+  }
+  release.set_value();
+  sub.cancel(); // drains the queue
+
+  // the first batch may have been taken before the queue filled up
+  ASSERT_FALSE(batches.empty());
+  EXPECT_LE(batches.size(), 3);
+  EXPECT_TRUE(std::any_of(batches.begin(), batches.end(),
+                          [](const ChangeBatch &b) { return b.overrun; }));
+  EXPECT_EQ(batches.back().changes[0].rowid, 10);
+}
@@ -0,0 +1,897 @@
+#include <gtest/gtest.h>
+#include <sqlinq/column.hpp>
+#include <sqlinq/hash_join.hpp>
+#include <sqlinq/query_executor.hpp>
+#include <sqlinq/sqlite_database.hpp>
+#include <sqlinq/sqlite_write_queue.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <future>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace sqlinq;
+
+struct Item {
+  int id;
+  std::string name;
+  int qty;
+};
+
+template <> struct sqlinq::Table<Item> {
+  SQLINQ_COLUMN(0, Item, id)
+  SQLINQ_COLUMN(1, Item, name)
+  SQLINQ_COLUMN(2, Item, qty)
+
+  static consteval auto meta() {
+    return make_table<Item>(
+        "items",
+        SQLINQ_COLUMN_META(Item, id, "item_id").primary_key().autoincrement(),
+        SQLINQ_COLUMN_META(Item, name, "item_name").unique(),
+        SQLINQ_COLUMN_META(Item, qty, "qty"));
+  }
+};
+
+struct Shift {
+  int id;
+  Date day;
+  Time start;
+  Datetime logged;
+};
+
+template <> struct sqlinq::Table<Shift> {
+  SQLINQ_COLUMN(0, Shift, id)
+  SQLINQ_COLUMN(1, Shift, day)
+  SQLINQ_COLUMN(2, Shift, start)
+  SQLINQ_COLUMN(3, Shift, logged)
+
+  static consteval auto meta() {
+    using column::Storage;
+    return make_table<Shift>(
+        "shifts",
+        SQLINQ_COLUMN_META(Shift, id, "shift_id").primary_key().autoincrement(),
+        SQLINQ_COLUMN_META(Shift, day, "day").storage(Storage::EpochDays),
+        SQLINQ_COLUMN_META(Shift, start, "start").storage(Storage::UnixSeconds),
+        SQLINQ_COLUMN_META(Shift, logged, "logged")
+            .storage(Storage::UnixSeconds));
+  }
+};
+
+struct Holiday {
+  Date day;
+  std::string name;
+};
+
+template <> struct sqlinq::Table<Holiday> {
+  SQLINQ_COLUMN(0, Holiday, day)
+  SQLINQ_COLUMN(1, Holiday, name)
+
+  static consteval auto meta() {
+    return make_table<Holiday>(
+        "holidays",
+        SQLINQ_COLUMN_META(Holiday, day, "day")
+            .primary_key()
+            .storage(column::Storage::EpochDays),
+        SQLINQ_COLUMN_META(Holiday, name, "name"));
+  }
+};
+
+struct Post {
+  int id;
+  std::string title;
+};
+
+template <> struct sqlinq::Table<Post> {
+  SQLINQ_COLUMN(0, Post, id)
+  SQLINQ_COLUMN(1, Post, title)
+
+  static consteval auto meta() {
+    return make_table<Post>(
+        "posts",
+        SQLINQ_COLUMN_META(Post, id, "post_id").primary_key().autoincrement(),
+        SQLINQ_COLUMN_META(Post, title, "title"));
+  }
+};
+
+struct Comment {
+  int id;
+  int post_id;
+  std::string body;
+};
+
+template <> struct sqlinq::Table<Comment> {
+  SQLINQ_COLUMN(0, Comment, id)
+  SQLINQ_COLUMN(1, Comment, post_id)
+  SQLINQ_COLUMN(2, Comment, body)
+
+  static consteval auto meta() {
+    return make_table<Comment>(
+        "comments",
+        SQLINQ_COLUMN_META(Comment, id, "comment_id")
+            .primary_key()
+            .autoincrement(),
+        SQLINQ_COLUMN_META(Comment, post_id, "post_id").foreign_key(),
+        SQLINQ_COLUMN_META(Comment, body, "body"));
+  }
+};
+
+#ifdef SQLINQ_HAS_INT128
+struct Ledger {
+  int id;
+  Decimal<38, 6> amount;
+};
+
+template <> struct sqlinq::Table<Ledger> {
+  SQLINQ_COLUMN(0, Ledger, id)
+  SQLINQ_COLUMN(1, Ledger, amount)
+
+  static consteval auto meta() {
+    return make_table<Ledger>(
+        "ledger",
+        SQLINQ_COLUMN_META(Ledger, id, "entry_id").primary_key().autoincrement(),
+        SQLINQ_COLUMN_META(Ledger, amount, "amount"));
+  }
+};
+#endif
+
+class SQLiteDatabaseTest : public ::testing::Test {
+protected:
+  std::filesystem::path path_ =
+      std::filesystem::temp_directory_path() / "sqlinq_database_test.sqlite3";
+  DatabaseConfig cfg_;
+
+  void SetUp() override {
+    remove_files();
+    cfg_.database = path_.string();
+    cfg_.sqlite.preset = "throughput";
+
+    SQLiteBackend backend;
+    backend.connect(cfg_);
+    backend.stmt_init();
+    backend.stmt_prepare("CREATE TABLE items ("
+                         "item_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                         "item_name TEXT NOT NULL UNIQUE,"
+                         "qty INTEGER NOT NULL)");
+    ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+    backend.stmt_close();
+  }
+
+  void TearDown() override { remove_files(); }
+
+  // Posts 1-3; the first has two comments, the second one, the third none
+  void create_posts(SQLiteDatabase &db) {
+    SQLiteBackend backend;
+    backend.connect(cfg_);
+    for (const char *sql :
+         {"CREATE TABLE posts (post_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+          "title TEXT NOT NULL)",
+          "CREATE TABLE comments ("
+          "comment_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+          "post_id INTEGER NOT NULL REFERENCES posts(post_id),"
+          "body TEXT NOT NULL)"}) {
+      backend.stmt_init();
+      backend.stmt_prepare(sql);
+      ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+      backend.stmt_close();
+    }
+    for (const char *title : {"first", "second", "third"}) {
+      Post post{.id = 0, .title = title};
+      db.create(post);
+    }
+    for (auto [post_id, body] : {std::pair{1, "nice"}, std::pair{2, "meh"},
+                                 std::pair{1, "agreed"}}) {
+      Comment comment{.id = 0, .post_id = post_id, .body = body};
+      db.create(comment);
+    }
+  }
+
+  void remove_files() {
+    std::filesystem::remove(path_);
+    std::filesystem::remove(path_.string() + "-wal");
+    std::filesystem::remove(path_.string() + "-shm");
+  }
+};
+
+TEST_F(SQLiteDatabaseTest, RejectInMemoryDatabase) {
+  DatabaseConfig cfg;
+  cfg.database = ":memory:";
+  EXPECT_THROW(SQLiteDatabase(cfg, 1), std::invalid_argument);
+}
+
+TEST_F(SQLiteDatabaseTest, WriterSwitchesToWal) {
+  auto journal_mode = [](SQLiteDatabase &db) {
+    auto lease = db.readers().acquire();
+    lease->stmt_init();
+    lease->stmt_prepare("PRAGMA journal_mode");
+    lease->stmt_execute();
+    Cursor<std::tuple<std::string>> cursor{*lease};
+    return cursor.next() ? std::get<0>(cursor.current()) : "";
+  };
+
+  DatabaseConfig cfg = cfg_;
+  cfg.sqlite = {};
+  cfg.sqlite.journal_mode = "DELETE"; // chosen by the caller, kept
+  {
+    SQLiteDatabase db{cfg, 1};
+    EXPECT_EQ(journal_mode(db), "delete");
+  }
+  cfg.sqlite.journal_mode.reset();
+  SQLiteDatabase db{cfg, 1};
+  EXPECT_EQ(journal_mode(db), "wal");
+}
+
+TEST_F(SQLiteDatabaseTest, WritesAreVisibleToReaders) {
+  SQLiteDatabase db{cfg_, 2};
+  EXPECT_EQ(db.readers().size(), 2);
+
+  Item item{.id = 0, .name = "bolt", .qty = 10};
+  db.create(item);
+  ASSERT_NE(item.id, 0);
+
+  auto found = db.find<Item>(item.id);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->name, "bolt");
+
+  found->qty = 12;
+  db.update(*found);
+
+  int rows = 0;
+  for (auto &i : db.get_all<Item>()) {
+    EXPECT_EQ(i.qty, 12);
+    rows++;
+  }
+  EXPECT_EQ(rows, 1);
+  EXPECT_EQ(db.readers().available(), 2);
+
+  db.remove<Item>(item.id);
+  EXPECT_FALSE(db.find<Item>(item.id).has_value());
+}
+
+TEST_F(SQLiteDatabaseTest, ReadersRejectWrites) {
+  SQLiteDatabase db{cfg_, 1};
+  auto lease = db.readers().acquire();
+  Database reader{*lease};
+  Item item{.id = 0, .name = "nut", .qty = 1};
+  EXPECT_THROW(reader.create(item), std::runtime_error);
+}
+
+TEST_F(SQLiteDatabaseTest, ConcurrentReadersAndWriters) {
+  SQLiteDatabase db{cfg_, 4};
+  std::atomic<int> found{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 25; i++) {
+        Item item{.id = 0, .name = std::to_string(t * 100 + i), .qty = i};
+        db.create(item);
+        if (db.find<Item>(item.id).has_value()) {
+          found++;
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(found.load(), 100);
+
+  auto q = Query<Item>().select(count());
+  auto cursor = db.execute(q);
+  ASSERT_TRUE(cursor.next());
+  EXPECT_EQ(std::get<0>(cursor.current()), 100);
+}
+
+TEST_F(SQLiteDatabaseTest, WriteQueueBatchesConcurrentWrites) {
+  SQLiteDatabase db{cfg_, 2};
+  std::vector<std::thread> threads;
+  std::atomic<int> inserted{0};
+  {
+    SQLiteWriteQueue queue{db, 16};
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&, t] {
+        std::vector<std::future<uint64_t>> rowids;
+        for (int i = 0; i < 50; i++) {
+          // the item goes out of scope before the write is committed
+          Item item{.id = 0, .name = std::to_string(t * 100 + i), .qty = i};
+          rowids.emplace_back(queue.create(item));
+        }
+        for (auto &f : rowids) {
+          if (f.get() != 0) {
+            inserted++;
+          }
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+  EXPECT_EQ(inserted.load(), 200);
+
+  auto found = db.find<Item>(1);
+  ASSERT_TRUE(found.has_value());
+  auto q = Query<Item>().select(count());
+  auto cursor = db.execute(q);
+  ASSERT_TRUE(cursor.next());
+  EXPECT_EQ(std::get<0>(cursor.current()), 200);
+}
+
+TEST_F(SQLiteDatabaseTest, WriteQueueFailsOnlyOffendingStatement) {
+  SQLiteDatabase db{cfg_, 1};
+  SQLiteWriteQueue queue{db};
+  Item a{.id = 0, .name = "washer", .qty = 1};
+  Item b{.id = 0, .name = "washer", .qty = 2};
+  Item c{.id = 0, .name = "spring", .qty = 3};
+  auto fa = queue.create(a);
+  auto fb = queue.create(b);
+  auto fc = queue.create(c);
+
+  a.id = static_cast<int>(fa.get());
+  EXPECT_THROW(fb.get(), std::runtime_error);
+  EXPECT_NE(fc.get(), 0);
+
+  a.qty = 5;
+  queue.update(a).get();
+  EXPECT_EQ(db.find<Item>(a.id)->qty, 5);
+
+  queue.remove<Item>(a.id).get();
+  EXPECT_FALSE(db.find<Item>(a.id).has_value());
+}
+
+TEST_F(SQLiteDatabaseTest, WriteQueueRedoesRolledBackTransaction) {
+  SQLiteDatabase db{cfg_, 1};
+  db.with_writer([](Database &writer) {
+    Statement trigger{"CREATE TRIGGER poison BEFORE INSERT ON items "
+                      "WHEN NEW.item_name = 'poison' "
+                      "BEGIN SELECT RAISE(ROLLBACK, 'poisoned'); END",
+                      {}};
+    writer.execute(trigger);
+  });
+  SQLiteWriteQueue queue{db};
+  Item a{.id = 0, .name = "nut", .qty = 1};
+  Item b{.id = 0, .name = "poison", .qty = 2};
+  Item c{.id = 0, .name = "bolt", .qty = 3};
+  std::future<uint64_t> fa, fb, fc;
+  // the worker waits for the writer, so the inserts share one batch
+  db.with_writer([&](Database &) {
+    fa = queue.create(a);
+    fb = queue.create(b);
+    fc = queue.create(c);
+  });
+
+  uint64_t ida = fa.get();
+  EXPECT_THROW(fb.get(), std::runtime_error);
+  uint64_t idc = fc.get();
+  EXPECT_TRUE(db.find<Item>(static_cast<int>(ida)).has_value());
+  EXPECT_TRUE(db.find<Item>(static_cast<int>(idc)).has_value());
+
+  a.id = static_cast<int>(ida);
+  a.qty = 4;
+  queue.update(a).get();
+  EXPECT_EQ(db.find<Item>(a.id)->qty, 4);
+}
+
+TEST_F(SQLiteDatabaseTest, SaveInsertsThenUpdates) {
+  SQLiteDatabase db{cfg_, 1};
+  Item item{.id = 0, .name = "gear", .qty = 1};
+  db.save(item);
+  ASSERT_NE(item.id, 0);
+
+  item.qty = 9;
+  db.save(item);
+  EXPECT_EQ(db.find<Item>(item.id)->qty, 9);
+
+  std::vector<Item> items{{item.id, "gear", 4}, {50, "pulley", 2}};
+  db.save(std::span{items});
+  EXPECT_EQ(db.find<Item>(item.id)->qty, 4);
+  EXPECT_EQ(db.find<Item>(50)->name, "pulley");
+}
+
+TEST_F(SQLiteDatabaseTest, UpsertOnUniqueColumn) {
+  SQLiteDatabase db{cfg_, 1};
+  for (int qty : {1, 2}) {
+    auto q = Query<Item>().upsert([qty](auto &i) {
+      i.name = "axle";
+      i.qty = qty;
+    });
+    db.execute(q);
+  }
+  EXPECT_EQ(db.find<Item>(1)->qty, 2);
+
+  // the cursor keeps the only reader leased
+  auto q = Query<Item>().select(count());
+  auto cursor = db.execute(q);
+  ASSERT_TRUE(cursor.next());
+  EXPECT_EQ(std::get<0>(cursor.current()), 1);
+}
+
+TEST_F(SQLiteDatabaseTest, ReturningStreamsWrittenRows) {
+  SQLiteDatabase db{cfg_, 1};
+  Item item{.id = 0, .name = "cog", .qty = 3};
+  db.create(item);
+  ASSERT_NE(item.id, 0);
+
+  auto insert = Query<Item>()
+                    .insert([](auto &i) {
+                      i.name = "rivet";
+                      i.qty = 7;
+                    })
+                    .returning();
+  auto inserted = db.to_vector(insert);
+  ASSERT_EQ(inserted.size(), 1);
+  EXPECT_NE(inserted[0].id, item.id);
+  EXPECT_EQ(inserted[0].name, "rivet");
+
+  auto update = Query<Item>()
+                    .update([](auto &i) { i.qty = 0; })
+                    .where([](auto i) { return i.qty < 10; })
+                    .returning();
+  auto updated = db.to_vector(update);
+  ASSERT_EQ(updated.size(), 2);
+  EXPECT_EQ(updated[0].qty, 0);
+  EXPECT_EQ(updated[1].qty, 0);
+
+  auto remove = Query<Item>()
+                    .remove()
+                    .where([](auto i) { return i.name == "cog"; })
+                    .returning();
+  auto removed = db.to_vector(remove);
+  ASSERT_EQ(removed.size(), 1);
+  EXPECT_EQ(removed[0].id, item.id);
+  EXPECT_FALSE(db.find<Item>(item.id).has_value());
+}
+
+TEST_F(SQLiteDatabaseTest, PrefetchKeepsReaderLeased) {
+  SQLiteDatabase db{cfg_, 1};
+  for (int i = 1; i <= 100; i++) {
+    Item item{.id = 0, .name = "part-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+
+  auto q = Query<Item>().select_all().order_by(&Item::id);
+  {
+    auto cursor = db.execute(q).prefetch(8);
+    EXPECT_EQ(db.readers().available(), 0);
+    int expected = 1;
+    for (auto &item : cursor) {
+      EXPECT_EQ(item.qty, expected++);
+    }
+    EXPECT_EQ(expected, 101);
+  }
+  EXPECT_EQ(db.readers().available(), 1);
+}
+
+TEST_F(SQLiteDatabaseTest, ParallelScanVisitsEveryRowOnce) {
+  SQLiteDatabase db{cfg_, 4};
+  int parallel_scan_rows = 0;
+  db.parallel_scan<Item>(0, [&](Item &) { parallel_scan_rows++; });
+  EXPECT_EQ(parallel_scan_rows, 0);
+
+  db.with_writer([](Database &w) {
+    Statement begin{"BEGIN", {}};
+    w.execute(begin);
+    for (int i = 1; i <= 1000; i++) {
+      Item item{.id = 0, .name = "part-" + std::to_string(i), .qty = i};
+      w.create(item);
+    }
+    Statement commit{"COMMIT", {}};
+    w.execute(commit);
+  });
+
+  std::atomic<int> rows{0};
+  std::atomic<long> qty{0};
+  db.parallel_scan<Item>(4, [&](Item &item) {
+    rows++;
+    qty += item.qty;
+  });
+  EXPECT_EQ(rows, 1000);
+  EXPECT_EQ(qty, 1000 * 1001 / 2);
+
+  std::atomic<int> batches{0};
+  rows = 0;
+  db.parallel_scan<Item>(
+      3,
+      [&](std::span<Item> batch) {
+        batches++;
+        rows += static_cast<int>(batch.size());
+      },
+      100);
+  EXPECT_EQ(rows, 1000);
+  EXPECT_GE(batches, 10);
+
+  auto items = db.parallel_to_vector<Item>(7);
+  ASSERT_EQ(items.size(), 1000);
+  EXPECT_TRUE(std::is_sorted(items.begin(), items.end(),
+                             [](auto &a, auto &b) { return a.id < b.id; }));
+  EXPECT_EQ(db.readers().available(), 4);
+}
+
+TEST_F(SQLiteDatabaseTest, ParallelScanForwardsCallbackErrors) {
+  SQLiteDatabase db{cfg_, 2};
+  for (int i = 1; i <= 10; i++) {
+    Item item{.id = 0, .name = "pin-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+  EXPECT_THROW(db.parallel_scan<Item>(2,
+                                      [](Item &item) {
+                                        if (item.qty == 7) {
+                                          throw std::runtime_error("bad row");
+                                        }
+                                      }),
+               std::runtime_error);
+  EXPECT_EQ(db.readers().available(), 2);
+}
+
+TEST_F(SQLiteDatabaseTest, QueryExecutorRunsIndependentQueries) {
+  SQLiteDatabase db{cfg_, 3};
+  for (int i = 1; i <= 20; i++) {
+    Item item{.id = 0, .name = "washer-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+
+  QueryExecutor executor{db.readers(), 8};
+  EXPECT_EQ(executor.concurrency(), 3);
+
+  std::vector<std::future<std::optional<Item>>> found;
+  for (int id = 1; id <= 20; id++) {
+    found.push_back(executor.find<Item>(id));
+  }
+  auto [big, total] = executor.submit_all(
+      Query<Item>().select_all().where([](auto i) { return i.qty > 15; }),
+      [](Database &d) { return d.pk_bounds<Item>()->second; });
+  auto missing = executor.submit([](Database &d) {
+    if (!d.find<Item>(99).has_value()) {
+      throw std::out_of_range("no item 99");
+    }
+  });
+
+  for (int id = 1; id <= 20; id++) {
+    auto item = found[id - 1].get();
+    ASSERT_TRUE(item.has_value());
+    EXPECT_EQ(item->qty, id);
+  }
+  EXPECT_EQ(big.get().size(), 5);
+  EXPECT_EQ(total.get(), 20);
+  EXPECT_THROW(missing.get(), std::out_of_range);
+}
+
+TEST_F(SQLiteDatabaseTest, CacheIsInvalidatedByCommittedWrites) {
+  SQLiteDatabase db{cfg_, 2};
+  QueryCache cache;
+  db.attach_cache(cache);
+  for (int i = 1; i <= 3; i++) {
+    Item item{.id = 0, .name = "pin-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+
+  auto total = [&] {
+    auto q = Query<Item>().select(sum(&Item::qty));
+    return std::get<0>(db.to_vector(q).at(0));
+  };
+  EXPECT_EQ(total(), 6);
+  EXPECT_EQ(total(), 6);
+  EXPECT_EQ(cache.stats().hits, 1);
+
+  // raw statements bypass Database, the update hook still sees them
+  db.with_writer([](Database &d) {
+    Statement stmt{.sql = "UPDATE items SET qty = qty * 10", .params = {}};
+    d.execute(stmt);
+  });
+  EXPECT_EQ(total(), 60);
+
+  // rolled back changes leave the cache alone
+  db.with_writer([](Database &d) {
+    Statement begin{.sql = "BEGIN", .params = {}};
+    Statement update{.sql = "UPDATE items SET qty = 0", .params = {}};
+    Statement rollback{.sql = "ROLLBACK", .params = {}};
+    d.execute(begin);
+    d.execute(update);
+    d.execute(rollback);
+  });
+  EXPECT_EQ(total(), 60);
+  EXPECT_EQ(cache.stats().hits, 2);
+  EXPECT_EQ(cache.stats().invalidations, 1);
+}
+
+TEST_F(SQLiteDatabaseTest, ViewCursorReadsTextInPlace) {
+  SQLiteDatabase db{cfg_, 1};
+  for (int i = 1; i <= 3; i++) {
+    Item item{.id = 0, .name = "nut-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+
+  auto q = Query<Item>().select_all().order_by(&Item::id);
+  std::size_t bytes = 0;
+  for (auto &[id, name, qty] : db.execute_view(q)) {
+    static_assert(std::is_same_v<decltype(name), TextView>);
+    EXPECT_EQ(name, "nut-" + std::to_string(id));
+    bytes += name.size();
+  }
+  EXPECT_EQ(bytes, 15);
+}
+
+TEST_F(SQLiteDatabaseTest, ToTableStoresRowsColumnWise) {
+  SQLiteDatabase db{cfg_, 1};
+  for (int i = 1; i <= 50; i++) {
+    Item item{.id = 0, .name = "screw-" + std::to_string(i), .qty = i};
+    db.create(item);
+  }
+
+  auto q = Query<Item>().select_all().order_by(&Item::id);
+  auto table = db.to_table(q, 50);
+  ASSERT_EQ(table.size(), 50);
+  EXPECT_EQ(table[9].get<1>(), "screw-10");
+  auto qty = table.column<2>();
+  EXPECT_EQ(std::accumulate(qty.begin(), qty.end(), 0), 1275);
+
+  Item item = table[49].materialize();
+  EXPECT_EQ(item.id, 50);
+  EXPECT_EQ(item.name, "screw-50");
+}
+
+TEST_F(SQLiteDatabaseTest, HashJoinsCursorsOfTwoConnections) {
+  SQLiteDatabase db{cfg_, 2};
+  for (int i = 0; i < 6; i++) {
+    Item item{.id = 0, .name = "part-" + std::to_string(i), .qty = i % 3};
+    db.create(item);
+  }
+
+  auto first = db.readers().acquire();
+  auto second = db.readers().acquire();
+  Database left{*first};
+  Database right{*second};
+  auto q = Query<Item>().select_all().where(
+      [](auto i) { return i.qty > 0; });
+  auto left_cursor = left.execute(q);
+  auto right_cursor = right.get_all<Item>(0, 100);
+
+  int pairs = 0;
+  hash_join(left_cursor, right_cursor, &Item::qty, &Item::qty,
+            [&](const Item &l, const Item &r) {
+              EXPECT_EQ(l.qty, r.qty);
+              pairs++;
+            });
+  EXPECT_EQ(pairs, 8);
+}
+
+TEST_F(SQLiteDatabaseTest, DatesWithIntegerStorage) {
+  using namespace std::chrono;
+  {
+    SQLiteBackend backend;
+    backend.connect(cfg_);
+    backend.stmt_init();
+    backend.stmt_prepare("CREATE TABLE shifts ("
+                         "shift_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                         "day INTEGER NOT NULL,"
+                         "start INTEGER NOT NULL,"
+                         "logged INTEGER NOT NULL)");
+    ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+    backend.stmt_close();
+  }
+
+  SQLiteDatabase db{cfg_, 1};
+  const Date first{year{2024}, month{2}, day{27}};
+  for (int i = 0; i < 5; i++) {
+    Shift shift{.id = 0,
+                .day = sys_days{first} + days{i},
+                .start = Time{hours{6 + i}},
+                .logged = sys_days{first} + days{i} + hours{18}};
+    db.create(shift);
+  }
+
+  auto q = Query<Shift>()
+               .select_all()
+               .where([&](auto s) {
+                 return s.day >= Date{year{2024}, month{2}, day{29}} &&
+                        s.start < Time{hours{10}};
+               })
+               .order_by(&Shift::id);
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0].day, (Date{year{2024}, month{2}, day{29}}));
+  EXPECT_EQ(rows[1].day, (Date{year{2024}, month{3}, day{1}}));
+  EXPECT_EQ(rows[1].start.hours().count(), 9);
+  EXPECT_EQ(to_string(rows[1].logged), "2024-03-01 18:00:00");
+
+  const Date march{year{2024}, month{3}, day{1}};
+  auto late = Query<Shift>()
+                  .select(&Shift::start, min(&Shift::day))
+                  .group_by(&Shift::start)
+                  .having(min(&Shift::day) >= march);
+  EXPECT_EQ(db.to_vector(late).size(), 2);
+
+  // stored as numbers, not ISO text
+  SQLiteBackend backend;
+  backend.connect(cfg_);
+  backend.stmt_init();
+  backend.stmt_prepare(
+      "SELECT day, start, logged FROM shifts WHERE shift_id = 1");
+  ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+  int64_t values[3];
+  BindData bind[3];
+  for (std::size_t i = 0; i < 3; i++) {
+    bind[i] = BindData{&values[i], nullptr, sizeof(int64_t),
+                       nullptr,    nullptr, column::Type::BigInt};
+  }
+  backend.bind_result(bind, 3);
+  ASSERT_EQ(backend.stmt_fetch(), ExecStatus::Row);
+  EXPECT_EQ(values[0], sys_days{first}.time_since_epoch().count());
+  EXPECT_EQ(values[1], 6 * 3600);
+  EXPECT_EQ(values[2], values[0] * 86400 + 18 * 3600);
+  backend.stmt_close();
+}
+
+TEST_F(SQLiteDatabaseTest, DatePrimaryKeyWithIntegerStorage) {
+  using namespace std::chrono;
+  {
+    SQLiteBackend backend;
+    backend.connect(cfg_);
+    backend.stmt_init();
+    backend.stmt_prepare("CREATE TABLE holidays ("
+                         "day INTEGER PRIMARY KEY, name TEXT NOT NULL)");
+    ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+    backend.stmt_close();
+  }
+
+  SQLiteDatabase db{cfg_, 1};
+  const Date day{year{2024}, month{5}, std::chrono::day{1}};
+  Holiday holiday{.day = day, .name = "Labour Day"};
+  db.create(holiday);
+
+  auto found = db.find<Holiday>(day);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->name, "Labour Day");
+  db.remove<Holiday>(day);
+  EXPECT_FALSE(db.find<Holiday>(day).has_value());
+}
+
+#ifdef SQLINQ_HAS_INT128
+TEST_F(SQLiteDatabaseTest, WideDecimalsRoundTripInOrder) {
+  {
+    SQLiteBackend backend;
+    backend.connect(cfg_);
+    backend.stmt_init();
+    backend.stmt_prepare("CREATE TABLE ledger ("
+                         "entry_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                         "amount BLOB NOT NULL)");
+    ASSERT_EQ(backend.stmt_execute(), ExecStatus::Ok);
+    backend.stmt_close();
+  }
+
+  using Amount = Decimal<38, 6>;
+  SQLiteDatabase db{cfg_, 1};
+  const char *amounts[] = {"12345678901234567890123456789012.000001",
+                           "-0.5", "0", "-98765432109876543210.123456", "7"};
+  for (const char *amount : amounts) {
+    Ledger entry{.id = 0, .amount = Amount{amount}};
+    db.create(entry);
+  }
+
+  auto q = Query<Ledger>()
+               .select_all()
+               .where([](auto l) { return l.amount > Amount{-1}; })
+               .order_by(&Ledger::amount);
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(rows.size(), 4);
+  EXPECT_EQ(to_string(rows[0].amount), "-0.500000");
+  EXPECT_EQ(to_string(rows[1].amount), "0.000000");
+  EXPECT_EQ(to_string(rows[2].amount), "7.000000");
+  EXPECT_EQ(to_string(rows[3].amount),
+            "12345678901234567890123456789012.000001");
+}
+#endif
+
+TEST_F(SQLiteDatabaseTest, JoinsThroughForeignKeys) {
+  SQLiteDatabase db{cfg_, 1};
+  create_posts(db);
+
+  auto q = Query<Post>()
+               .join<Comment>(&Comment::post_id)
+               .where([](auto p) { return p.id < 3; })
+               .order_by(&Post::id);
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(rows.size(), 3);
+  for (auto &[post, comment] : rows) {
+    EXPECT_EQ(post.id, comment.post_id);
+  }
+  EXPECT_EQ(std::get<0>(rows[2]).title, "second");
+  EXPECT_EQ(std::get<1>(rows[2]).body, "meh");
+
+  auto left = Query<Post>().left_join<Comment>(&Comment::post_id).order_by(
+      &Post::id);
+  int unmatched = 0;
+  for (auto &[post, comment] : db.execute(left)) {
+    if (!comment.has_value()) {
+      EXPECT_EQ(post.title, "third");
+      unmatched++;
+    }
+  }
+  EXPECT_EQ(unmatched, 1);
+
+  auto parents = Query<Comment>().join<Post>(&Comment::post_id);
+  for (auto &[comment, post] : db.execute(parents)) {
+    EXPECT_EQ(comment.post_id, post.id);
+  }
+}
+
+TEST_F(SQLiteDatabaseTest, LoadsRelatedEntitiesInBatches) {
+  SQLiteDatabase db{cfg_, 1};
+  create_posts(db);
+
+  auto q = Query<Post>().select_all().order_by(&Post::id);
+  auto posts = db.load(q).include(&Comment::post_id).to_vector();
+  ASSERT_EQ(posts.size(), 3);
+  auto &[first, first_comments] = posts[0];
+  EXPECT_EQ(first.title, "first");
+  ASSERT_EQ(first_comments.size(), 2);
+  EXPECT_EQ(first_comments[0].body, "nice");
+  EXPECT_EQ(first_comments[1].body, "agreed");
+  ASSERT_EQ(std::get<1>(posts[1]).size(), 1);
+  EXPECT_EQ(std::get<1>(posts[1])[0].body, "meh");
+  EXPECT_TRUE(std::get<1>(posts[2]).empty());
+
+  auto cq = Query<Comment>().select_all().where(
+      [](auto c) { return c.body != "meh"; });
+  auto comments = db.load(cq).include<Post>(&Comment::post_id).to_vector();
+  ASSERT_EQ(comments.size(), 2);
+  for (auto &[comment, post] : comments) {
+    ASSERT_TRUE(post.has_value());
+    EXPECT_EQ(post->id, comment.post_id);
+    EXPECT_EQ(post->title, "first");
+  }
+}
+
+TEST_F(SQLiteDatabaseTest, GroupsSeveralAggregatesInOneQuery) {
+  SQLiteDatabase db{cfg_, 1};
+  create_posts(db);
+
+  auto q = Query<Comment>()
+               .select(&Comment::post_id, count(), sum(&Comment::id),
+                       min(&Comment::body))
+               .group_by(&Comment::post_id)
+               .order_by(&Comment::post_id);
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0], std::tuple(1, 2, int64_t{4}, std::string{"agreed"}));
+  EXPECT_EQ(rows[1], std::tuple(2, 1, int64_t{2}, std::string{"meh"}));
+
+  auto busy = Query<Comment>()
+                  .select(&Comment::post_id, count())
+                  .group_by(&Comment::post_id)
+                  .having(count() > 1);
+  EXPECT_EQ(db.to_vector(busy), (std::vector<std::tuple<int, int>>{{1, 2}}));
+}
+
+TEST_F(SQLiteDatabaseTest, WindowFunctionsRunInTheDatabase) {
+  SQLiteDatabase db{cfg_, 1};
+  create_posts(db);
+
+  auto q = Query<Comment>()
+               .select(&Comment::id,
+                       row_number()
+                           .partition_by(&Comment::post_id)
+                           .order_by(&Comment::id),
+                       lag(&Comment::body)
+                           .partition_by(&Comment::post_id)
+                           .order_by(&Comment::id),
+                       sum(&Comment::id).order_by(&Comment::id))
+               .order_by(&Comment::id);
+  using row = std::tuple<int, int64_t, std::optional<std::string>, int64_t>;
+  EXPECT_EQ(db.to_vector(q), (std::vector<row>{{1, 1, std::nullopt, 1},
+                                               {2, 1, std::nullopt, 3},
+                                               {3, 2, "nice", 6}}));
+
+  // latest comment of every post
+  auto latest = Query<Comment>()
+                    .select_all()
+                    .qualify(row_number()
+                                 .partition_by(&Comment::post_id)
+                                 .order_by_desc(&Comment::id) == 1)
+                    .order_by(&Comment::post_id);
+  auto comments = db.to_vector(latest);
+  ASSERT_EQ(comments.size(), 2);
+  EXPECT_EQ(comments[0].body, "agreed");
+  EXPECT_EQ(comments[1].body, "meh");
+}
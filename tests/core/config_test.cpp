@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <sqlinq/config.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace sqlinq;
+
+class ConfigFileTest : public ::testing::Test {
+protected:
+  std::filesystem::path path_ =
+      std::filesystem::temp_directory_path() / "sqlinq_config_test.conf";
+
+  void write(const char *content) {
+    std::ofstream file{path_};
+    file << content;
+  }
+
+  void TearDown() override { std::filesystem::remove(path_); }
+};
+
+TEST_F(ConfigFileTest, ParseConnectionFields) {
+  write("[mysql]\n"
+        "host=127.0.0.1\n"
+        "port=3306\n"
+        "user=root\n"
+        "password=passwd\n"
+        "database=personnel\n");
+
+  auto cfg = parse_config_file(path_.string());
+  ASSERT_EQ(cfg.count("mysql"), 1);
+  const auto &mysql = cfg.at("mysql");
+  EXPECT_EQ(mysql.host, "127.0.0.1");
+  EXPECT_EQ(mysql.port, 3306);
+  EXPECT_EQ(mysql.user, "root");
+  EXPECT_EQ(mysql.passwd, "passwd");
+  EXPECT_EQ(mysql.database, "personnel");
+}
+
+TEST_F(ConfigFileTest, SQLiteOptionsDefaultToUnset) {
+  write("[sqlite]\n"
+        "database=personnel.sqlite3\n");
+
+  auto cfg = parse_config_file(path_.string());
+  SQLiteOptions opts = cfg.at("sqlite").sqlite;
+  apply_sqlite_preset(opts);
+  EXPECT_TRUE(opts.open_flags.empty());
+  EXPECT_FALSE(opts.journal_mode.has_value());
+  EXPECT_FALSE(opts.synchronous.has_value());
+  EXPECT_FALSE(opts.cache_size.has_value());
+  EXPECT_FALSE(opts.busy_timeout.has_value());
+}
+
+TEST_F(ConfigFileTest, SQLitePresetKeepsExplicitKeys) {
+  write("[sqlite]\n"
+        "synchronous=FULL\n"
+        "preset=throughput\n"
+        "open_flags=nomutex\n"
+        "page_size=8192\n");
+
+  auto cfg = parse_config_file(path_.string());
+  SQLiteOptions opts = cfg.at("sqlite").sqlite;
+  apply_sqlite_preset(opts);
+  EXPECT_EQ(opts.open_flags, "nomutex");
+  EXPECT_EQ(opts.journal_mode, "WAL");
+  EXPECT_EQ(opts.synchronous, "FULL");
+  EXPECT_EQ(opts.temp_store, "MEMORY");
+  EXPECT_EQ(opts.cache_size, -65536);
+  EXPECT_EQ(opts.mmap_size, 268435456);
+  EXPECT_EQ(opts.busy_timeout, 5000);
+  EXPECT_EQ(opts.page_size, 8192);
+}
+
+TEST_F(ConfigFileTest, UnknownKeyAndBadNumberThrow) {
+  auto message = [this](const char *content) -> std::string {
+    write(content);
+    try {
+      parse_config_file(path_.string());
+    } catch (const std::invalid_argument &e) {
+      return e.what();
+    }
+    return "";
+  };
+
+  EXPECT_EQ(message("[sqlite]\nsynchronus=OFF\n"),
+            "[sqlite] Unknown key: synchronus");
+  EXPECT_EQ(message("[sqlite]\njournal-mode=WAL\n"),
+            "[sqlite] Unknown key: journal-mode");
+  EXPECT_EQ(message("[sqlite]\ncache_size=64MiB\n"),
+            "[sqlite] Invalid number for cache_size: 64MiB");
+  EXPECT_EQ(message("[mysql]\nport=\n"), "[mysql] Invalid number for port: ");
+}
+
+TEST(SQLitePresetTest, UnknownPresetThrows) {
+  SQLiteOptions opts;
+  opts.preset = "fastest";
+  EXPECT_THROW(apply_sqlite_preset(opts), std::invalid_argument);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sqlinq/hash_join.hpp"
+
+using namespace sqlinq;
+
+struct Author {
+  int id;
+  std::string name;
+};
+
+struct Book {
+  int id;
+  std::optional<long> author_id;
+  std::string title;
+};
+
+// Unsized single pass source, read like a Cursor
+template <typename T> class Stream {
+public:
+  explicit Stream(std::vector<T> rows) : rows_(std::move(rows)) {}
+
+  struct iterator {
+    Stream *stream;
+    std::size_t pos;
+
+    T &operator*() { return stream->current_; }
+    iterator &operator++() {
+      stream->reads_++;
+      if (++pos < stream->rows_.size()) {
+        stream->current_ = stream->rows_[pos];
+      }
+      return *this;
+    }
+    bool operator==(const iterator &other) const noexcept {
+      return std::min(pos, stream->rows_.size()) ==
+             std::min(other.pos, stream->rows_.size());
+    }
+  };
+
+  iterator begin() {
+    if (!rows_.empty()) {
+      current_ = rows_.front();
+    }
+    return {this, 0};
+  }
+  iterator end() { return {this, rows_.size()}; }
+  std::size_t reads() const noexcept { return reads_; }
+
+private:
+  std::vector<T> rows_;
+  T current_{};
+  std::size_t reads_ = 0;
+};
+
+class HashJoinTest : public ::testing::Test {
+protected:
+  std::vector<Author> authors_{{1, "Lem"}, {2, "Dukaj"}, {3, "Sapkowski"}};
+  std::vector<Book> books_{{10, 1, "Solaris"},
+                           {11, 3, "Blood of Elves"},
+                           {12, 1, "Fiasco"},
+                           {13, std::nullopt, "Anonymous"},
+                           {14, 4, "Orphan"},
+                           {15, 1, "Eden"}};
+
+  static std::vector<std::pair<int, int>>
+  sorted_ids(const std::vector<std::pair<Author, Book>> &pairs) {
+    std::vector<std::pair<int, int>> ids;
+    for (const auto &[author, book] : pairs) {
+      ids.emplace_back(author.id, book.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+  const std::vector<std::pair<int, int>> expected_{
+      {1, 10}, {1, 12}, {1, 15}, {3, 11}};
+};
+
+TEST_F(HashJoinTest, JoinsSizedRanges) {
+  auto pairs = hash_join(authors_, books_, &Author::id, &Book::author_id);
+  EXPECT_EQ(sorted_ids(pairs), expected_);
+
+  // the larger side on the left is streamed instead
+  std::vector<std::pair<int, int>> ids;
+  hash_join(books_, authors_, &Book::author_id, &Author::id,
+            [&](const Book &book, const Author &author) {
+              ids.emplace_back(author.id, book.id);
+            });
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, expected_);
+}
+
+TEST_F(HashJoinTest, StreamsCursorAgainstVector) {
+  Stream<Book> books{books_};
+  auto pairs = hash_join(authors_, books, &Author::id, &Book::author_id);
+  EXPECT_EQ(sorted_ids(pairs), expected_);
+  // probe order follows the stream
+  ASSERT_EQ(pairs.size(), 4);
+  EXPECT_EQ(pairs[0].second.title, "Solaris");
+  EXPECT_EQ(pairs[3].second.title, "Eden");
+}
+
+TEST_F(HashJoinTest, LockstepBuildsOnShorterStream) {
+  Stream<Author> authors{authors_};
+  Stream<Book> books{books_};
+  auto pairs = hash_join(authors, books, &Author::id, &Book::author_id);
+  EXPECT_EQ(sorted_ids(pairs), expected_);
+  EXPECT_EQ(authors.reads(), authors_.size());
+  EXPECT_EQ(books.reads(), books_.size());
+}
+
+TEST_F(HashJoinTest, AcceptsKeyCallables) {
+  auto pairs = hash_join(
+      authors_, books_, [](const Author &a) { return a.id * 10; },
+      [](const Book &b) { return b.id; });
+  ASSERT_EQ(pairs.size(), 1);
+  EXPECT_EQ(pairs[0].first.name, "Lem");
+  EXPECT_EQ(pairs[0].second.title, "Solaris");
+}
+
+TEST_F(HashJoinTest, SemiJoinKeepsLeftOrder) {
+  auto with_books = semi_join(authors_, Stream<Book>{books_}, &Author::id,
+                              &Book::author_id);
+  ASSERT_EQ(with_books.size(), 2);
+  EXPECT_EQ(with_books[0].name, "Lem");
+  EXPECT_EQ(with_books[1].name, "Sapkowski");
+}
+
+TEST_F(HashJoinTest, PartitionedJoinMatchesPlainJoin) {
+  int left_scans = 0;
+  int right_scans = 0;
+  std::vector<std::pair<Author, Book>> pairs;
+  partitioned_hash_join(
+      [&] {
+        left_scans++;
+        return Stream<Author>{authors_};
+      },
+      [&] {
+        right_scans++;
+        return Stream<Book>{books_};
+      },
+      &Author::id, &Book::author_id, 3,
+      [&](const Author &a, const Book &b) { pairs.emplace_back(a, b); });
+  EXPECT_EQ(sorted_ids(pairs), expected_);
+  EXPECT_EQ(left_scans, 3);
+  EXPECT_LE(right_scans, 3);
+}
+
+namespace {
+struct Country {
+  std::string code;
+  std::string name;
+};
+
+struct City {
+  int id;
+  std::optional<std::string> country;
+};
+} // namespace
+
+TEST(HashJoinOptionalTest, JoinsOptionalTextKeys) {
+  std::vector<Country> countries{{"PL", "Poland"}, {"CZ", "Czechia"}};
+  std::vector<City> cities{{1, "PL"}, {2, std::nullopt}, {3, "DE"}, {4, "PL"}};
+
+  auto pairs = hash_join(countries, Stream<City>{cities}, &Country::code,
+                         &City::country);
+  ASSERT_EQ(pairs.size(), 2);
+  EXPECT_EQ(pairs[0].second.id, 1);
+  EXPECT_EQ(pairs[1].second.id, 4);
+  EXPECT_EQ(pairs[1].first.name, "Poland");
+
+  auto with_cities =
+      semi_join(countries, cities, &Country::code, &City::country);
+  ASSERT_EQ(with_cities.size(), 1);
+  EXPECT_EQ(with_cities[0].code, "PL");
+}
@@ -13,15 +13,22 @@ public:
               (override));
 
   MOCK_METHOD(void, connect, (const DatabaseConfig&), (override));
+  MOCK_METHOD(SqlDialect, dialect, (), (const, noexcept, override));
   MOCK_METHOD(void, disconnect, (), (override));
   MOCK_METHOD(bool, is_connected, (), (const, noexcept, override));
 
   MOCK_METHOD(uint64_t, last_inserted_rowid, (), (const, noexcept, override));
+  MOCK_METHOD(bool, supports_returning, (QueryAst::Operation),
+              (const, noexcept, override));
 
   MOCK_METHOD(void, stmt_close, (), (override));
   MOCK_METHOD(ExecStatus, stmt_execute, (), (override));
   MOCK_METHOD(ExecStatus, stmt_fetch, (), (override));
+  MOCK_METHOD(void, stmt_fetch_strategy, (const FetchStrategy &),
+              (override));
   MOCK_METHOD(void, stmt_fetch_column, (const int, BindData &), (override));
+  MOCK_METHOD(std::span<const std::byte>, stmt_column_view, (const int),
+              (override));
   MOCK_METHOD(void, stmt_init, (), (override));
   MOCK_METHOD(void, stmt_prepare, (std::string_view), (override));
 };
@@ -0,0 +1,70 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "mock_backend.hpp"
+#include "sqlinq/cursor.hpp"
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::SaveArg;
+
+class PrefetchCursorTest : public ::testing::Test {
+protected:
+  NiceMock<MockBackend> backend_;
+  const BindData *bind_ = nullptr;
+  int produced_ = 0;
+
+  // Serves rows 1..limit as a single int column, then throws or ends
+  void serve(int limit, bool fail = false) {
+    ON_CALL(backend_, bind_result(_, _)).WillByDefault(SaveArg<0>(&bind_));
+    ON_CALL(backend_, stmt_fetch()).WillByDefault([this, limit, fail] {
+      if (limit >= 0 && produced_ == limit) {
+        if (fail) {
+          throw std::runtime_error("connection lost");
+        }
+        return ExecStatus::NoData;
+      }
+      *static_cast<int *>(bind_[0].buffer) = ++produced_;
+      return ExecStatus::Row;
+    });
+  }
+};
+
+TEST_F(PrefetchCursorTest, DeliversAllRowsInOrder) {
+  serve(1000);
+  EXPECT_CALL(backend_, stmt_close()).Times(1);
+  int expected = 0;
+  {
+    auto cursor = Cursor<std::tuple<int>>{backend_}.prefetch(8);
+    for (auto &[value] : cursor) {
+      EXPECT_EQ(value, ++expected);
+    }
+    EXPECT_FALSE(cursor.has_next());
+  }
+  EXPECT_EQ(expected, 1000);
+}
+
+TEST_F(PrefetchCursorTest, StopsProducerOnEarlyDestruction) {
+  serve(-1);
+  EXPECT_CALL(backend_, stmt_close()).Times(1);
+  {
+    auto cursor = Cursor<std::tuple<int>>{backend_}.prefetch(4);
+    for (int i = 1; i <= 3; i++) {
+      ASSERT_TRUE(cursor.next());
+      EXPECT_EQ(std::get<0>(cursor.current()), i);
+    }
+  }
+  // the producer never runs further ahead than the ring allows
+  EXPECT_LE(produced_, 3 + 4 + 1);
+}
+
+TEST_F(PrefetchCursorTest, ForwardsFetchErrors) {
+  serve(2, true);
+  auto cursor = Cursor<std::tuple<int>>{backend_}.prefetch(16);
+  EXPECT_TRUE(cursor.next());
+  EXPECT_TRUE(cursor.next());
+  EXPECT_THROW(cursor.next(), std::runtime_error);
+  EXPECT_FALSE(cursor.next());
+}
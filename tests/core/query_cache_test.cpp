@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "sqlinq/query_cache.hpp"
+
+using namespace sqlinq;
+
+namespace {
+std::vector<BoundValue> params(int value) {
+  std::vector<BoundValue> p;
+  p.emplace_back(value);
+  return p;
+}
+} // namespace
+
+TEST(QueryCacheTest, FingerprintCoversParameters) {
+  auto a = params(1);
+  auto b = params(2);
+  const char *sql = "SELECT * FROM t WHERE id = ?";
+  EXPECT_EQ(QueryCache::fingerprint(sql, a), QueryCache::fingerprint(sql, a));
+  EXPECT_NE(QueryCache::fingerprint(sql, a), QueryCache::fingerprint(sql, b));
+  EXPECT_NE(QueryCache::fingerprint(sql, a),
+            QueryCache::fingerprint("SELECT 1", a));
+}
+
+TEST(QueryCacheTest, ServesRowsUntilTableChanges) {
+  QueryCache cache;
+  EXPECT_EQ(cache.get<int>("q", "t"), nullptr);
+
+  cache.put<int>("q", "t", cache.version("t"), {1, 2, 3});
+  auto rows = cache.get<int>("q", "t");
+  ASSERT_NE(rows, nullptr);
+  EXPECT_EQ(*rows, (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(cache.get<long>("q", "t"), nullptr); // other row type
+
+  cache.invalidate("other");
+  EXPECT_NE(cache.get<int>("q", "t"), nullptr);
+  cache.invalidate("t");
+  EXPECT_EQ(cache.get<int>("q", "t"), nullptr);
+  EXPECT_EQ(cache.size(), 0);
+
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 3);
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_DOUBLE_EQ(stats.hit_rate(), 0.4);
+}
+
+TEST(QueryCacheTest, SkipsRowsReadBeforeWrite) {
+  QueryCache cache;
+  uint64_t version = cache.version("t");
+  cache.invalidate("t"); // write committed while the query ran
+  auto rows = cache.put<int>("q", "t", version, {1});
+  EXPECT_EQ(rows->size(), 1);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(QueryCacheTest, EvictsLeastRecentlyUsed) {
+  QueryCache cache{{.max_entries = 2, .max_bytes = 8 * sizeof(int)}};
+  cache.put<int>("a", "t", 0, {1});
+  cache.put<int>("b", "t", 0, {2});
+  cache.get<int>("a", "t");
+  cache.put<int>("c", "t", 0, {3});
+  EXPECT_NE(cache.get<int>("a", "t"), nullptr);
+  EXPECT_EQ(cache.get<int>("b", "t"), nullptr);
+
+  cache.put<int>("d", "t", 0, std::vector<int>(8));
+  EXPECT_EQ(cache.size(), 1); // byte limit
+  cache.put<int>("e", "t", 0, std::vector<int>(9));
+  EXPECT_EQ(cache.get<int>("e", "t"), nullptr); // larger than the cache
+  EXPECT_EQ(cache.stats().evictions, 3);
+}
+
+TEST(QueryCacheTest, ExpiresAfterTtl) {
+  QueryCache cache{{.ttl = std::chrono::milliseconds{1}}};
+  cache.put<int>("q", "t", 0, {1});
+  std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  EXPECT_EQ(cache.get<int>("q", "t"), nullptr);
+  EXPECT_EQ(cache.stats().expirations, 1);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+
+#include "sqlinq/row_table.hpp"
+#include "sqlinq/table.hpp"
+
+using namespace sqlinq;
+
+namespace {
+struct Part {
+  int id;
+  std::string name;
+  std::optional<std::string> note;
+  double price;
+};
+} // namespace
+
+TEST(RowTableTest, PacksFieldsIntoColumns) {
+  RowTable<Part> table;
+  table.reserve(3, 64);
+  table.push_back(Part{1, "bolt", std::nullopt, 0.5});
+  table.push_back(Part{2, "", "spare", 1.25});
+  table.push_back(Part{3, "washer", "zinc", 0.1});
+
+  ASSERT_EQ(table.size(), 3);
+  EXPECT_EQ(table.arena_bytes(), 4 + 5 + 6 + 4);
+
+  auto ids = table.column<0>();
+  EXPECT_EQ(std::vector<int>(ids.begin(), ids.end()),
+            (std::vector<int>{1, 2, 3}));
+
+  auto row = table[2];
+  EXPECT_EQ(row.get<1>(), "washer");
+  EXPECT_EQ(row.get<2>(), std::optional<std::string_view>{"zinc"});
+  EXPECT_FALSE(table[0].get<2>().has_value());
+  EXPECT_TRUE(table[1].get<1>().empty());
+
+  Part part = table[1].materialize();
+  EXPECT_EQ(part.id, 2);
+  EXPECT_EQ(part.note, "spare");
+  EXPECT_DOUBLE_EQ(part.price, 1.25);
+
+  double total = 0;
+  for (auto r : table) {
+    total += r.get<3>();
+  }
+  EXPECT_DOUBLE_EQ(total, 1.85);
+}
+
+TEST(RowTableTest, StoresTuplesAndBlobs) {
+  RowTable<std::tuple<int64_t, Blob>> table;
+  Blob blob{std::byte{0xca}, std::byte{0xfe}};
+  table.push_back(std::tuple{int64_t{7}, blob});
+  table.push_back(std::tuple{int64_t{8}, Blob{}});
+
+  auto bytes = table.get<1>(0);
+  EXPECT_EQ(Blob(bytes.begin(), bytes.end()), blob);
+  EXPECT_TRUE(table.get<1>(1).empty());
+  auto rows = table.to_vector();
+  EXPECT_EQ(rows[0], std::tuple(int64_t{7}, blob));
+  EXPECT_EQ(std::get<0>(rows[1]), 8);
+}
+
+namespace {
+struct Order {
+  int id;
+  std::string status;
+  std::optional<std::string> country;
+};
+} // namespace
+
+template <> struct sqlinq::Table<Order> {
+  static consteval auto meta() {
+    return make_table<Order>(
+        "orders", SQLINQ_COLUMN_META(Order, id, "id").primary_key(),
+        SQLINQ_COLUMN_META(Order, status, "status").interned(),
+        SQLINQ_COLUMN_META(Order, country, "country").interned());
+  }
+};
+
+TEST(RowTableTest, InternsAnnotatedColumns) {
+  const char *statuses[] = {"new", "paid", "shipped"};
+  RowTable<Order> table;
+  for (int i = 0; i < 300; i++) {
+    table.push_back(Order{i, statuses[i % 3],
+                          i % 2 == 0 ? std::optional<std::string>{"PL"}
+                                     : std::nullopt});
+  }
+
+  EXPECT_EQ(table.arena_bytes(), 0);
+  EXPECT_EQ(table.strings().size(), 4);
+  EXPECT_EQ(table.strings().bytes(), 3 + 4 + 7 + 2);
+  EXPECT_EQ(table.id<1>(4), table.id<1>(1));
+  EXPECT_EQ(table.strings()[table.id<1>(2)], "shipped");
+  EXPECT_EQ(table[5].get<1>(), "shipped");
+  EXPECT_EQ(table[4].get<2>(), std::optional<std::string_view>{"PL"});
+  EXPECT_FALSE(table[5].get<2>().has_value());
+
+  Order order = table[7].materialize();
+  EXPECT_EQ(order.status, "paid");
+  EXPECT_FALSE(order.country.has_value());
+}
+
+namespace {
+struct Label {
+  int id;
+  std::string name;
+  std::string color;
+};
+} // namespace
+
+// Metadata does not follow the member order
+template <> struct sqlinq::Table<Label> {
+  static consteval auto meta() {
+    return make_table<Label>(
+        "labels", SQLINQ_COLUMN_META(Label, color, "color").interned(),
+        SQLINQ_COLUMN_META(Label, id, "id").primary_key(),
+        SQLINQ_COLUMN_META(Label, name, "name"));
+  }
+};
+
+TEST(RowTableTest, MatchesInternedColumnsByMember) {
+  RowTable<Label> table;
+  table.push_back(Label{1, "bug", "red"});
+  table.push_back(Label{2, "feature", "red"});
+
+  EXPECT_EQ(table.strings().size(), 1);
+  EXPECT_EQ(table.arena_bytes(), 3 + 7);
+  EXPECT_EQ(table[1].get<0>(), 2);
+  EXPECT_EQ(table[1].get<2>(), "red");
+}
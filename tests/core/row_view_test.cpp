@@ -0,0 +1,75 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string_view>
+
+#include "mock_backend.hpp"
+#include "sqlinq/cursor.hpp"
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::SaveArg;
+
+class RowViewTest : public ::testing::Test {
+protected:
+  NiceMock<MockBackend> backend_;
+  const BindData *bind_ = nullptr;
+  std::string_view rows_[2] = {"first row", ""};
+  int row_ = -1;
+
+  // Serves (id, text) rows; the text is only available as a view
+  void SetUp() override {
+    ON_CALL(backend_, bind_result(_, _)).WillByDefault(SaveArg<0>(&bind_));
+    ON_CALL(backend_, stmt_fetch()).WillByDefault([this] {
+      if (++row_ == 2) {
+        return ExecStatus::NoData;
+      }
+      *static_cast<int *>(bind_[0].buffer) = row_;
+      *bind_[1].length = rows_[row_].size();
+      return rows_[row_].empty() ? ExecStatus::Row : ExecStatus::Truncated;
+    });
+    ON_CALL(backend_, stmt_column_view(1)).WillByDefault([this](int) {
+      auto text = rows_[row_];
+      return std::span{reinterpret_cast<const std::byte *>(text.data()),
+                       text.size()};
+    });
+  }
+};
+
+TEST_F(RowViewTest, ViewsPointIntoBackendBuffer) {
+  EXPECT_CALL(backend_, stmt_fetch_column(_, _)).Times(0);
+  Cursor<std::tuple<int, TextView>> cursor{backend_};
+
+  ASSERT_TRUE(cursor.next());
+  auto &[id, text] = cursor.current();
+  EXPECT_EQ(id, 0);
+  EXPECT_EQ(text, "first row");
+  EXPECT_EQ(text.data(), rows_[0].data());
+
+  // refreshed although the backend reported nothing truncated
+  ASSERT_TRUE(cursor.next());
+  EXPECT_TRUE(std::get<1>(cursor.current()).empty());
+  EXPECT_FALSE(cursor.next());
+}
+
+TEST(RowViewTypeTest, MapsOwningColumnTypes) {
+  using row = std::tuple<int, std::string, std::optional<Blob>>;
+  static_assert(
+      std::is_same_v<row_view_t<row>,
+                     std::tuple<int, TextView, std::optional<BlobView>>>);
+  static_assert(has_row_view_v<row_view_t<row>>);
+  static_assert(!has_row_view_v<row>);
+}
+
+#ifndef NDEBUG
+TEST_F(RowViewTest, ViewUsedAfterNextAsserts) {
+  Cursor<std::tuple<int, TextView>> cursor{backend_};
+  ASSERT_TRUE(cursor.next());
+  TextView first = std::get<1>(cursor.current());
+  EXPECT_EQ(first.view(), "first row");
+  cursor.next();
+  EXPECT_DEATH(static_cast<void>(first.view()), "Row view used after");
+}
+#endif
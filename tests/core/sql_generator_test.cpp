@@ -0,0 +1,581 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "mock_backend.hpp"
+#include "sqlinq/column.hpp"
+#include "sqlinq/database.hpp"
+#include "sqlinq/sql_generator.hpp"
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::SaveArg;
+
+struct Product {
+  int id;
+  std::string sku;
+  int price;
+};
+
+template <> struct sqlinq::Table<Product> {
+  SQLINQ_COLUMN(0, Product, id)
+  SQLINQ_COLUMN(1, Product, sku)
+  SQLINQ_COLUMN(2, Product, price)
+
+  static consteval auto meta() {
+    return make_table<Product>(
+        "products",
+        SQLINQ_COLUMN_META(Product, id, "product_id")
+            .primary_key()
+            .autoincrement(),
+        SQLINQ_COLUMN_META(Product, sku, "sku").unique(),
+        SQLINQ_COLUMN_META(Product, price, "price"));
+  }
+};
+
+struct Review {
+  int id;
+  int product_id;
+  int stars;
+};
+
+template <> struct sqlinq::Table<Review> {
+  SQLINQ_COLUMN(0, Review, id)
+  SQLINQ_COLUMN(1, Review, product_id)
+  SQLINQ_COLUMN(2, Review, stars)
+
+  static consteval auto meta() {
+    return make_table<Review>(
+        "reviews",
+        SQLINQ_COLUMN_META(Review, id, "review_id").primary_key(),
+        SQLINQ_COLUMN_META(Review, product_id, "product_id").foreign_key(),
+        SQLINQ_COLUMN_META(Review, stars, "stars"));
+  }
+};
+
+struct Vote {
+  int id;
+  int review_id;
+  bool helpful;
+};
+
+template <> struct sqlinq::Table<Vote> {
+  SQLINQ_COLUMN(0, Vote, id)
+  SQLINQ_COLUMN(1, Vote, review_id)
+  SQLINQ_COLUMN(2, Vote, helpful)
+
+  static consteval auto meta() {
+    return make_table<Vote>(
+        "votes", SQLINQ_COLUMN_META(Vote, id, "vote_id").primary_key(),
+        SQLINQ_COLUMN_META(Vote, review_id, "review_id").foreign_key(),
+        SQLINQ_COLUMN_META(Vote, helpful, "helpful"));
+  }
+};
+
+static QueryAst upsert_ast() {
+  QueryAst ast;
+  ast.op = QueryAst::Operation::Upsert;
+  ast.table_name = "products";
+  ast.column_names = {"product_id", "sku", "price"};
+  ast.conflict_columns = {"product_id"};
+  return ast;
+}
+
+TEST(SqlGeneratorTest, BuildUpsertSQLite) {
+  EXPECT_EQ(SqlGenerator::build_upsert(upsert_ast(), SqlDialect::SQLite),
+            "INSERT INTO products(product_id,sku,price) VALUES(?,?,?) "
+            "ON CONFLICT(product_id) DO UPDATE SET "
+            "sku = excluded.sku, price = excluded.price");
+}
+
+TEST(SqlGeneratorTest, BuildUpsertMySQL) {
+  EXPECT_EQ(SqlGenerator::build_upsert(upsert_ast(), SqlDialect::MySQL),
+            "INSERT INTO products(product_id,sku,price) VALUES(?,?,?) "
+            "ON DUPLICATE KEY UPDATE sku = VALUES(sku), price = VALUES(price)");
+}
+
+TEST(SqlGeneratorTest, BuildUpsertMultiRow) {
+  std::string sql =
+      SqlGenerator::build_upsert(upsert_ast(), SqlDialect::SQLite, 3);
+  EXPECT_NE(sql.find("VALUES(?,?,?),(?,?,?),(?,?,?) ON CONFLICT"),
+            std::string::npos);
+}
+
+TEST(SqlGeneratorTest, BuildUpsertWithoutUpdates) {
+  QueryAst ast;
+  ast.table_name = "products";
+  ast.column_names = {"sku"};
+  ast.conflict_columns = {"sku"};
+  EXPECT_EQ(SqlGenerator::build_upsert(ast, SqlDialect::SQLite),
+            "INSERT INTO products(sku) VALUES(?) ON CONFLICT(sku) DO NOTHING");
+  EXPECT_EQ(SqlGenerator::build_upsert(ast, SqlDialect::MySQL),
+            "INSERT INTO products(sku) VALUES(?) "
+            "ON DUPLICATE KEY UPDATE sku = sku");
+}
+
+class UpsertQueryTest : public ::testing::Test {
+protected:
+  NiceMock<MockBackend> backend_;
+  std::string sql_;
+
+  void SetUp() override {
+    ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::SQLite));
+    ON_CALL(backend_, stmt_prepare(_))
+        .WillByDefault([this](std::string_view sql) { sql_ = sql; });
+  }
+};
+
+TEST_F(UpsertQueryTest, ConflictTargetIsPrimaryKeyWhenSet) {
+  Database db{backend_};
+  auto q = Query<Product>().upsert([](auto &p) {
+    p.id = 7;
+    p.sku = "A-1";
+    p.price = 10;
+  });
+  db.execute(q);
+  EXPECT_EQ(sql_, "INSERT INTO products(product_id,sku,price) VALUES(?,?,?) "
+                  "ON CONFLICT(product_id) DO UPDATE SET "
+                  "sku = excluded.sku, price = excluded.price");
+}
+
+TEST_F(UpsertQueryTest, ConflictTargetFallsBackToUniqueColumn) {
+  Database db{backend_};
+  auto q = Query<Product>().upsert([](auto &p) {
+    p.sku = "A-1";
+    p.price = 10;
+  });
+  db.execute(q);
+  EXPECT_EQ(sql_, "INSERT INTO products(sku,price) VALUES(?,?) "
+                  "ON CONFLICT(sku) DO UPDATE SET price = excluded.price");
+}
+
+TEST_F(UpsertQueryTest, RequiresKeyColumn) {
+  EXPECT_THROW(Query<Product>().upsert([](auto &p) { p.price = 10; }),
+               std::invalid_argument);
+}
+
+TEST_F(UpsertQueryTest, SaveNewEntityInserts) {
+  Database db{backend_};
+  EXPECT_CALL(backend_, last_inserted_rowid()).WillOnce(Return(3));
+  Product p{.id = 0, .sku = "B-2", .price = 5};
+  db.save(p);
+  EXPECT_EQ(sql_, "INSERT INTO products(sku,price) VALUES(?,?)");
+  EXPECT_EQ(p.id, 3);
+}
+
+TEST_F(UpsertQueryTest, SaveExistingEntityUpserts) {
+  Database db{backend_};
+  ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::MySQL));
+  std::vector<Product> products{{1, "A", 1}, {2, "B", 2}};
+  std::size_t params = 0;
+  EXPECT_CALL(backend_, bind_params(_))
+      .WillOnce([&](std::span<BoundValue> p) { params = p.size(); });
+  db.save(std::span{products});
+  EXPECT_EQ(sql_, "INSERT INTO products(product_id,sku,price) "
+                  "VALUES(?,?,?),(?,?,?) ON DUPLICATE KEY UPDATE "
+                  "sku = VALUES(sku), price = VALUES(price)");
+  EXPECT_EQ(params, 6);
+}
+
+TEST_F(UpsertQueryTest, SaveBatchesNewAndExistingEntities) {
+  Database db{backend_};
+  ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::MySQL));
+  std::vector<std::string> statements;
+  ON_CALL(backend_, stmt_prepare(_))
+      .WillByDefault(
+          [&](std::string_view sql) { statements.emplace_back(sql); });
+  std::vector<std::size_t> params;
+  ON_CALL(backend_, bind_params(_))
+      .WillByDefault(
+          [&](std::span<BoundValue> p) { params.push_back(p.size()); });
+  EXPECT_CALL(backend_, last_inserted_rowid())
+      .WillOnce(Return(7))
+      .WillOnce(Return(8));
+
+  std::vector<Product> products{
+      {0, "N-1", 1}, {4, "E-4", 4}, {0, "N-2", 2}, {5, "E-5", 5}};
+  db.save(std::span{products});
+  ASSERT_EQ(statements.size(), 2);
+  EXPECT_EQ(statements[0], "INSERT INTO products(sku,price) VALUES(?,?)");
+  EXPECT_EQ(statements[1], "INSERT INTO products(product_id,sku,price) "
+                           "VALUES(?,?,?),(?,?,?) ON DUPLICATE KEY UPDATE "
+                           "sku = VALUES(sku), price = VALUES(price)");
+  EXPECT_EQ(params, (std::vector<std::size_t>{2, 2, 6}));
+  EXPECT_EQ(products[0].id, 7);
+  EXPECT_EQ(products[2].id, 8);
+}
+
+class ReturningFallbackTest : public UpsertQueryTest {
+protected:
+  std::vector<std::string> statements_;
+
+  void SetUp() override {
+    UpsertQueryTest::SetUp();
+    ON_CALL(backend_, supports_returning(_)).WillByDefault(Return(false));
+    ON_CALL(backend_, stmt_prepare(_))
+        .WillByDefault([this](std::string_view sql) {
+          statements_.emplace_back(sql);
+        });
+  }
+};
+
+TEST_F(ReturningFallbackTest, InsertSelectsByGeneratedKey) {
+  Database db{backend_};
+  EXPECT_CALL(backend_, last_inserted_rowid()).WillOnce(Return(4));
+  auto q = Query<Product>()
+               .insert([](auto &p) {
+                 p.sku = "C-3";
+                 p.price = 8;
+               })
+               .returning();
+  {
+    auto cursor = db.execute(q);
+  }
+  ASSERT_EQ(statements_.size(), 2);
+  EXPECT_EQ(statements_[0], "INSERT INTO products(sku,price) VALUES(?,?)");
+  EXPECT_EQ(statements_[1], "SELECT product_id, sku, price FROM products "
+                            "WHERE product_id = ?");
+}
+
+TEST_F(ReturningFallbackTest, UpdateSelectsLockedKeys) {
+  Database db{backend_};
+  ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::MySQL));
+  const BindData *bind = nullptr;
+  ON_CALL(backend_, bind_result(_, _)).WillByDefault(SaveArg<0>(&bind));
+  bool fetched = false;
+  ON_CALL(backend_, stmt_fetch()).WillByDefault([&] {
+    if (fetched || statements_.back().find("FOR UPDATE") == std::string::npos) {
+      return ExecStatus::NoData;
+    }
+    fetched = true;
+    *static_cast<int *>(bind[0].buffer) = 4;
+    return ExecStatus::Row;
+  });
+  std::vector<std::size_t> params;
+  ON_CALL(backend_, bind_params(_))
+      .WillByDefault(
+          [&](std::span<BoundValue> p) { params.push_back(p.size()); });
+
+  // the filtered column is the one being set
+  auto q = Query<Product>()
+               .update([](auto &p) { p.sku = "C-4"; })
+               .where([](auto p) { return p.sku == "C-3"; })
+               .returning();
+  {
+    auto cursor = db.execute(q);
+  }
+  ASSERT_EQ(statements_.size(), 5);
+  EXPECT_EQ(statements_[0], "START TRANSACTION");
+  EXPECT_EQ(statements_[1],
+            "SELECT product_id FROM products WHERE sku = ? FOR UPDATE");
+  EXPECT_EQ(statements_[2], "UPDATE products SET sku = ? WHERE sku = ?");
+  EXPECT_EQ(statements_[3], "COMMIT");
+  EXPECT_EQ(statements_[4], "SELECT product_id, sku, price FROM products "
+                            "WHERE product_id IN (?)");
+  EXPECT_EQ(params, (std::vector<std::size_t>{0, 1, 2, 0, 1}));
+}
+
+TEST_F(ReturningFallbackTest, UpdateReadsRowsBeforeCommit) {
+  Database db{backend_};
+  auto q = Query<Product>()
+               .update([](auto &p) { p.price = 9; })
+               .where([](auto p) { return p.sku == "C-3"; })
+               .returning();
+  auto rows = db.to_vector(q);
+  EXPECT_TRUE(rows.empty());
+  ASSERT_EQ(statements_.size(), 5);
+  EXPECT_EQ(statements_[0], "BEGIN IMMEDIATE");
+  EXPECT_EQ(statements_[1], "SELECT product_id FROM products WHERE sku = ?");
+  EXPECT_EQ(statements_[2], "UPDATE products SET price = ? WHERE sku = ?");
+  EXPECT_EQ(statements_[3], "SELECT product_id, sku, price FROM products "
+                            "WHERE product_id IN (NULL)");
+  EXPECT_EQ(statements_[4], "COMMIT");
+}
+
+TEST_F(ReturningFallbackTest, DeleteReadsRowsFirst) {
+  Database db{backend_};
+  auto q = Query<Product>()
+               .remove()
+               .where([](auto p) { return p.price > 100; })
+               .returning();
+  EXPECT_THROW((void)db.execute(q), std::runtime_error);
+
+  statements_.clear();
+  auto rows = db.to_vector(q);
+  ASSERT_EQ(statements_.size(), 4);
+  EXPECT_EQ(statements_[0], "BEGIN IMMEDIATE");
+  EXPECT_EQ(statements_[1],
+            "SELECT product_id, sku, price FROM products WHERE price > ?");
+  EXPECT_EQ(statements_[2], "DELETE FROM products WHERE price > ?");
+  EXPECT_EQ(statements_[3], "COMMIT");
+}
+
+TEST_F(ReturningFallbackTest, DeleteLocksRowsAndRollsBackOnError) {
+  Database db{backend_};
+  ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::MySQL));
+  ON_CALL(backend_, stmt_execute()).WillByDefault([this] {
+    if (statements_.back().starts_with("DELETE")) {
+      throw std::runtime_error("Lock wait timeout exceeded");
+    }
+    return ExecStatus::Ok;
+  });
+  auto q = Query<Product>()
+               .remove()
+               .where([](auto p) { return p.price > 100; })
+               .returning();
+  EXPECT_THROW((void)db.to_vector(q), std::runtime_error);
+  ASSERT_EQ(statements_.size(), 4);
+  EXPECT_EQ(statements_[0], "START TRANSACTION");
+  EXPECT_EQ(statements_[1], "SELECT product_id, sku, price FROM products "
+                            "WHERE price > ? FOR UPDATE");
+  EXPECT_EQ(statements_[3], "ROLLBACK");
+}
+
+TEST_F(ReturningFallbackTest, NativeReturningAppendsClause) {
+  Database db{backend_};
+  ON_CALL(backend_, supports_returning(_)).WillByDefault(Return(true));
+  auto q = Query<Product>()
+               .remove()
+               .where([](auto p) { return p.price > 100; })
+               .returning();
+  {
+    auto cursor = db.execute(q);
+  }
+  ASSERT_EQ(statements_.size(), 1);
+  EXPECT_EQ(statements_[0], "DELETE FROM products WHERE price > ? "
+                            "RETURNING product_id, sku, price");
+}
+
+TEST(SqlGeneratorTest, InConditionBindsEveryValue) {
+  ValueCondition cond{ValueCondition::Operator::In, BoundValue{}, 0};
+  cond.column_name = "product_id";
+  for (int id : {3, 1, 2}) {
+    cond.list.emplace_back(id);
+  }
+  QueryAst ast;
+  ast.table_name = "reviews";
+  ast.filter_chain = FilterChain{FilterExpr::Kind::Leaf, std::move(cond)};
+  FilterChain copy = ast.filter_chain.clone();
+  EXPECT_EQ(SqlGenerator::build_select(ast),
+            "SELECT * FROM reviews WHERE product_id IN (?,?,?)");
+  EXPECT_EQ(copy.extract_values().size(), 3);
+
+  ast.filter_chain.front().condition.list.clear();
+  EXPECT_EQ(SqlGenerator::build_select(ast),
+            "SELECT * FROM reviews WHERE product_id IN (NULL)");
+}
+
+class SelectQueryTest : public ::testing::Test {
+protected:
+  NiceMock<MockBackend> backend_;
+  std::string sql_;
+
+  void SetUp() override {
+    ON_CALL(backend_, dialect()).WillByDefault(Return(SqlDialect::SQLite));
+    ON_CALL(backend_, stmt_prepare(_))
+        .WillByDefault([this](std::string_view sql) { sql_ = sql; });
+  }
+};
+
+TEST_F(SelectQueryTest, FetchStrategyIsPassedToBackend) {
+  Database db{backend_};
+  FetchStrategy strategy;
+  EXPECT_CALL(backend_, stmt_fetch_strategy(_))
+      .WillOnce(SaveArg<0>(&strategy))
+      .WillOnce(SaveArg<0>(&strategy));
+
+  auto q = Query<Product>().select_all().fetch_strategy(
+      FetchStrategy::server_cursor(500));
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(strategy.mode, FetchStrategy::Mode::ServerCursor);
+  EXPECT_EQ(strategy.prefetch_rows, 500);
+
+  (void)db.find<Product>(1);
+  EXPECT_EQ(strategy.mode, FetchStrategy::Mode::Buffered);
+}
+
+TEST_F(SelectQueryTest, JoinQualifiesColumns) {
+  Database db{backend_};
+  auto q = Query<Product>()
+               .join<Review>(&Review::product_id)
+               .where([](auto p) { return p.price > 10; })
+               .order_by(&Product::sku);
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT products.product_id, products.sku, products.price, "
+                  "reviews.review_id, reviews.product_id, reviews.stars "
+                  "FROM products INNER JOIN reviews "
+                  "ON products.product_id = reviews.product_id "
+                  "WHERE products.price > ? ORDER BY products.sku");
+}
+
+TEST_F(SelectQueryTest, LeftJoinFromChildToParent) {
+  Database db{backend_};
+  auto q = Query<Review>().left_join<Product>(&Review::product_id).fetch(5);
+  static_assert(std::is_same_v<decltype(db.to_vector(q))::value_type,
+                               std::tuple<Review, std::optional<Product>>>);
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT reviews.review_id, reviews.product_id, "
+                  "reviews.stars, products.product_id, products.sku, "
+                  "products.price FROM reviews LEFT JOIN products "
+                  "ON reviews.product_id = products.product_id LIMIT 5");
+}
+
+TEST_F(SelectQueryTest, ChainedJoinNamesReferencedEntity) {
+  Database db{backend_};
+  auto q = Query<Product>()
+               .join<Review>(&Review::product_id)
+               .left_join<Vote, Review>(&Vote::review_id);
+  static_assert(
+      std::is_same_v<decltype(db.to_vector(q))::value_type,
+                     std::tuple<Product, Review, std::optional<Vote>>>);
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT products.product_id, products.sku, products.price, "
+                  "reviews.review_id, reviews.product_id, reviews.stars, "
+                  "votes.vote_id, votes.review_id, votes.helpful "
+                  "FROM products INNER JOIN reviews "
+                  "ON products.product_id = reviews.product_id "
+                  "LEFT JOIN votes ON reviews.review_id = votes.review_id");
+}
+
+TEST_F(SelectQueryTest, JoinRequiresForeignKey) {
+  EXPECT_THROW(Query<Product>().join<Review>(&Review::stars),
+               std::invalid_argument);
+}
+
+TEST_F(SelectQueryTest, IncludeRequiresForeignKey) {
+  Database db{backend_};
+  auto q = Query<Product>().select_all();
+  EXPECT_THROW(db.load(q).include(&Review::stars), std::invalid_argument);
+  EXPECT_NO_THROW(db.load(q).include(&Review::product_id));
+}
+
+TEST_F(SelectQueryTest, IncludeBatchesKeysPerStatement) {
+  Database db{backend_};
+  std::vector<std::string> statements;
+  ON_CALL(backend_, stmt_prepare(_))
+      .WillByDefault(
+          [&](std::string_view sql) { statements.emplace_back(sql); });
+  std::vector<std::size_t> params;
+  ON_CALL(backend_, bind_params(_))
+      .WillByDefault(
+          [&](std::span<BoundValue> p) { params.push_back(p.size()); });
+  const BindData *bind = nullptr;
+  ON_CALL(backend_, bind_result(_, _)).WillByDefault(SaveArg<0>(&bind));
+
+  // 1000 products, then one review of the first and last product
+  constexpr int products = 1000;
+  int row = 0;
+  ON_CALL(backend_, stmt_fetch()).WillByDefault([&] {
+    bool reviews = statements.size() > 1;
+    if (row == (reviews ? 1 : products)) {
+      row = 0;
+      return ExecStatus::NoData;
+    }
+    row++;
+    if (reviews) {
+      int product = statements.size() == 2 ? 1 : products;
+      *static_cast<int *>(bind[0].buffer) = product;
+      *static_cast<int *>(bind[1].buffer) = product;
+    } else {
+      *static_cast<int *>(bind[0].buffer) = row;
+    }
+    return ExecStatus::Row;
+  });
+
+  auto q = Query<Product>().select_all();
+  auto rows = db.load(q).include(&Review::product_id).to_vector();
+  ASSERT_EQ(statements.size(), 3);
+  EXPECT_TRUE(statements[1].starts_with(
+      "SELECT review_id, product_id, stars FROM reviews "
+      "WHERE product_id IN (?,"));
+  EXPECT_EQ(params, (std::vector<std::size_t>{0, 999, 1}));
+
+  ASSERT_EQ(rows.size(), products);
+  ASSERT_EQ(std::get<1>(rows.front()).size(), 1);
+  EXPECT_EQ(std::get<1>(rows.front())[0].id, 1);
+  ASSERT_EQ(std::get<1>(rows.back()).size(), 1);
+  EXPECT_EQ(std::get<1>(rows.back())[0].product_id, products);
+  EXPECT_TRUE(std::get<1>(rows[1]).empty());
+}
+
+TEST_F(SelectQueryTest, MultipleAggregatesWithGroupByAndHaving) {
+  Database db{backend_};
+  auto q = Query<Review>()
+               .select(&Review::product_id, count(), max(&Review::stars),
+                       avg(&Review::stars))
+               .where([](auto r) { return r.stars > 0; })
+               .group_by(&Review::product_id)
+               .having(count() > 1 && avg(&Review::stars) >= 3.5)
+               .order_by(&Review::product_id);
+  static_assert(std::is_same_v<decltype(db.to_vector(q))::value_type,
+                               std::tuple<int, int, int, double>>);
+  std::size_t params = 0;
+  EXPECT_CALL(backend_, bind_params(_))
+      .WillOnce([&](std::span<BoundValue> values) { params = values.size(); });
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT product_id, COUNT(*), MAX(stars), AVG(stars) "
+                  "FROM reviews WHERE stars > ? GROUP BY product_id "
+                  "HAVING COUNT(*) > ? AND AVG(stars) >= ? "
+                  "ORDER BY product_id");
+  EXPECT_EQ(params, 3);
+}
+
+TEST_F(SelectQueryTest, WindowFunctions) {
+  Database db{backend_};
+  auto q = Query<Review>()
+               .select(&Review::id,
+                       rank().partition_by(&Review::product_id)
+                           .order_by_desc(&Review::stars),
+                       lag(&Review::stars, 2).order_by(&Review::id),
+                       sum(&Review::stars)
+                           .partition_by(&Review::product_id)
+                           .order_by(&Review::id),
+                       row_number())
+               .fetch(10);
+  static_assert(
+      std::is_same_v<decltype(db.to_vector(q))::value_type,
+                     std::tuple<int, int64_t, std::optional<int>, int64_t,
+                                int64_t>>);
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT review_id, "
+                  "RANK() OVER (PARTITION BY product_id ORDER BY stars DESC), "
+                  "LAG(stars, 2) OVER (ORDER BY review_id), "
+                  "SUM(stars) OVER (PARTITION BY product_id ORDER BY "
+                  "review_id ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT "
+                  "ROW), ROW_NUMBER() OVER () FROM reviews LIMIT 10");
+}
+
+TEST_F(SelectQueryTest, QualifyWrapsSelectInDerivedTable) {
+  Database db{backend_};
+  std::size_t params = 0;
+  EXPECT_CALL(backend_, bind_params(_))
+      .WillOnce([&](std::span<BoundValue> values) { params = values.size(); });
+  auto q = Query<Review>()
+               .select_all()
+               .where([](auto r) { return r.stars > 1; })
+               .qualify(row_number()
+                            .partition_by(&Review::product_id)
+                            .order_by_desc(&Review::stars) <= 3)
+               .order_by(&Review::product_id);
+  {
+    auto cursor = db.execute(q);
+  }
+  EXPECT_EQ(sql_, "SELECT review_id, product_id, stars FROM (SELECT "
+                  "review_id, product_id, stars, ROW_NUMBER() OVER "
+                  "(PARTITION BY product_id ORDER BY stars DESC) AS w0 "
+                  "FROM reviews WHERE stars > ?) AS windowed "
+                  "WHERE w0 <= ? ORDER BY product_id");
+  EXPECT_EQ(params, 2);
+}
@@ -0,0 +1,125 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "mock_backend.hpp"
+#include "sqlinq/column.hpp"
+#include "sqlinq/database.hpp"
+#include "sqlinq/tracked.hpp"
+
+using ::testing::_;
+using ::testing::NiceMock;
+
+struct Article {
+  int id;
+  std::string title;
+  std::string body;
+  std::optional<Time> read_time;
+};
+
+template <> struct sqlinq::Table<Article> {
+  SQLINQ_COLUMN(0, Article, id)
+  SQLINQ_COLUMN(1, Article, title)
+  SQLINQ_COLUMN(2, Article, body)
+  SQLINQ_COLUMN(3, Article, read_time)
+
+  static consteval auto meta() {
+    return make_table<Article>(
+        "articles",
+        SQLINQ_COLUMN_META(Article, id, "article_id")
+            .primary_key()
+            .autoincrement(),
+        SQLINQ_COLUMN_META(Article, title, "title"),
+        SQLINQ_COLUMN_META(Article, body, "body"),
+        SQLINQ_COLUMN_META(Article, read_time, "read_time"));
+  }
+};
+
+struct Badge {
+  int id;
+  std::string name;
+  int level;
+};
+
+// Metadata does not follow the member order
+template <> struct sqlinq::Table<Badge> {
+  static consteval auto meta() {
+    return make_table<Badge>(
+        "badges", SQLINQ_COLUMN_META(Badge, level, "level"),
+        SQLINQ_COLUMN_META(Badge, id, "badge_id").primary_key(),
+        SQLINQ_COLUMN_META(Badge, name, "name"));
+  }
+};
+
+class TrackedTest : public ::testing::Test {
+protected:
+  NiceMock<MockBackend> backend_;
+  std::vector<std::string> statements_;
+  Tracked<Article> article_{Article{1, "Title", std::string(4096, 'x'), {}}};
+
+  void SetUp() override {
+    ON_CALL(backend_, stmt_prepare(_))
+        .WillByDefault([this](std::string_view sql) {
+          statements_.emplace_back(sql);
+        });
+  }
+};
+
+TEST_F(TrackedTest, DetectsChangedColumns) {
+  EXPECT_FALSE(article_.is_dirty());
+  article_->title = "Other";
+  article_->read_time = Time{std::chrono::minutes{5}};
+  EXPECT_EQ(article_.changed_columns(), (std::vector<std::size_t>{1, 3}));
+
+  article_.reset();
+  EXPECT_FALSE(article_.is_dirty());
+}
+
+TEST_F(TrackedTest, UpdateWritesOnlyChangedColumns) {
+  Database db{backend_};
+  article_->title = "Other";
+  std::size_t params = 0;
+  EXPECT_CALL(backend_, bind_params(_))
+      .WillOnce([&](std::span<BoundValue> p) { params = p.size(); });
+  EXPECT_TRUE(db.update(article_));
+  ASSERT_EQ(statements_.size(), 1);
+  EXPECT_EQ(statements_[0], "UPDATE articles SET title = ? WHERE article_id = ?");
+  EXPECT_EQ(params, 2);
+  EXPECT_FALSE(article_.is_dirty());
+}
+
+TEST_F(TrackedTest, UpdateWithoutChangesSkipsStatement) {
+  Database db{backend_};
+  EXPECT_CALL(backend_, stmt_prepare(_)).Times(0);
+  EXPECT_FALSE(db.update(article_));
+}
+
+TEST_F(TrackedTest, PrimaryKeyChangeIsIgnored) {
+  Database db{backend_};
+  std::vector<int> keys;
+  ON_CALL(backend_, bind_params(_))
+      .WillByDefault([&](std::span<BoundValue> p) {
+        keys.push_back(*static_cast<const int *>(p.back().ptr()));
+      });
+  article_->id = 2;
+  EXPECT_FALSE(db.update(article_));
+  article_->body = "short";
+  EXPECT_TRUE(db.update(article_));
+  EXPECT_EQ(article_->id, 1);
+  article_->title = "Other";
+  EXPECT_TRUE(db.update(article_));
+
+  ASSERT_EQ(statements_.size(), 2);
+  EXPECT_EQ(statements_[0], "UPDATE articles SET body = ? WHERE article_id = ?");
+  EXPECT_EQ(statements_[1], "UPDATE articles SET title = ? WHERE article_id = ?");
+  EXPECT_EQ(keys, (std::vector<int>{1, 1}));
+}
+
+TEST_F(TrackedTest, MatchesColumnsByMember) {
+  Database db{backend_};
+  Tracked<Badge> badge{Badge{1, "gold", 3}};
+  badge->level = 4;
+  EXPECT_EQ(badge.changed_columns(), (std::vector<std::size_t>{0}));
+  EXPECT_TRUE(db.update(badge));
+  ASSERT_EQ(statements_.size(), 1);
+  EXPECT_EQ(statements_[0], "UPDATE badges SET level = ? WHERE badge_id = ?");
+}
@@ -1,5 +1,6 @@
 #include "sqlinq/types/datetime.hpp"
 #include <gtest/gtest.h>
+#include <sstream>
 
 #ifdef _WIN32
 #define timegm _mkgmtime
@@ -94,3 +95,92 @@ TEST(TimestampConversion, FromStringInvalidFormat) {
   Timestamp ts;
   EXPECT_FALSE(from_string("abc", ts));
 }
+
+TEST(DatetimeChars, WritesFixedWidthFields) {
+  char buf[details::DatetimeTraits::max_str_length];
+  Date d{std::chrono::year{7}, std::chrono::month{1}, std::chrono::day{2}};
+  auto [ptr, ec] = details::to_chars(buf, buf + sizeof(buf), d);
+  ASSERT_EQ(ec, std::errc{});
+  EXPECT_EQ(std::string_view(buf, ptr), "0007-01-02");
+
+  Datetime dt = std::chrono::sys_days{Date{std::chrono::year{1969},
+                                           std::chrono::month{12},
+                                           std::chrono::day{31}}} +
+                std::chrono::hours{23} + std::chrono::seconds{59} +
+                std::chrono::milliseconds{500};
+  auto res = details::to_chars(buf, buf + sizeof(buf), dt);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(std::string_view(buf, res.ptr), "1969-12-31 23:00:59");
+
+  Time t{std::chrono::hours{123} + std::chrono::minutes{4}};
+  EXPECT_EQ(to_string(t), "123:04:00");
+}
+
+TEST(DatetimeChars, ReportsShortBuffer) {
+  char buf[18];
+  Datetime dt = std::chrono::sys_days{Date{std::chrono::year{2024},
+                                           std::chrono::month{2},
+                                           std::chrono::day{29}}};
+  auto [ptr, ec] = details::to_chars(buf, buf + sizeof(buf), dt);
+  EXPECT_EQ(ec, std::errc::value_too_large);
+  EXPECT_EQ(ptr, buf + sizeof(buf));
+}
+
+TEST(DatetimeChars, ParsesPrefixWithoutTerminator) {
+  const char text[] = {'2', '0', '2', '4', '-', '0', '2', '-', '2', '9',
+                       ' ', '0', '8', ':', '1', '5', ':', '3', '0', 'Z'};
+  Datetime dt;
+  auto [ptr, ec] = details::from_chars(text, text + sizeof(text), dt);
+  ASSERT_EQ(ec, std::errc{});
+  EXPECT_EQ(ptr, text + 19);
+  EXPECT_EQ(to_string(dt), "2024-02-29 08:15:30");
+
+  Date d;
+  auto res = details::from_chars(text, text + 9, d);
+  EXPECT_EQ(res.ec, std::errc::invalid_argument);
+  EXPECT_EQ(res.ptr, text);
+}
+
+TEST(DatetimeChars, RejectsMalformedFields) {
+  Date d;
+  Time t;
+  Datetime dt;
+  EXPECT_FALSE(from_string("2023/12/31", d));
+  EXPECT_FALSE(from_string("2023-1a-31", d));
+  EXPECT_FALSE(from_string("2023-12-31x", d));
+  EXPECT_FALSE(from_string("12:60:00", t));
+  EXPECT_FALSE(from_string("12:00:0", t));
+  EXPECT_FALSE(from_string("-", t));
+  EXPECT_FALSE(from_string("--01:00:00", t));
+  EXPECT_FALSE(from_string("838:60:00", t));
+  EXPECT_FALSE(from_string("100:00:99", t));
+  EXPECT_FALSE(from_string("2023-12-31T10:00:00", dt));
+  EXPECT_FALSE(from_string("2023-12-31 24:00:00", dt));
+
+  ASSERT_TRUE(from_string("838:59:59", t));
+  EXPECT_EQ(t.hours().count(), 838);
+  EXPECT_EQ(t.seconds().count(), 59);
+}
+
+TEST(DatetimeChars, NegativeTimeRoundTrips) {
+  using namespace std::chrono;
+  for (Time time : {Time{-seconds{3725}}, Time{-(hours{838} + minutes{59})}}) {
+    std::string text = to_string(time);
+    EXPECT_EQ(text.front(), '-');
+    Time parsed;
+    ASSERT_TRUE(from_string(text, parsed)) << text;
+    EXPECT_EQ(parsed.to_duration(), time.to_duration());
+  }
+  Time t;
+  ASSERT_TRUE(from_string("-1:00:00", t));
+  EXPECT_TRUE(t.is_negative());
+  EXPECT_EQ(t.hours().count(), 1);
+}
+
+TEST(DatetimeChars, StreamsWithoutTemporaries) {
+  std::ostringstream os;
+  os << Date{std::chrono::year{2023}, std::chrono::month{3},
+             std::chrono::day{4}}
+     << ' ' << Time{std::chrono::seconds{3725}};
+  EXPECT_EQ(os.str(), "2023-03-04 01:02:05");
+}
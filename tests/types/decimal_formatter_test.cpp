@@ -1,5 +1,6 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <string>
 
 #include "sqlinq/types/decimal.hpp"
 
@@ -121,3 +122,50 @@ TEST_F(DecimalFormatterTest, NaNValue) {
   EXPECT_EQ(ptr, &buf_[3]);
   EXPECT_STREQ("NaN", buf_);
 }
+
+TEST_F(DecimalFormatterTest, FullPrecision) {
+  value_type v = -999999999999999999;
+  auto [ptr, ec] = details::to_chars(first_, last_, v, 17);
+  ASSERT_EQ(ec, std::errc{});
+  EXPECT_EQ(ptr, &buf_[20]);
+  EXPECT_EQ(std::string_view(first_, ptr), "-9.99999999999999999");
+}
+
+TEST_F(DecimalFormatterTest, RejectsShortBuffer) {
+  value_type v = 12345;
+  auto [ptr, ec] = details::to_chars(first_, first_ + 5, v, 2);
+  EXPECT_EQ(ec, std::errc::invalid_argument);
+  EXPECT_EQ(ptr, first_);
+}
+
+#ifdef SQLINQ_HAS_INT128
+TEST(DecimalWideFormatterTest, FormatsAcrossChunks) {
+  using Traits = details::WideDecimalTraits;
+  char buf[Traits::max_str_length + 1] = {};
+  Traits::value_type v = Traits::power_of_10(37) * 9 + 5;
+  auto res = details::to_chars(buf, buf + sizeof(buf), v, 20);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(std::string(buf, res.ptr),
+            "900000000000000000.00000000000000000005");
+
+  res = details::to_chars(buf, buf + sizeof(buf), -v, 37);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(std::string(buf, res.ptr),
+            "-9.0000000000000000000000000000000000005");
+
+  res = details::to_chars(buf, buf + sizeof(buf), Traits::nan_sentinel, 2);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(std::string(buf, res.ptr), "NaN");
+}
+
+TEST(DecimalWideFormatterTest, SmallValuesMatchNarrowPath) {
+  char narrow[32];
+  char wide[48];
+  for (int64_t v : {0LL, 7LL, -42LL, 123456789LL, -999999999999999999LL}) {
+    auto n = details::to_chars(narrow, narrow + sizeof(narrow), v, 4);
+    auto w = details::to_chars(wide, wide + sizeof(wide),
+                               details::WideDecimalTraits::value_type{v}, 4);
+    EXPECT_EQ(std::string(narrow, n.ptr), std::string(wide, w.ptr));
+  }
+}
+#endif
@@ -206,3 +206,52 @@ TEST(DecimalParserTest, AcceptsExactlyFittingFraction) {
   EXPECT_EQ(res.ptr, end);
   EXPECT_EQ(value, 234);
 }
+
+TEST(DecimalParserTest, ParsesLongDigitRuns) {
+  details::DecimalTraits::value_type value;
+  std::string_view sv = "-1234567890123456.78";
+  auto res = details::from_chars(sv.data(), sv.data() + sv.size(), value, 2);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(res.ptr, sv.data() + sv.size());
+  EXPECT_EQ(value, -123456789012345678);
+
+  sv = "0.123456789";
+  res = details::from_chars(sv.data(), sv.data() + sv.size(), value, 10);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(value, 1234567890);
+}
+
+TEST(DecimalParserTest, RejectsMoreDigitsThanPrecision) {
+  details::DecimalTraits::value_type value;
+  std::string_view sv = "12345678901234567.5";
+  auto res = details::from_chars(sv.data(), sv.data() + sv.size(), value, 2);
+  ASSERT_EQ(res.ec, std::errc::result_out_of_range);
+  EXPECT_EQ(res.ptr, &sv[16]);
+}
+
+TEST(DecimalParserTest, StopsAtTerminator) {
+  details::DecimalTraits::value_type value;
+  const char text[] = "98.7\0garbage";
+  auto res = details::from_chars(text, text + sizeof(text), value, 2);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(res.ptr, &text[4]);
+  EXPECT_EQ(value, 9870);
+}
+
+#ifdef SQLINQ_HAS_INT128
+TEST(DecimalParserTest, ParsesWideValues) {
+  using Traits = details::WideDecimalTraits;
+  Traits::value_type value;
+  std::string_view sv = "-12345678901234567890123456789.012345678";
+  auto res = details::from_chars(sv.data(), sv.data() + sv.size(), value, 9);
+  ASSERT_EQ(res.ec, std::errc{});
+  EXPECT_EQ(res.ptr, sv.data() + sv.size());
+  EXPECT_TRUE(value == -(Traits::value_type{1234567890123456789} *
+                             Traits::power_of_10(19) +
+                         123456789012345678));
+
+  sv = "123456789012345678901234567890.5";
+  res = details::from_chars(sv.data(), sv.data() + sv.size(), value, 9);
+  EXPECT_EQ(res.ec, std::errc::result_out_of_range);
+}
+#endif
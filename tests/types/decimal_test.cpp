@@ -69,3 +69,24 @@ TEST(DecimalTest, HandlesZeroProperly) {
 /*  EXPECT_TRUE((decimal_cast<6, 3>(c)) < b);*/
 /*  EXPECT_TRUE(b > (decimal_cast<6, 3>(c)));*/
 /*}*/
+
+#ifdef SQLINQ_HAS_INT128
+TEST(DecimalTest, WidePrecisionRoundTrip) {
+  using Wide = Decimal<38, 10>;
+  static_assert(std::is_same_v<Wide::value_type, details::int128_t>);
+
+  Wide d("-1234567890123456789012345678.0123456789");
+  ASSERT_FALSE(d.is_nan());
+  EXPECT_EQ(to_string(d), "-1234567890123456789012345678.0123456789");
+  EXPECT_EQ(to_string(Wide::max()),
+            "9999999999999999999999999999.9999999999");
+  EXPECT_TRUE(Wide("1.5") < Wide("10"));
+  EXPECT_TRUE(Wide(7) == Wide("7.0"));
+}
+
+TEST(DecimalTest, WidePrecisionRejectsOverflow) {
+  Decimal<38, 2> d("1234567890123456789012345678901234567.01");
+  EXPECT_TRUE(d.is_nan());
+  EXPECT_EQ(to_string(d), "NaN");
+}
+#endif
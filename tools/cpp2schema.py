@@ -50,6 +50,14 @@ def parse_attributes(attr_node, source_code: bytes):
     return attributes
 
 
+# [[storage("...")]] values -> sqlinq::column::Storage enumerators
+STORAGE_KINDS = {
+    "text": "Text",
+    "epoch_days": "EpochDays",
+    "unix_seconds": "UnixSeconds",
+}
+
+
 def validate_attributes(attrs: dict, field_name: str):
     """Validate attributes for a field. Raise ValueError if invalid"""
     allowed_attributes = {
@@ -58,6 +66,8 @@ def validate_attributes(attrs: dict, field_name: str):
         "foreign_key": {"required": True},
         "name": {"required": True},
         "unique": {"required": False},
+        "interned": {"required": False},
+        "storage": {"required": True},
         "default": {"required": True},
     }
     for key, val in attrs.items():
@@ -68,6 +78,8 @@ def validate_attributes(attrs: dict, field_name: str):
             raise ValueError(f"Attribute '{key}' on field '{field_name}' requires a value")
         if not requires_value and val:
             raise ValueError(f"Attribute '{key}' on field '{field_name}' must not have a value")
+    if "storage" in attrs and attrs["storage"] not in STORAGE_KINDS:
+        raise ValueError(f"Unknown storage '{attrs['storage']}' on field '{field_name}'")
 
 def cpp_type_to_hcl(cpp_type: str, attrs: dict, backend: str) -> tuple[str, bool]:
     """Map a C++ type into an Atlas HCL type."""
@@ -143,6 +155,9 @@ def cpp_type_to_hcl(cpp_type: str, attrs: dict, backend: str) -> tuple[str, bool
     }
 
     optional_match = re.match(r"std::optional<\s*([^>]+)\s*>", cpp_type)
+    # Integer storage of dates and times applies to SQLite only
+    if backend == "sqlite" and attrs.get("storage", "text") != "text":
+        return ("integer", optional_match is not None)
     if optional_match:
         inner_type = optional_match.group(1).strip()
         type_map = mapping.get(inner_type, {})
@@ -211,6 +226,13 @@ def parse_structs(source_code: bytes):
 
 # --- Code generation ---
 
+def attr_call(attr: str, value: str) -> str:
+    """Builder call on ColumnMeta for a field attribute."""
+    if attr == "storage":
+        return f".storage(sqlinq::column::Storage::{STORAGE_KINDS[value]})"
+    return f".{attr}()"
+
+
 def generate_hpp(structs, out_path: Path, include_dirs):
     """Generate a C++ schema header with Table<T>::meta()."""
     lines = [
@@ -239,7 +261,7 @@ def generate_hpp(structs, out_path: Path, include_dirs):
 
         for i, field in enumerate(struct["fields"]):
             comma = "," if i < len(struct["fields"]) - 1 else ""
-            attr_list = "".join(f".{a}()" for a in field["attrs"])
+            attr_list = "".join(attr_call(a, v) for a, v in field["attrs"].items())
             lines.append(
                 f"      SQLINQ_COLUMN_META({struct['name']}, {field['name']}, \"{field['column']}\"){attr_list}{comma}"
             )